@@ -0,0 +1,783 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      main.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    ShellKit benchmarks
+ * @discussion  Measures the hot paths of ShellKit, and writes the results
+ *              as JSON, so they can be compared across commits.
+ *              Latencies are in nanoseconds. The memory benchmark samples
+ *              the heap growth, in bytes, while a 10,000 tasks group runs.
+ *              
+ *              Usage: ShellKit-Benchmark [options]
+ *              
+ *                  --output <path>     Writes the results to a file,
+ *                                      instead of stdout
+ *                  --label <string>    An optional label (eg. a commit
+ *                                      hash), written with the results
+ *                  --threads <n>       Number of threads for contention
+ *                                      benchmarks (default: 8)
+ *                  --scale <n>         Multiplies the number of iterations
+ *                                      (default: 1)
+ *                  --no-large          Skips the 1 GB capture benchmark
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/ShellKit.h>
+#import <sys/utsname.h>
+#import <fcntl.h>
+#import <stdint.h>
+#import <stdlib.h>
+#import <string.h>
+#import <time.h>
+#import <unistd.h>
+
+#if defined( __APPLE__ )
+#import <malloc/malloc.h>
+#elif defined( __GLIBC__ )
+#import <malloc.h>
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef struct
+{
+    const char * output;
+    const char * label;
+    NSUInteger   threads;
+    NSUInteger   scale;
+    BOOL         large;
+}
+BenchmarkOptions;
+
+@interface BenchmarkResult: NSObject
+
+@property( atomic, readonly )          NSString * name;
+@property( atomic, readwrite, assign ) uint64_t   bytes;
+@property( atomic, readwrite, assign ) NSUInteger threads;
+@property( atomic, readwrite, assign ) uint64_t   wallTime;
+@property( atomic, readwrite, strong ) NSString * unit;
+
+- ( instancetype )initWithName: ( NSString * )name NS_DESIGNATED_INITIALIZER;
+- ( void )addSample: ( uint64_t )ns;
+- ( void )addSamples: ( NSData * )samples;
+- ( NSString * )JSONRepresentation;
+
+@end
+
+@interface NoOpTask: NSObject < SKRunableObject >
+
+@end
+
+@interface MemoryProbe: NSObject < SKRunableObject >
+
+@property( atomic, readwrite, strong ) BenchmarkResult * result;
+@property( atomic, readwrite, assign ) uint64_t          baseline;
+
+@end
+
+@interface PrintWorker: NSObject
+
+@property( atomic, readwrite, assign ) NSUInteger           count;
+@property( atomic, readwrite, strong ) NSMutableData      * samples;
+@property( atomic, readwrite, strong ) dispatch_semaphore_t start;
+@property( atomic, readwrite, strong ) dispatch_semaphore_t done;
+
+- ( void )run: ( nullable id )object;
+
+@end
+
+uint64_t          Now( void );
+uint64_t          HeapBytesInUse( void );
+BenchmarkOptions  ParseOptions( int argc, const char * _Nonnull argv[ _Nonnull ] );
+int               SilenceStandardOutput( void );
+void              RestoreStandardOutput( int fd );
+NSString        * JSONString( NSString * string );
+BenchmarkResult * BenchmarkSpawn( BenchmarkOptions options );
+BenchmarkResult * BenchmarkRender( BenchmarkOptions options );
+BenchmarkResult * BenchmarkCapture( BenchmarkOptions options, uint64_t size, NSUInteger iterations, NSString * name );
+BenchmarkResult * BenchmarkPrint( BenchmarkOptions options );
+BenchmarkResult * BenchmarkGroup( BenchmarkOptions options );
+BenchmarkResult * BenchmarkGroupMemory( BenchmarkOptions options );
+BOOL              WriteResults( NSArray< BenchmarkResult * > * results, BenchmarkOptions options );
+
+NS_ASSUME_NONNULL_END
+
+int main( int argc, const char * argv[] )
+{
+    @autoreleasepool
+    {
+        BenchmarkOptions                      options;
+        NSMutableArray< BenchmarkResult * > * results;
+        int                                   fd;
+        
+        options = ParseOptions( argc, argv );
+        results = [ NSMutableArray new ];
+        
+        if( getenv( "SHELL" ) == NULL )
+        {
+            setenv( "SHELL", "/bin/sh", 1 );
+        }
+        
+        /* Messages printed by ShellKit would otherwise pollute the results */
+        fd = SilenceStandardOutput();
+        
+        [ results addObject: BenchmarkSpawn( options ) ];
+        [ results addObject: BenchmarkRender( options ) ];
+        [ results addObject: BenchmarkCapture( options, 1024,        20 * options.scale, @"SKShell.runCommand.capture.1KB" ) ];
+        [ results addObject: BenchmarkCapture( options, 1024 * 1024, 10 * options.scale, @"SKShell.runCommand.capture.1MB" ) ];
+        
+        if( options.large )
+        {
+            [ results addObject: BenchmarkCapture( options, 1024 * 1024 * 1024, 1, @"SKShell.runCommand.capture.1GB" ) ];
+        }
+        
+        [ results addObject: BenchmarkPrint( options ) ];
+        [ results addObject: BenchmarkGroup( options ) ];
+        [ results addObject: BenchmarkGroupMemory( options ) ];
+        
+        RestoreStandardOutput( fd );
+        
+        if( WriteResults( results, options ) == NO )
+        {
+            return EXIT_FAILURE;
+        }
+    }
+    
+    return EXIT_SUCCESS;
+}
+
+uint64_t Now( void )
+{
+    struct timespec ts;
+    
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    
+    return ( uint64_t )ts.tv_sec * 1000000000 + ( uint64_t )ts.tv_nsec;
+}
+
+uint64_t HeapBytesInUse( void )
+{
+#if defined( __APPLE__ )
+    
+    malloc_statistics_t stats;
+    
+    malloc_zone_statistics( NULL, &stats );
+    
+    return ( uint64_t )( stats.size_in_use );
+
+#elif defined( __GLIBC__ ) && ( __GLIBC__ > 2 || ( __GLIBC__ == 2 && __GLIBC_MINOR__ >= 33 ) )
+    
+    struct mallinfo2 info;
+    
+    info = mallinfo2();
+    
+    return ( uint64_t )( info.uordblks + info.hblkhd );
+
+#elif defined( __GLIBC__ )
+    
+    struct mallinfo info;
+    
+    info = mallinfo();
+    
+    return ( uint64_t )( unsigned int )( info.uordblks ) + ( uint64_t )( unsigned int )( info.hblkhd );
+
+#else
+    
+    return 0;
+
+#endif
+}
+
+BenchmarkOptions ParseOptions( int argc, const char * argv[] )
+{
+    BenchmarkOptions options;
+    int              i;
+    
+    options.output  = NULL;
+    options.label   = NULL;
+    options.threads = 8;
+    options.scale   = 1;
+    options.large   = YES;
+    
+    for( i = 1; i < argc; i++ )
+    {
+        if( strcmp( argv[ i ], "--output" ) == 0 && i + 1 < argc )
+        {
+            options.output = argv[ ++i ];
+        }
+        else if( strcmp( argv[ i ], "--label" ) == 0 && i + 1 < argc )
+        {
+            options.label = argv[ ++i ];
+        }
+        else if( strcmp( argv[ i ], "--threads" ) == 0 && i + 1 < argc )
+        {
+            options.threads = ( NSUInteger )MAX( 1, atoi( argv[ ++i ] ) );
+        }
+        else if( strcmp( argv[ i ], "--scale" ) == 0 && i + 1 < argc )
+        {
+            options.scale = ( NSUInteger )MAX( 1, atoi( argv[ ++i ] ) );
+        }
+        else if( strcmp( argv[ i ], "--no-large" ) == 0 )
+        {
+            options.large = NO;
+        }
+        else
+        {
+            fprintf( stderr, "Unknown option: %s\n", argv[ i ] );
+        }
+    }
+    
+    return options;
+}
+
+int SilenceStandardOutput( void )
+{
+    int fd;
+    int null;
+    
+    fflush( stdout );
+    
+    fd   = dup( STDOUT_FILENO );
+    null = open( "/dev/null", O_WRONLY );
+    
+    if( null >= 0 )
+    {
+        dup2( null, STDOUT_FILENO );
+        close( null );
+    }
+    
+    return fd;
+}
+
+void RestoreStandardOutput( int fd )
+{
+    if( fd < 0 )
+    {
+        return;
+    }
+    
+    fflush( stdout );
+    dup2( fd, STDOUT_FILENO );
+    close( fd );
+}
+
+NSString * JSONString( NSString * string )
+{
+    NSMutableString * json;
+    NSUInteger        i;
+    unichar           c;
+    
+    json = [ NSMutableString stringWithString: @"\"" ];
+    
+    for( i = 0; i < string.length; i++ )
+    {
+        c = [ string characterAtIndex: i ];
+        
+        if( c == '"' || c == '\\' )
+        {
+            [ json appendFormat: @"\\%C", c ];
+        }
+        else if( c < 0x20 )
+        {
+            [ json appendFormat: @"\\u%04x", ( unsigned int )c ];
+        }
+        else
+        {
+            [ json appendFormat: @"%C", c ];
+        }
+    }
+    
+    [ json appendString: @"\"" ];
+    
+    return json;
+}
+
+BenchmarkResult * BenchmarkSpawn( BenchmarkOptions options )
+{
+    BenchmarkResult * result;
+    NSUInteger        i;
+    uint64_t          start;
+    uint64_t          t;
+    
+    result = [ [ BenchmarkResult alloc ] initWithName: @"SKShell.runCommand.spawn" ];
+    start  = Now();
+    
+    for( i = 0; i < 50 * options.scale; i++ )
+    {
+        @autoreleasepool
+        {
+            t = Now();
+            
+            [ [ SKShell currentShell ] runCommand: @"true" ];
+            [ result addSample: Now() - t ];
+        }
+    }
+    
+    result.wallTime = Now() - start;
+    
+    return result;
+}
+
+BenchmarkResult * BenchmarkRender( BenchmarkOptions options )
+{
+    BenchmarkResult                        * result;
+    SKTask                                 * task;
+    NSDictionary< NSString *, NSString * > * variables;
+    NSUInteger                               i;
+    uint64_t                                 start;
+    uint64_t                                 t;
+    
+    result    = [ [ BenchmarkResult alloc ] initWithName: @"SKTask.scriptWithVariables" ];
+    task      = [ SKTask taskWithShellScript: @"cc %{cflags}% -I%{include}% -o %{output}% %{input}% && strip %{output}% && cp %{output}% %{prefix}%/bin/%{name}%" ];
+    variables =
+    @{
+        @"cflags"  : @"-O3 -Wall -Wextra",
+        @"include" : @"/usr/local/include",
+        @"output"  : @"build/tool",
+        @"input"   : @"main.c",
+        @"prefix"  : @"/usr/local",
+        @"name"    : @"tool"
+    };
+    start     = Now();
+    
+    for( i = 0; i < 10000 * options.scale; i++ )
+    {
+        @autoreleasepool
+        {
+            t = Now();
+            
+            [ task scriptWithVariables: variables ];
+            [ result addSample: Now() - t ];
+        }
+    }
+    
+    result.wallTime = Now() - start;
+    
+    return result;
+}
+
+BenchmarkResult * BenchmarkCapture( BenchmarkOptions options, uint64_t size, NSUInteger iterations, NSString * name )
+{
+    BenchmarkResult    * result;
+    NSString           * command;
+    NSUInteger           i;
+    uint64_t             start;
+    uint64_t             t;
+    __block NSUInteger   length;
+    
+    ( void )options;
+    
+    result       = [ [ BenchmarkResult alloc ] initWithName: name ];
+    result.bytes = size;
+    command      = [ NSString stringWithFormat: @"head -c %llu /dev/zero | tr '\\0' 'x'", ( unsigned long long )size ];
+    start        = Now();
+    
+    for( i = 0; i < iterations; i++ )
+    {
+        @autoreleasepool
+        {
+            length = 0;
+            t      = Now();
+            
+            [ [ SKShell currentShell ] runCommand: command completion: ^( int status, NSString * output, NSString * error )
+                {
+                    ( void )status;
+                    ( void )error;
+                    
+                    length = output.length;
+                }
+            ];
+            
+            [ result addSample: Now() - t ];
+            
+            if( length != size )
+            {
+                fprintf( stderr, "%s: captured %lu bytes, expected %llu\n", name.UTF8String, ( unsigned long )length, ( unsigned long long )size );
+            }
+        }
+    }
+    
+    result.wallTime = Now() - start;
+    
+    return result;
+}
+
+BenchmarkResult * BenchmarkPrint( BenchmarkOptions options )
+{
+    BenchmarkResult                 * result;
+    NSMutableArray< PrintWorker * > * workers;
+    PrintWorker                     * worker;
+    dispatch_semaphore_t              start;
+    dispatch_semaphore_t              done;
+    NSUInteger                        i;
+    uint64_t                          t;
+    
+    result         = [ [ BenchmarkResult alloc ] initWithName: @"SKShell.printMessage.contention" ];
+    result.threads = options.threads;
+    workers        = [ NSMutableArray new ];
+    start          = dispatch_semaphore_create( 0 );
+    done           = dispatch_semaphore_create( 0 );
+    
+    for( i = 0; i < options.threads; i++ )
+    {
+        worker         = [ PrintWorker new ];
+        worker.count   = 2000 * options.scale;
+        worker.samples = [ NSMutableData dataWithLength: worker.count * sizeof( uint64_t ) ];
+        worker.start   = start;
+        worker.done    = done;
+        
+        [ workers addObject: worker ];
+        [ NSThread detachNewThreadSelector: @selector( run: ) toTarget: worker withObject: nil ];
+    }
+    
+    t = Now();
+    
+    for( i = 0; i < options.threads; i++ )
+    {
+        dispatch_semaphore_signal( start );
+    }
+    
+    for( i = 0; i < options.threads; i++ )
+    {
+        dispatch_semaphore_wait( done, DISPATCH_TIME_FOREVER );
+    }
+    
+    result.wallTime = Now() - t;
+    
+    for( worker in workers )
+    {
+        [ result addSamples: worker.samples ];
+    }
+    
+    return result;
+}
+
+BenchmarkResult * BenchmarkGroup( BenchmarkOptions options )
+{
+    BenchmarkResult                         * result;
+    NSMutableArray< id< SKRunableObject > > * tasks;
+    SKTaskGroup                             * group;
+    NSUInteger                                i;
+    uint64_t                                  start;
+    uint64_t                                  t;
+    
+    result = [ [ BenchmarkResult alloc ] initWithName: @"SKTaskGroup.schedule.noop" ];
+    tasks  = [ NSMutableArray new ];
+    
+    for( i = 0; i < 1000; i++ )
+    {
+        [ tasks addObject: [ NoOpTask new ] ];
+    }
+    
+    group = [ SKTaskGroup taskGroupWithName: @"benchmark" tasks: tasks ];
+    start = Now();
+    
+    for( i = 0; i < 20 * options.scale; i++ )
+    {
+        @autoreleasepool
+        {
+            t = Now();
+            
+            [ group run ];
+            
+            /* Samples are per scheduled task */
+            [ result addSample: ( Now() - t ) / tasks.count ];
+        }
+    }
+    
+    result.wallTime = Now() - start;
+    
+    return result;
+}
+
+BenchmarkResult * BenchmarkGroupMemory( BenchmarkOptions options )
+{
+    BenchmarkResult                         * result;
+    NSMutableArray< id< SKRunableObject > > * tasks;
+    MemoryProbe                             * probe;
+    SKTaskGroup                             * group;
+    NSUInteger                                i;
+    uint64_t                                  start;
+    
+    ( void )options;
+    
+    result      = [ [ BenchmarkResult alloc ] initWithName: @"SKTaskGroup.memory.10000" ];
+    result.unit = @"bytes";
+    tasks       = [ NSMutableArray new ];
+    probe       = [ MemoryProbe new ];
+    
+    /*
+     * Heap usage is sampled every 1000 tasks, relative to the start of the
+     * run - It should stay flat, whatever the number of tasks.
+     */
+    for( i = 0; i < 10000; i++ )
+    {
+        if( i % 1000 == 0 )
+        {
+            [ tasks addObject: probe ];
+        }
+        
+        [ tasks addObject: [ SKTask taskWithShellScript: @"true" ] ];
+    }
+    
+    [ tasks addObject: probe ];
+    
+    group              = [ SKTaskGroup taskGroupWithName: @"benchmark" tasks: tasks ];
+    group.batchesTasks = YES;
+    probe.result       = result;
+    start              = Now();
+    
+    @autoreleasepool
+    {
+        probe.baseline = HeapBytesInUse();
+        
+        [ group run ];
+    }
+    
+    result.wallTime = Now() - start;
+    
+    return result;
+}
+
+BOOL WriteResults( NSArray< BenchmarkResult * > * results, BenchmarkOptions options )
+{
+    NSMutableString * json;
+    BenchmarkResult * result;
+    struct utsname    name;
+    NSString        * system;
+    FILE            * fp;
+    
+    system = @"unknown";
+    
+    if( uname( &name ) == 0 )
+    {
+        system = [ NSString stringWithFormat: @"%s %s %s", name.sysname, name.release, name.machine ];
+    }
+    
+    json = [ NSMutableString new ];
+    
+    [ json appendString: @"{\n" ];
+    [ json appendFormat: @"    \"suite\": \"ShellKit-Benchmark\",\n" ];
+    [ json appendFormat: @"    \"label\": %@,\n", ( options.label ) ? JSONString( @( options.label ) ) : @"null" ];
+    [ json appendFormat: @"    \"timestamp\": %.0f,\n", [ [ NSDate date ] timeIntervalSince1970 ] ];
+    [ json appendFormat: @"    \"system\": %@,\n", JSONString( system ) ];
+    [ json appendString: @"    \"results\":\n    [\n" ];
+    
+    for( result in results )
+    {
+        [ json appendFormat: @"        %@%@\n", result.JSONRepresentation, ( result == results.lastObject ) ? @"" : @"," ];
+    }
+    
+    [ json appendString: @"    ]\n}\n" ];
+    
+    fp = ( options.output ) ? fopen( options.output, "w" ) : stdout;
+    
+    if( fp == NULL )
+    {
+        fprintf( stderr, "Cannot open output file: %s\n", options.output );
+        
+        return NO;
+    }
+    
+    fprintf( fp, "%s", json.UTF8String );
+    
+    if( fp != stdout )
+    {
+        fclose( fp );
+    }
+    
+    return YES;
+}
+
+static int CompareSamples( const void * a, const void * b )
+{
+    uint64_t x;
+    uint64_t y;
+    
+    x = *( ( const uint64_t * )a );
+    y = *( ( const uint64_t * )b );
+    
+    return ( x < y ) ? -1 : ( ( x > y ) ? 1 : 0 );
+}
+
+@interface BenchmarkResult()
+
+@property( atomic, readwrite, strong ) NSString      * name;
+@property( atomic, readwrite, strong ) NSMutableData * samples;
+
+@end
+
+@implementation BenchmarkResult
+
+- ( instancetype )init
+{
+    return [ self initWithName: @"" ];
+}
+
+- ( instancetype )initWithName: ( NSString * )name
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.name    = name;
+        self.samples = [ NSMutableData new ];
+        self.threads = 1;
+        self.unit    = @"ns";
+    }
+    
+    return self;
+}
+
+- ( void )addSample: ( uint64_t )ns
+{
+    [ self.samples appendBytes: &ns length: sizeof( uint64_t ) ];
+}
+
+- ( void )addSamples: ( NSData * )samples
+{
+    [ self.samples appendData: samples ];
+}
+
+- ( NSString * )JSONRepresentation
+{
+    NSMutableData * sorted;
+    uint64_t      * samples;
+    size_t          count;
+    size_t          i;
+    double          total;
+    double          seconds;
+    
+    sorted  = self.samples.mutableCopy;
+    samples = sorted.mutableBytes;
+    count   = sorted.length / sizeof( uint64_t );
+    total   = 0;
+    
+    if( count == 0 )
+    {
+        return [ NSString stringWithFormat: @"{ \"name\": %@, \"iterations\": 0 }", JSONString( self.name ) ];
+    }
+    
+    qsort( samples, count, sizeof( uint64_t ), CompareSamples );
+    
+    for( i = 0; i < count; i++ )
+    {
+        total += ( double )samples[ i ];
+    }
+    
+    seconds = ( double )( self.wallTime ) / 1e9;
+    
+    return [ NSString stringWithFormat: @"{ \"name\": %@, \"unit\": %@, \"iterations\": %zu, \"threads\": %lu, \"bytes\": %llu, \"min\": %llu, \"mean\": %.0f, \"p50\": %llu, \"p99\": %llu, \"max\": %llu, \"wall\": %llu, \"ops_per_second\": %.2f, \"bytes_per_second\": %.2f }",
+        JSONString( self.name ),
+        JSONString( self.unit ),
+        count,
+        ( unsigned long )( self.threads ),
+        ( unsigned long long )( self.bytes ),
+        ( unsigned long long )samples[ 0 ],
+        total / ( double )count,
+        ( unsigned long long )samples[ ( size_t )( ( double )( count - 1 ) * 0.50 + 0.5 ) ],
+        ( unsigned long long )samples[ ( size_t )( ( double )( count - 1 ) * 0.99 + 0.5 ) ],
+        ( unsigned long long )samples[ count - 1 ],
+        ( unsigned long long )( self.wallTime ),
+        ( seconds > 0 ) ? ( double )count / seconds : 0.0,
+        ( seconds > 0 ) ? ( double )( self.bytes * count ) / seconds : 0.0
+    ];
+}
+
+@end
+
+@implementation NoOpTask
+
+@synthesize running = _running;
+@synthesize error   = _error;
+
+- ( BOOL )run
+{
+    return [ self run: nil ];
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    ( void )variables;
+    
+    return YES;
+}
+
+@end
+
+@implementation MemoryProbe
+
+@synthesize running = _running;
+@synthesize error   = _error;
+
+- ( BOOL )run
+{
+    return [ self run: nil ];
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    uint64_t bytes;
+    
+    ( void )variables;
+    
+    bytes = HeapBytesInUse();
+    
+    [ self.result addSample: ( bytes > self.baseline ) ? bytes - self.baseline : 0 ];
+    
+    return YES;
+}
+
+@end
+
+@implementation PrintWorker
+
+- ( void )run: ( nullable id )object
+{
+    uint64_t   * samples;
+    NSUInteger   i;
+    uint64_t     t;
+    
+    ( void )object;
+    
+    samples = self.samples.mutableBytes;
+    
+    dispatch_semaphore_wait( self.start, DISPATCH_TIME_FOREVER );
+    
+    for( i = 0; i < self.count; i++ )
+    {
+        @autoreleasepool
+        {
+            t = Now();
+            
+            [ [ SKShell currentShell ] printMessage: @"Benchmark message #%lu" status: SKStatusInfo color: SKColorBlue, ( unsigned long )i ];
+            
+            samples[ i ] = Now() - t;
+        }
+    }
+    
+    dispatch_semaphore_signal( self.done );
+}
+
+@end
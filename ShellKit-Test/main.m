@@ -29,9 +29,13 @@
 
 #import <Foundation/Foundation.h>
 #import <ShellKit/ShellKit.h>
+#import <signal.h>
 
 @interface TaskDelegate: NSObject < SKTaskDelegate >
 
+@property( atomic, readwrite, assign ) BOOL       quiet;
+@property( atomic, readwrite, assign ) NSUInteger outputLength;
+
 @end
 
 void PrintStep( NSString * msg );
@@ -83,6 +87,58 @@ int main( void )
             ];
         }
         
+        PrintStep( @"Color detection" );
+        
+        {
+            SKShell * shell;
+            
+            setenv( "NO_COLOR", "1", 1 );
+            
+            shell = [ SKShell new ];
+            
+            assert( ( shell.supportsColors == NO ) );
+            
+            unsetenv( "NO_COLOR" );
+            setenv( "FORCE_COLOR", "1", 1 );
+            
+            shell = [ SKShell new ];
+            
+            assert( ( shell.supportsColors == YES ) );
+            
+            unsetenv( "FORCE_COLOR" );
+        }
+        
+        PrintStep( @"Prompt" );
+        
+        {
+            SKShell  * shell;
+            NSString * prompt;
+            
+            shell             = [ SKShell new ];
+            shell.promptParts = @[ @"foo", @"bar" ];
+            
+            assert( ( shell.promptParts.count == 2 ) );
+            assert( ( [ shell.prompt rangeOfString: @"foo" ].location != NSNotFound ) );
+            
+            shell.prompt = @"> ";
+            
+            assert( ( shell.promptParts.count == 0 ) );
+            assert( ( [ shell.prompt isEqualToString: @"> " ] ) );
+            
+            shell.promptParts = @[ @"foo" ];
+            prompt            = shell.prompt;
+            
+            [ shell addPromptPart: @"bar" ];
+            
+            assert( ( shell.promptParts.count == 2 ) );
+            assert( ( [ shell.prompt hasPrefix: prompt ] ) );
+            
+            [ shell removeLastPromptPart ];
+            
+            assert( ( shell.promptParts.count == 1 ) );
+            assert( ( [ shell.prompt isEqualToString: prompt ] ) );
+        }
+        
         PrintStep( @"Simple task" );
         
         {
@@ -133,6 +189,89 @@ int main( void )
             assert( ( [ task run ] == YES ) );
         }
         
+        PrintStep( @"Simple task failure with race recovery" );
+        
+        {
+            SKTask * task;
+            SKTask * slow;
+            NSDate * date;
+            
+            slow                = [ SKTask taskWithShellScript: @"sleep 30" ];
+            task                = [ SKTask taskWithShellScript: @"false" recoverTasks: @[ slow, [ SKTask taskWithShellScript: @"true" ] ] ];
+            task.recoveryPolicy = SKTaskRecoveryPolicyRace;
+            date                = [ NSDate date ];
+            
+            assert( ( [ task run ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+            assert( ( slow.running == NO ) );
+            
+            date = [ NSDate date ];
+            
+            assert( ( [ [ task runAsynchronously: nil ] wait ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+            assert( ( slow.running == NO ) );
+        }
+        
+        PrintStep( @"Simple task with hedged recovery" );
+        
+        {
+            SKTask     * task;
+            NSString   * path;
+            NSString   * script;
+            NSDate     * date;
+            NSUInteger   i;
+            
+            path   = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            script = [ NSString stringWithFormat: @"sleep $( cat '%@' )", path ];
+            
+            [ @"0" writeToFile: path atomically: YES encoding: NSUTF8StringEncoding error: NULL ];
+            
+            for( i = 0; i < 5; i++ )
+            {
+                assert( ( [ [ SKTask taskWithShellScript: script ] run ] == YES ) );
+            }
+            
+            [ @"30" writeToFile: path atomically: YES encoding: NSUTF8StringEncoding error: NULL ];
+            
+            task                = [ SKTask taskWithShellScript: script recoverTask: [ SKTask taskWithShellScript: @"true" ] ];
+            task.recoveryPolicy = SKTaskRecoveryPolicyHedge;
+            date                = [ NSDate date ];
+            
+            assert( ( [ task run ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+            
+            date = [ NSDate date ];
+            
+            assert( ( [ [ task runAsynchronously: nil ] wait ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+        }
+        
+        PrintStep( @"Task cancellation" );
+        
+        {
+            SKTask * task;
+            NSDate * date;
+            
+            task = [ SKTask taskWithShellScript: @"sleep 30" ];
+            date = [ NSDate date ];
+            
+            dispatch_after
+            (
+                dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 500 * NSEC_PER_MSEC ) ),
+                dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+                ^( void )
+                {
+                    [ task cancel ];
+                }
+            );
+            
+            assert( ( [ task run ] == NO ) );
+            assert( ( task.cancelled ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+        }
+        
         PrintStep( @"Optional task" );
         
         {
@@ -143,6 +282,35 @@ int main( void )
             assert( ( [ task run ] == YES ) );
         }
         
+        PrintStep( @"Detached optional task" );
+        
+        {
+            SKOptionalTask * task;
+            NSDate         * date;
+            
+            task             = [ SKOptionalTask taskWithShellScript: @"sleep 30" ];
+            task.detached    = YES;
+            task.joinTimeout = 1;
+            date             = [ NSDate date ];
+            
+            assert( ( [ task run ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 1 ) );
+            assert( ( [ task join ] == NO ) );
+            assert( ( task.running == NO ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+            
+            /* Processes started by the task keep its output open, and must be stopped as well */
+            task             = [ SKOptionalTask taskWithShellScript: @"sleep 30 & sleep 30" ];
+            task.detached    = YES;
+            task.joinTimeout = 1;
+            date             = [ NSDate date ];
+            
+            assert( ( [ task run ] == YES ) );
+            assert( ( [ task join ] == NO ) );
+            assert( ( task.running == NO ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+        }
+        
         PrintStep( @"Task group" );
         
         {
@@ -185,6 +353,55 @@ int main( void )
             assert( ( [ group run ] == YES ) );
         }
         
+        PrintStep( @"Task group with detached optional tasks" );
+        
+        {
+            SKOptionalTask * t1;
+            SKOptionalTask * t2;
+            SKTask         * t3;
+            SKTask         * t4;
+            SKTaskGroup    * group;
+            NSString       * p1;
+            NSString       * p2;
+            
+            p1          = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            p2          = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            t1          = [ SKOptionalTask taskWithShellScript: [ NSString stringWithFormat: @"sleep 1; touch '%@'", p1 ] ];
+            t1.detached = YES;
+            t2          = [ SKOptionalTask taskWithShellScript: [ NSString stringWithFormat: @"sleep 1; echo background; touch '%@'", p2 ] ];
+            t2.detached = YES;
+            t3          = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"test ! -f '%@'", p1 ] ];
+            t4          = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"test -f '%@'", p1 ] ];
+            group       = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t3, [ SKTaskBarrier barrier ], t4, t2 ] ];
+            
+            assert( ( [ group run ] == YES ) );
+            assert( ( [ [ NSFileManager defaultManager ] fileExistsAtPath: p2 ] ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: p1 error: NULL ];
+            [ [ NSFileManager defaultManager ] removeItemAtPath: p2 error: NULL ];
+        }
+        
+        PrintStep( @"Task barrier scope" );
+        
+        {
+            SKOptionalTask * task;
+            SKTaskGroup    * group;
+            NSDate         * date;
+            
+            /* A barrier in a group doesn't join tasks detached elsewhere */
+            task          = [ SKOptionalTask taskWithShellScript: @"sleep 3" ];
+            task.detached = YES;
+            group         = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ [ SKTask taskWithShellScript: @"true" ], [ SKTaskBarrier barrier ] ] ];
+            
+            assert( ( [ task run ] == YES ) );
+            
+            date = [ NSDate date ];
+            
+            assert( ( [ group run ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 2 ) );
+            assert( ( [ task join ] == YES ) );
+        }
+        
         PrintStep( @"Task groups in task group" );
         
         {
@@ -243,6 +460,801 @@ int main( void )
             assert( ( [ group run ] == YES ) );
         }
         
+        PrintStep( @"Task group with batched tasks" );
+        
+        {
+            SKTask       * t1;
+            SKTask       * t2;
+            SKTask       * t3;
+            SKTaskGroup  * group;
+            TaskDelegate * delegate;
+            
+            t1                 = [ SKTask taskWithShellScript: @"echo foo" ];
+            t2                 = [ SKTask taskWithShellScript: @"echo bar 1>&2" ];
+            t3                 = [ SKTask taskWithShellScript: @"true" ];
+            delegate           = [ TaskDelegate new ];
+            t1.delegate        = delegate;
+            t2.delegate        = delegate;
+            group              = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t2, t3 ] ];
+            group.batchesTasks = YES;
+            
+            assert( ( [ group run ] == YES ) );
+        }
+        
+        PrintStep( @"Task group with batched tasks failure" );
+        
+        {
+            SKTask      * t1;
+            SKTask      * t2;
+            SKTask      * t3;
+            SKTaskGroup * group;
+            
+            t1                 = [ SKTask taskWithShellScript: @"true" ];
+            t2                 = [ SKTask taskWithShellScript: @"exit 3" ];
+            t3                 = [ SKTask taskWithShellScript: @"echo 'Should not be printed'" ];
+            group              = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t2, t3 ] ];
+            group.batchesTasks = YES;
+            
+            assert( ( [ group run ] == NO ) );
+        }
+        
+        PrintStep( @"Task group with batched tasks and successful recovery" );
+        
+        {
+            SKTask      * t1;
+            SKTask      * t2;
+            SKTask      * t3;
+            SKTaskGroup * group;
+            
+            t1                 = [ SKTask taskWithShellScript: @"true" ];
+            t2                 = [ SKTask taskWithShellScript: @"false" recoverTask: t1 ];
+            t3                 = [ SKTask taskWithShellScript: @"true" ];
+            group              = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t2, t3 ] ];
+            group.batchesTasks = YES;
+            
+            assert( ( [ group run ] == YES ) );
+        }
+        
+        PrintStep( @"Service task" );
+        
+        {
+            SKTask      * service;
+            SKTask      * task;
+            SKTaskGroup * group;
+            
+            service              = [ SKTask taskWithShellScript: @"echo 'Listening...'; sleep 30" ];
+            service.readyPattern = @"^Listening";
+            task                 = [ SKTask taskWithShellScript: @"true" ];
+            group                = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ service, task ] ];
+            
+            assert( ( [ group run ] == YES ) );
+            assert( service.running == NO );
+            assert( ( [ [ group runAsynchronously: nil ] wait ] == YES ) );
+            assert( service.running == NO );
+            assert( ( [ [ service runAsynchronously: nil ] wait ] == YES ) );
+            assert( service.running );
+            
+            [ service stopService ];
+            
+            assert( service.running == NO );
+        }
+        
+        PrintStep( @"Service task with child processes" );
+        
+        {
+            SKTask      * service;
+            SKTaskGroup * group;
+            NSString    * path;
+            NSDate      * date;
+            
+            /* Processes started by the service are stopped with it */
+            path                 = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            service              = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"sleep 30 & echo $! > '%@'; echo 'Listening...'; wait", path ] ];
+            service.readyPattern = @"^Listening";
+            group                = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ service, [ SKTask taskWithShellScript: @"true" ] ] ];
+            date                 = [ NSDate date ];
+            
+            assert( ( [ group run ] == YES ) );
+            assert( ( -[ date timeIntervalSinceNow ] < 10 ) );
+            assert( ( kill( ( pid_t )[ [ NSString stringWithContentsOfFile: path encoding: NSUTF8StringEncoding error: NULL ] intValue ], 0 ) != 0 ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+        }
+        
+        PrintStep( @"Service task exiting before being stopped" );
+        
+        {
+            SKTask * service;
+            
+            /* A service that fails by itself is recorded as failed, while one stopped by its signals succeeds */
+            service              = [ SKTask taskWithShellScript: @"echo 'Listening...'; sleep 0.2; exit 3" ];
+            service.readyPattern = @"^Listening";
+            
+            assert( ( [ service run ] == YES ) );
+            
+            sleep( 1 );
+            
+            [ service stopService ];
+            
+            assert( ( [ service snapshot ].state == SKTaskStateFailed ) );
+            
+            service              = [ SKTask taskWithShellScript: @"echo 'Listening...'; sleep 30" ];
+            service.readyPattern = @"^Listening";
+            
+            assert( ( [ service run ] == YES ) );
+            
+            [ service stopService ];
+            
+            assert( ( [ service snapshot ].state == SKTaskStateSucceeded ) );
+        }
+        
+        PrintStep( @"Service task with ready path" );
+        
+        {
+            SKTask      * service;
+            SKTask      * task;
+            SKTaskGroup * group;
+            NSString    * path;
+            
+            path              = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            service           = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"sleep 1; touch '%@'; sleep 30", path ] ];
+            service.readyPath = path;
+            task              = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"test -f '%@'", path ] ];
+            group             = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ service, task ] ];
+            
+            assert( ( [ group run ] == YES ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+        }
+        
+        PrintStep( @"Service task failure" );
+        
+        {
+            SKTask * service;
+            
+            service              = [ SKTask taskWithShellScript: @"sleep 30" ];
+            service.readyPattern = @"^Listening";
+            service.readyTimeout = 1;
+            
+            assert( ( [ service run ] == NO ) );
+            assert( ( [ [ service runAsynchronously: nil ] wait ] == NO ) );
+            assert( ( service.running == NO ) );
+        }
+        
+        PrintStep( @"Task group cancellation" );
+        
+        {
+            SKTask      * t1;
+            SKTask      * t2;
+            SKTaskGroup * group;
+            
+            t1    = [ SKTask taskWithShellScript: @"sleep 30" ];
+            t2    = [ SKTask taskWithShellScript: @"true" ];
+            group = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t2 ] ];
+            
+            dispatch_after
+            (
+                dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 500 * NSEC_PER_MSEC ) ),
+                dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+                ^( void )
+                {
+                    [ group cancel ];
+                }
+            );
+            
+            assert( ( [ group run ] == NO ) );
+            assert( ( group.cancelled ) );
+            assert( ( t2.running == NO ) );
+        }
+        
+        PrintStep( @"Task group status snapshot" );
+        
+        {
+            SKTask               * t1;
+            SKTask               * t2;
+            SKTaskGroup          * group;
+            SKTaskStatus         * status;
+            NSDate               * date;
+            dispatch_semaphore_t   done;
+            
+            t1                 = [ SKTask taskWithShellScript: @"echo hello" ];
+            t2                 = [ SKTask taskWithShellScript: @"sleep 1" ];
+            group              = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t2 ] ];
+            group.batchesTasks = YES;
+            done               = dispatch_semaphore_create( 0 );
+            
+            assert( ( [ group snapshot ].state == SKTaskStatePending ) );
+            assert( ( [ group snapshot ].children.count == 2 ) );
+            
+            dispatch_async
+            (
+                dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+                ^( void )
+                {
+                    assert( ( [ group run ] == YES ) );
+                    
+                    dispatch_semaphore_signal( done );
+                }
+            );
+            
+            date   = [ NSDate date ];
+            status = [ group snapshot ];
+            
+            while( status.children[ 1 ].state != SKTaskStateRunning && -[ date timeIntervalSinceNow ] < 5 )
+            {
+                usleep( 10000 );
+                
+                status = [ group snapshot ];
+            }
+            
+            assert( ( status.state == SKTaskStateRunning ) );
+            assert( ( status.children[ 0 ].state == SKTaskStateSucceeded ) );
+            assert( ( status.children[ 0 ].outputBytes == 6 ) );
+            assert( ( status.children[ 1 ].state == SKTaskStateRunning ) );
+            assert( ( status.children[ 1 ].processIdentifier > 0 ) );
+            assert( ( status.children[ 1 ].startDate != nil ) );
+            assert( ( status.runningStatuses.count == 1 ) );
+            assert( ( status.runningStatuses.firstObject.processIdentifier == status.children[ 1 ].processIdentifier ) );
+            
+            dispatch_semaphore_wait( done, DISPATCH_TIME_FOREVER );
+            
+            status = [ group snapshot ];
+            
+            assert( ( status.state == SKTaskStateSucceeded ) );
+            assert( ( status.children[ 1 ].state == SKTaskStateSucceeded ) );
+            assert( ( status.duration >= 1 ) );
+        }
+        
+        PrintStep( @"Event stream" );
+        
+        {
+            SKTask                           * t1;
+            SKTask                           * t2;
+            SKTaskGroup                      * group;
+            SKEventStream                    * stream;
+            NSString                         * path;
+            NSString                         * line;
+            NSDictionary                     * event;
+            NSMutableArray< NSDictionary * > * events;
+            NSMutableString                  * output;
+            
+            path   = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            stream = [ SKEventStream eventStreamWithPath: path ];
+            t1     = [ SKTask taskWithShellScript: @"echo 'hello \"world\"'" ];
+            t2     = [ SKTask taskWithShellScript: @"exit 2" ];
+            group  = [ SKTaskGroup taskGroupWithName: @"events" tasks: @[ t1, t2 ] ];
+            events = [ NSMutableArray new ];
+            
+            assert( ( stream != nil ) );
+            
+            [ SKShell currentShell ].eventStream = stream;
+            
+            assert( ( [ group run ] == NO ) );
+            
+            [ SKShell currentShell ].eventStream = nil;
+            
+            [ stream flush ];
+            
+            for( line in [ [ NSString stringWithContentsOfFile: path encoding: NSUTF8StringEncoding error: NULL ] componentsSeparatedByString: @"\n" ] )
+            {
+                if( line.length )
+                {
+                    event = [ NSJSONSerialization JSONObjectWithData: ( NSData * )[ line dataUsingEncoding: NSUTF8StringEncoding ] options: ( NSJSONReadingOptions )0 error: NULL ];
+                    
+                    assert( ( event != nil ) );
+                    assert( ( [ event[ @"time" ] doubleValue ] > 0 ) );
+                    
+                    [ events addObject: event ];
+                }
+            }
+            
+            assert( ( events.count >= 8 ) );
+            assert( ( [ events[ 0 ][ @"event" ] isEqualToString: @"group_start" ] ) );
+            assert( ( [ events[ 0 ][ @"name" ] isEqualToString: @"events" ] ) );
+            assert( ( [ events[ 1 ][ @"event" ] isEqualToString: @"task_start" ] ) );
+            assert( ( [ events[ 2 ][ @"event" ] isEqualToString: @"task_output" ] ) );
+            assert( ( [ events[ 2 ][ @"data" ] isEqualToString: @"hello \"world\"\n" ] ) );
+            assert( ( [ events[ 2 ][ @"id" ] isEqual: events[ 1 ][ @"id" ] ] ) );
+            assert( ( [ events[ 3 ][ @"event" ] isEqualToString: @"task_end" ] ) );
+            assert( ( [ events[ 3 ][ @"state" ] isEqualToString: @"succeeded" ] ) );
+            assert( ( [ events[ 3 ][ @"status" ] isEqual: @0 ] ) );
+            assert( ( [ events[ 4 ][ @"event" ] isEqualToString: @"task_start" ] ) );
+            assert( ( [ events[ 5 ][ @"event" ] isEqualToString: @"error" ] ) );
+            assert( ( [ events[ 6 ][ @"event" ] isEqualToString: @"task_end" ] ) );
+            assert( ( [ events[ 6 ][ @"state" ] isEqualToString: @"failed" ] ) );
+            assert( ( [ events[ 6 ][ @"status" ] isEqual: @2 ] ) );
+            assert( ( [ events.lastObject[ @"event" ] isEqualToString: @"group_end" ] ) );
+            assert( ( [ events.lastObject[ @"state" ] isEqualToString: @"failed" ] ) );
+            assert( ( [ events.lastObject[ @"id" ] isEqual: events[ 0 ][ @"id" ] ] ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+            
+            /* Characters split across chunks of output must be kept */
+            stream = [ SKEventStream eventStreamWithPath: path ];
+            output = [ NSMutableString new ];
+            
+            assert( ( stream != nil ) );
+            
+            [ SKShell currentShell ].eventStream = stream;
+            
+            assert( ( [ [ SKTask taskWithShellScript: @"printf '\\303'; sleep 0.2; printf '\\251'" ] run ] == YES ) );
+            
+            [ SKShell currentShell ].eventStream = nil;
+            
+            [ stream flush ];
+            
+            for( line in [ [ NSString stringWithContentsOfFile: path encoding: NSUTF8StringEncoding error: NULL ] componentsSeparatedByString: @"\n" ] )
+            {
+                if( line.length )
+                {
+                    event = [ NSJSONSerialization JSONObjectWithData: ( NSData * )[ line dataUsingEncoding: NSUTF8StringEncoding ] options: ( NSJSONReadingOptions )0 error: NULL ];
+                    
+                    if( [ event[ @"event" ] isEqualToString: @"task_output" ] )
+                    {
+                        [ output appendString: event[ @"data" ] ];
+                    }
+                }
+            }
+            
+            assert( ( [ output isEqualToString: @"\u00e9" ] ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+            
+            /* Start events are written at once, and output shortly after */
+            stream = [ SKEventStream eventStreamWithPath: path ];
+            
+            assert( ( stream != nil ) );
+            
+            [ SKShell currentShell ].eventStream = stream;
+            
+            assert( ( [ [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"grep -q task_start '%@' && echo foo && sleep 0.5 && grep -q task_output '%@'", path, path ] ] run ] == YES ) );
+            
+            [ SKShell currentShell ].eventStream = nil;
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+        }
+        
+        PrintStep( @"Parallel task group" );
+        
+        {
+            SKConcurrencyLimiter * limiter;
+            SKTaskGroup          * group;
+            SKTask               * heavy;
+            NSDate               * date;
+            NSTimeInterval         time;
+            
+            limiter              = [ SKConcurrencyLimiter new ];
+            limiter.minimumLimit = 2;
+            limiter.maximumLimit = 2;
+            group                = [ SKTaskGroup taskGroupWithName: @"parallel" tasks: @[ [ SKTask taskWithShellScript: @"sleep 0.5" ], [ SKTask taskWithShellScript: @"sleep 0.5" ], [ SKTask taskWithShellScript: @"sleep 0.5" ], [ SKTask taskWithShellScript: @"sleep 0.5" ] ] ];
+            
+            group.concurrencyLimiter = limiter;
+            date                     = [ NSDate date ];
+            
+            assert( ( [ group run ] ) );
+            
+            time = -[ date timeIntervalSinceNow ];
+            
+            assert( ( time >= 0.9 && time < 1.9 ) );
+            assert( ( limiter.limit == 2 ) );
+            assert( ( limiter.slotsInUse == 0 ) );
+            
+            heavy        = [ SKTask taskWithShellScript: @"sleep 0.5" ];
+            heavy.weight = 2;
+            group        = [ SKTaskGroup taskGroupWithName: @"parallel" tasks: @[ heavy, [ SKTask taskWithShellScript: @"sleep 0.5" ], [ SKTask taskWithShellScript: @"sleep 0.5" ] ] ];
+            
+            group.concurrencyLimiter = limiter;
+            date                     = [ NSDate date ];
+            
+            assert( ( [ group run ] ) );
+            
+            time = -[ date timeIntervalSinceNow ];
+            
+            assert( ( time >= 0.9 && time < 1.9 ) );
+            
+            group = [ SKTaskGroup taskGroupWithName: @"parallel" tasks: @[ [ SKTask taskWithShellScript: @"exit 1" ], [ SKTask taskWithShellScript: @"true" ] ] ];
+            
+            group.concurrencyLimiter = limiter;
+            
+            assert( ( [ group run ] == NO ) );
+            assert( ( group.error != nil ) );
+            assert( ( limiter.slotsInUse == 0 ) );
+        }
+        
+        PrintStep( @"Nested parallel task groups" );
+        
+        {
+            SKConcurrencyLimiter * limiter;
+            SKTaskGroup          * inner;
+            SKTaskGroup          * group;
+            
+            /* A parallel group nested in a sequential one shares the limiter of the outer group */
+            limiter              = [ SKConcurrencyLimiter new ];
+            limiter.minimumLimit = 1;
+            limiter.maximumLimit = 1;
+            inner                = [ SKTaskGroup taskGroupWithName: @"inner" tasks: @[ [ SKTask taskWithShellScript: @"true" ], [ SKTask taskWithShellScript: @"true" ] ] ];
+            group                = [ SKTaskGroup taskGroupWithName: @"outer" tasks: @[ [ SKTaskGroup taskGroupWithName: @"sequential" tasks: @[ inner ] ], [ SKTask taskWithShellScript: @"true" ] ] ];
+            
+            inner.concurrencyLimiter = limiter;
+            group.concurrencyLimiter = limiter;
+            
+            assert( ( [ group run ] ) );
+            assert( ( [ [ group runAsynchronously: nil ] wait ] ) );
+            assert( ( limiter.slotsInUse == 0 ) );
+        }
+        
+        PrintStep( @"Prompt of parallel task groups" );
+        
+        {
+            SKConcurrencyLimiter * limiter;
+            SKTaskGroup          * group;
+            NSArray              * parts;
+            
+            /* Nested groups running in parallel only change the prompt of their own thread */
+            limiter              = [ SKConcurrencyLimiter new ];
+            limiter.minimumLimit = 4;
+            limiter.maximumLimit = 4;
+            parts                = [ SKShell currentShell ].promptParts;
+            group                = [ SKTaskGroup taskGroupWithName: @"parallel" tasks: @[ [ SKTaskGroup taskGroupWithName: @"a" tasks: @[ [ SKTask taskWithShellScript: @"sleep 0.1" ], [ SKTask taskWithShellScript: @"sleep 0.3" ] ] ], [ SKTaskGroup taskGroupWithName: @"b" tasks: @[ [ SKTask taskWithShellScript: @"sleep 0.2" ], [ SKTask taskWithShellScript: @"sleep 0.1" ] ] ] ] ];
+            
+            group.concurrencyLimiter = limiter;
+            
+            assert( ( [ group run ] ) );
+            assert( ( [ [ SKShell currentShell ].promptParts isEqualToArray: parts ] ) );
+            assert( ( [ [ group runAsynchronously: nil ] wait ] ) );
+            assert( ( [ [ SKShell currentShell ].promptParts isEqualToArray: parts ] ) );
+        }
+        
+        PrintStep( @"Task process attributes" );
+        
+        {
+            SKProcessAttributes * attributes;
+            SKTaskGroup         * group;
+            SKTask              * task;
+            SKFuture            * future;
+            
+            attributes                = [ SKProcessAttributes new ];
+            attributes.niceValue      = @5;
+            attributes.openFilesLimit = 64;
+            task                      = [ SKTask taskWithShellScript: @"test \"$( nice )\" = 5 && test \"$( ulimit -n )\" = 64" ];
+            
+            task.processAttributes = attributes;
+            
+            assert( ( [ task run ] ) );
+            assert( ( [ SKProcessAttributes availableCPUs ].count > 0 ) );
+            
+            attributes                   = [ SKProcessAttributes new ];
+            attributes.addressSpaceLimit = 1024;
+            task.processAttributes       = attributes;
+            
+            assert( ( [ task run ] == NO ) );
+            
+            task  = [ SKTask taskWithShellScript: @"sleep 1" ];
+            group = [ SKTaskGroup taskGroupWithName: @"pinned" tasks: @[ task, [ SKTask taskWithShellScript: @"true" ] ] ];
+            
+            group.concurrencyLimiter = [ SKConcurrencyLimiter new ];
+            group.assignsCPUs        = YES;
+            future                   = [ group runAsynchronously: nil ];
+            
+            /* Pinning doesn't change the attributes of the running task */
+            while( task.running == NO && future.finished == NO )
+            {
+                usleep( 1000 );
+            }
+            
+            assert( ( task.processAttributes == nil ) );
+            assert( ( [ future wait ] ) );
+            assert( ( task.processAttributes == nil ) );
+        }
+        
+        PrintStep( @"Record and replay" );
+        
+        {
+            SKRecording      * recording;
+            SKTaskGroup      * group;
+            NSString         * path;
+            NSDate           * start;
+            __block NSString * recorded;
+            __block NSString * replayed;
+            
+            path      = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            recording = [ SKRecording recordingToPath: path ];
+            group     = [ SKTaskGroup taskGroupWithName: @"recorded" tasks: @[ [ SKTask taskWithShellScript: @"sleep 1" ], [ SKTask taskWithShellScript: @"exit 3" ] ] ];
+            
+            [ SKShell currentShell ].recording = recording;
+            
+            [ [ SKShell currentShell ] runCommand: @"echo $$" completion: ^( int status, NSString * output, NSString * error )
+                {
+                    ( void )error;
+                    
+                    assert( status == 0 );
+                    
+                    recorded = output;
+                }
+            ];
+            
+            assert( ( [ group run ] == NO ) );
+            assert( ( [ recording save ] ) );
+            assert( ( recording.numberOfRuns == 3 ) );
+            
+            recording           = [ SKRecording recordingFromPath: path ];
+            recording.timeScale = 0;
+            start               = [ NSDate date ];
+            
+            assert( ( recording != nil ) );
+            
+            [ SKShell currentShell ].recording = recording;
+            
+            [ [ SKShell currentShell ] runCommand: @"echo $$" completion: ^( int status, NSString * output, NSString * error )
+                {
+                    ( void )error;
+                    
+                    assert( status == 0 );
+                    
+                    replayed = output;
+                }
+            ];
+            
+            assert( ( [ group run ] == NO ) );
+            assert( ( [ [ SKShell currentShell ] runCommand: @"true" ] == NO ) );
+            assert( ( [ recorded isEqualToString: replayed ] ) );
+            assert( ( [ start timeIntervalSinceNow ] > -1 ) );
+            
+            [ SKShell currentShell ].recording = nil;
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: path error: NULL ];
+        }
+        
+        PrintStep( @"Task graph files" );
+        
+        {
+            SKTaskGraph * graph;
+            NSString    * dir;
+            NSString    * path;
+            NSString    * source;
+            NSString    * output;
+            NSError     * error;
+            id            cache;
+            
+            dir  = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            path = [ dir stringByAppendingPathComponent: @"build.tasks" ];
+            
+            [ [ NSFileManager defaultManager ] createDirectoryAtPath: dir withIntermediateDirectories: YES attributes: nil error: NULL ];
+            
+            source = @"var DIR\n"
+                      "var NAME = graph\n"
+                      "\n"
+                      "group Build\n"
+                      "    parallel\n"
+                      "    task echo %{NAME}%-b >> %{DIR}%/out\n"
+                      "        id b\n"
+                      "        after a\n"
+                      "    task echo %{NAME}%-a >> %{DIR}%/out\n"
+                      "        id a\n"
+                      "    task false\n"
+                      "        after b\n"
+                      "        recover echo recovered >> %{DIR}%/out\n"
+                      "end\n";
+            
+            [ source writeToFile: path atomically: YES encoding: NSUTF8StringEncoding error: NULL ];
+            
+            error = nil;
+            graph = [ SKTaskGraph taskGraphWithContentsOfFile: path error: &error ];
+            
+            assert( ( graph != nil && error == nil ) );
+            assert( ( graph.loadedFromCache == NO ) );
+            assert( ( [ graph.requiredVariables isEqualToArray: @[ @"DIR" ] ] ) );
+            assert( ( [ graph run ] == NO ) );
+            assert( ( [ graph run: @{ @"DIR" : dir } ] ) );
+            
+            output = [ NSString stringWithContentsOfFile: [ dir stringByAppendingPathComponent: @"out" ] encoding: NSUTF8StringEncoding error: NULL ];
+            graph  = [ SKTaskGraph taskGraphWithContentsOfFile: path error: NULL ];
+            
+            assert( ( [ output isEqualToString: @"graph-a\ngraph-b\nrecovered\n" ] ) );
+            assert( ( graph.loadedFromCache ) );
+            assert( ( graph.taskGroup.tasks.count == 1 ) );
+            
+            /* Damaged caches are ignored */
+            cache = [ NSPropertyListSerialization propertyListWithData: ( NSData * )[ NSData dataWithContentsOfFile: [ path stringByAppendingPathExtension: @"cache" ] ] options: NSPropertyListMutableContainers format: NULL error: NULL ];
+            
+            assert( ( [ cache[ @"root" ][ @"tasks" ] count ] == 1 ) );
+            
+            cache[ @"root" ][ @"tasks" ][ 0 ][ @"tasks" ] = [ NSMutableArray arrayWithObject: @"invalid" ];
+            
+            [ [ NSPropertyListSerialization dataWithPropertyList: cache format: NSPropertyListBinaryFormat_v1_0 options: 0 error: NULL ] writeToFile: [ path stringByAppendingPathExtension: @"cache" ] atomically: YES ];
+            
+            graph = [ SKTaskGraph taskGraphWithContentsOfFile: path error: NULL ];
+            
+            assert( ( graph != nil && graph.loadedFromCache == NO ) );
+            assert( ( graph.taskGroup.tasks.count == 1 ) );
+            
+            [ @"task true\n    id a\nbarrier\ntask true\n    after a\n" writeToFile: path atomically: YES encoding: NSUTF8StringEncoding error: NULL ];
+            
+            graph = [ SKTaskGraph taskGraphWithContentsOfFile: path error: &error ];
+            
+            assert( ( graph == nil ) );
+            assert( ( [ error.localizedDescription rangeOfString: @"line 3" ].location != NSNotFound ) );
+            
+            [ @"task echo %{UNDECLARED}%\n" writeToFile: path atomically: YES encoding: NSUTF8StringEncoding error: NULL ];
+            
+            graph = [ SKTaskGraph taskGraphWithContentsOfFile: path error: &error ];
+            
+            assert( ( graph == nil ) );
+            assert( ( [ error.localizedDescription rangeOfString: @"line 1" ].location != NSNotFound ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: dir error: NULL ];
+        }
+        
+        PrintStep( @"Asynchronous runs" );
+        
+        {
+            SKFuture                     * future;
+            SKFuture                     * slow;
+            SKTask                       * task;
+            SKTaskGroup                  * group;
+            NSMutableArray< SKFuture * > * futures;
+            NSDate                       * start;
+            NSUInteger                     i;
+            
+            task = [ SKTask taskWithShellScript: @"false" recoverTask: [ SKTask taskWithShellScript: @"true" ] ];
+            
+            assert( ( [ [ SKFuture futureByRunning: [ SKTask taskWithShellScript: @"true" ] variables: nil ] wait ] ) );
+            assert( ( [ [ SKFuture futureByRunning: [ SKTask taskWithShellScript: @"false" ] variables: nil ] wait ] == NO ) );
+            assert( ( [ [ [ SKOptionalTask taskWithShellScript: @"false" ] runAsynchronously: nil ] wait ] ) );
+            assert( ( [ [ task runAsynchronously: nil ] wait ] ) );
+            
+            future = [ [ [ SKFuture futureByRunning: [ SKTask taskWithShellScript: @"false" ] variables: nil ] thenRun: [ SKTask taskWithShellScript: @"false" ] variables: nil ] otherwise: ^ SKFuture * ( NSError * _Nullable error )
+                {
+                    assert( error != nil );
+                    
+                    return [ SKFuture succeededFuture ];
+                }
+            ];
+            
+            assert( ( [ future wait ] ) );
+            
+            /* Processes are waited for by dispatch sources, not by a thread each */
+            futures = [ NSMutableArray new ];
+            start   = [ NSDate date ];
+            
+            for( i = 0; i < 100; i++ )
+            {
+                [ futures addObject: [ [ SKTask taskWithShellScript: @"sleep 1" ] runAsynchronously: nil ] ];
+            }
+            
+            assert( ( [ [ SKFuture all: futures ] wait ] ) );
+            assert( ( [ start timeIntervalSinceNow ] > -10 ) );
+            
+            start  = [ NSDate date ];
+            slow   = [ [ SKTask taskWithShellScript: @"sleep 30" ] runAsynchronously: nil ];
+            future = [ SKFuture race: @[ slow, [ [ SKTask taskWithShellScript: @"true" ] runAsynchronously: nil ] ] ];
+            
+            assert( ( [ future wait ] ) );
+            assert( ( [ slow wait ] == NO && slow.state == SKFutureStateCancelled ) );
+            assert( ( [ start timeIntervalSinceNow ] > -10 ) );
+            
+            future = [ SKFuture any: @[ [ [ SKTask taskWithShellScript: @"false" ] runAsynchronously: nil ], [ [ SKTask taskWithShellScript: @"true" ] runAsynchronously: nil ] ] ];
+            
+            assert( ( [ future wait ] ) );
+            
+            future = [ SKFuture all: @[ [ [ SKTask taskWithShellScript: @"false" ] runAsynchronously: nil ], [ [ SKTask taskWithShellScript: @"sleep 30" ] runAsynchronously: nil ] ] ];
+            
+            assert( ( [ future wait ] == NO && future.state == SKFutureStateFailed ) );
+            assert( ( [ start timeIntervalSinceNow ] > -10 ) );
+            
+            future = [ [ SKTask taskWithShellScript: @"sleep 30" ] runAsynchronously: nil ];
+            
+            [ future cancel ];
+            
+            assert( ( [ future wait ] == NO && future.state == SKFutureStateCancelled ) );
+            assert( ( [ start timeIntervalSinceNow ] > -10 ) );
+            
+            group = [ SKTaskGroup taskGroupWithName: @"Async" tasks: @[ [ SKTask taskWithShellScript: @"true" ], [ SKOptionalTask taskWithShellScript: @"false" ], [ SKTask taskWithShellScript: @"true" ] ] ];
+            
+            assert( ( [ [ group runAsynchronously: nil ] wait ] ) );
+            
+            group.concurrencyLimiter = [ SKConcurrencyLimiter new ];
+            
+            assert( ( [ [ group runAsynchronously: nil ] wait ] ) );
+            
+            group = [ SKTaskGroup taskGroupWithName: @"Async" tasks: @[ [ SKTask taskWithShellScript: @"false" ], [ SKTask taskWithShellScript: @"true" ] ] ];
+            
+            assert( ( [ [ group runAsynchronously: nil ] wait ] == NO ) );
+            assert( ( group.error != nil ) );
+        }
+        
+        PrintStep( @"Task group watch mode" );
+        
+        {
+            SKTask               * t1;
+            SKTask               * t2;
+            SKTask               * t3;
+            SKTaskGroup          * group;
+            NSString             * dir;
+            dispatch_semaphore_t   done;
+            
+            dir = [ NSTemporaryDirectory() stringByAppendingPathComponent: [ NSUUID UUID ].UUIDString ];
+            
+            [ [ NSFileManager defaultManager ] createDirectoryAtPath: dir withIntermediateDirectories: YES attributes: nil error: NULL ];
+            [ @"a" writeToFile: [ dir stringByAppendingPathComponent: @"a.txt" ] atomically: NO encoding: NSUTF8StringEncoding error: NULL ];
+            [ @"b" writeToFile: [ dir stringByAppendingPathComponent: @"b.txt" ] atomically: NO encoding: NSUTF8StringEncoding error: NULL ];
+            [ @"c" writeToFile: [ dir stringByAppendingPathComponent: @"c.txt" ] atomically: NO encoding: NSUTF8StringEncoding error: NULL ];
+            
+            t1        = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"echo 1 >> '%@/a.log'", dir ] ];
+            t1.inputs = @[ [ dir stringByAppendingPathComponent: @"a.tx?" ] ];
+            t2        = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"echo 1 >> '%@/b.log'", dir ] ];
+            t2.inputs = @[ [ dir stringByAppendingPathComponent: @"b.txt" ] ];
+            t3        = [ SKTask taskWithShellScript: [ NSString stringWithFormat: @"echo 1 >> '%@/c.log'", dir ] ];
+            t3.inputs = @[ [ dir stringByAppendingPathComponent: @"c.txt" ] ];
+            group     = [ SKTaskGroup taskGroupWithName: @"group" tasks: @[ t1, t2, t3 ] ];
+            done      = dispatch_semaphore_create( 0 );
+            
+            dispatch_async
+            (
+                dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+                ^( void )
+                {
+                    assert( ( [ group watch: nil ] == YES ) );
+                    dispatch_semaphore_signal( done );
+                }
+            );
+            
+            [ NSThread sleepForTimeInterval: 2 ];
+            [ @"bb" writeToFile: [ dir stringByAppendingPathComponent: @"b.txt" ] atomically: NO encoding: NSUTF8StringEncoding error: NULL ];
+            [ NSThread sleepForTimeInterval: 3 ];
+            [ group stopWatching ];
+            
+            dispatch_semaphore_wait( done, DISPATCH_TIME_FOREVER );
+            
+            assert( ( [ [ NSString stringWithContentsOfFile: [ dir stringByAppendingPathComponent: @"a.log" ] encoding: NSUTF8StringEncoding error: NULL ] isEqualToString: @"1\n" ] ) );
+            assert( ( [ [ NSString stringWithContentsOfFile: [ dir stringByAppendingPathComponent: @"b.log" ] encoding: NSUTF8StringEncoding error: NULL ] isEqualToString: @"1\n1\n" ] ) );
+            
+            /* The last task has unchanged inputs, but may consume the outputs of the second one */
+            assert( ( [ [ NSString stringWithContentsOfFile: [ dir stringByAppendingPathComponent: @"c.log" ] encoding: NSUTF8StringEncoding error: NULL ] isEqualToString: @"1\n1\n" ] ) );
+            
+            [ [ NSFileManager defaultManager ] removeItemAtPath: dir error: NULL ];
+        }
+        
+        PrintStep( @"Task environment" );
+        
+        {
+            SKTask * task;
+            
+            setenv( "SK_TEST_VARIABLE", "1", 1 );
+            
+            task             = [ SKTask taskWithShellScript: @"[ \"$FOO\" = \"bar\" ] && [ -z \"$SK_TEST_VARIABLE\" ]" ];
+            task.environment = [ SKEnvironment environmentWithBase: SKEnvironmentBaseMinimal overrides: @{ @"FOO" : @"bar" } ];
+            
+            assert( ( [ task run ] == YES ) );
+            
+            /* Without an explicit environment, changes made with setenv() are seen */
+            task = [ SKTask taskWithShellScript: @"[ \"$SK_TEST_VARIABLE\" = \"1\" ]" ];
+            
+            assert( ( [ task run ] == YES ) );
+            
+            unsetenv( "SK_TEST_VARIABLE" );
+        }
+        
+        PrintStep( @"Environment differences" );
+        
+        {
+            SKEnvironment                  * e1;
+            SKEnvironment                  * e2;
+            NSDictionary< NSString *, id > * diff;
+            
+            e1   = [ SKEnvironment environmentWithBase: SKEnvironmentBaseEmpty overrides: @{ @"FOO" : @"foo", @"BAR" : @"bar" } ];
+            e2   = [ e1 environmentByAddingVariables: @{ @"FOO" : @"baz", @"BAZ" : @"baz" } ];
+            diff = [ e1 differencesFromEnvironment: e2 ];
+            
+            assert( ( [ e1 isEqual: [ SKEnvironment environmentWithBase: SKEnvironmentBaseEmpty overrides: @{ @"BAR" : @"bar", @"FOO" : @"foo" } ] ] ) );
+            assert( ( diff.count == 2 ) );
+            assert( ( [ diff[ @"FOO" ] isEqual: @"foo" ] ) );
+            assert( ( [ diff[ @"BAZ" ] isEqual: [ NSNull null ] ] ) );
+            assert( ( strcmp( e1.environmentBlock[ 0 ], "BAR=bar" ) == 0 ) );
+            assert( ( strcmp( e1.environmentBlock[ 1 ], "FOO=foo" ) == 0 ) );
+            assert( ( e1.environmentBlock[ 2 ] == NULL ) );
+        }
+        
         PrintStep( @"Task arguments" );
         
         {
@@ -263,6 +1275,22 @@ int main( void )
             assert( ( [ task run: @{ @"hello" : @"hello, world" } ] == NO ) );
         }
         
+        PrintStep( @"Task arguments substitution" );
+        
+        {
+            SKTask * task;
+            
+            task = [ SKTask taskWithShellScript: @"echo %{foo}% %{bar}%" ];
+            
+            assert( ( [ [ task scriptWithVariables: @{ @"foo" : @"100%", @"bar" : @"%{ bar }%" } ] isEqualToString: @"echo 100% %{ bar }%" ] ) );
+            assert( ( [ task scriptWithVariables: @{ @"foo" : @"foo" } ] == nil ) );
+            
+            /* Names are not restricted to alphanumeric characters */
+            task = [ SKTask taskWithShellScript: @"printf '%{'; echo %{my_var}% %{my var}%" ];
+            
+            assert( ( [ [ task scriptWithVariables: @{ @"my_var" : @"foo", @"my var" : @"bar" } ] isEqualToString: @"printf '%{'; echo foo bar" ] ) );
+        }
+        
         PrintStep( @"Task delegate" );
         
         {
@@ -274,6 +1302,25 @@ int main( void )
             task.delegate = delegate;
             
             assert( ( [ task run ] == YES ) );
+            assert( delegate.outputLength > 0 );
+            
+            /* Output larger than the pipe buffer must not block the task */
+            task           = [ SKTask taskWithShellScript: @"head -c 262144 /dev/zero" ];
+            delegate       = [ TaskDelegate new ];
+            delegate.quiet = YES;
+            task.delegate  = delegate;
+            
+            assert( ( [ task run ] == YES ) );
+            assert( delegate.outputLength == 262144 );
+            
+            /* Characters split across chunks of output must be kept */
+            task           = [ SKTask taskWithShellScript: @"printf '\\303'; sleep 0.2; printf '\\251\\377'" ];
+            delegate       = [ TaskDelegate new ];
+            delegate.quiet = YES;
+            task.delegate  = delegate;
+            
+            assert( ( [ task run ] == YES ) );
+            assert( delegate.outputLength == 5 );
             
             task.delegate = nil;
         }
@@ -305,6 +1352,16 @@ int main( void )
 {
     ( void )task;
     
+    @synchronized( self )
+    {
+        self.outputLength += [ output lengthOfBytesUsingEncoding: NSUTF8StringEncoding ];
+    }
+    
+    if( self.quiet )
+    {
+        return;
+    }
+    
     if( type == SKTaskOutputTypeStandardOutput )
     {
         fprintf( stdout, "%s", output.UTF8String );
@@ -88,8 +88,8 @@
 {
     if
     (
-           [ SKShell currentShell ].supportsColors == NO
-        || [ SKShell currentShell ].colorsEnabled  == NO
+           [ SKShell currentShell ].colorsEnabled  == NO
+        || [ SKShell currentShell ].supportsColors == NO
     )
     {
         return @"";
@@ -118,7 +118,7 @@
         return @"";
     }
     
-    if( [ SKShell currentShell ].supportsColors == NO )
+    if( [ SKShell currentShell ].colorsEnabled == NO || [ SKShell currentShell ].supportsColors == NO )
     {
         return [ self copy ];
     }
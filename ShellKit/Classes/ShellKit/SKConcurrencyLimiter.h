@@ -0,0 +1,151 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKConcurrencyLimiter.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @class       SKConcurrencyLimiter
+ * @abstract    Limits the number of concurrent jobs, based on the host's load
+ * @discussion  Jobs acquire slots before running, and release them when
+ *              done. The number of available slots is adjusted while jobs
+ *              are running, from the system load average, the available
+ *              memory (`MemAvailable`, on Linux) and the resident memory
+ *              of the child processes:
+ *              
+ *              - When the available memory falls below the reserve, the
+ *                limit is halved, before the host starts swapping.
+ *              - When the load average exceeds the target load, the limit
+ *                is decreased by one.
+ *              - When jobs are waiting, and the load average is below 75%
+ *                of the target load, the limit is increased by one, as
+ *                long as the memory used by a job, on average, fits in
+ *                the available memory.
+ *              
+ *              The limit changes at most once per sample interval, as the
+ *              load average reacts slowly to new jobs.
+ *              A job may need several slots. A job is always admitted when
+ *              no other job is running, even if it needs more slots than
+ *              the current limit.
+ */
+@interface SKConcurrencyLimiter: SKObject
+
+/*!
+ * @property    minimumLimit
+ * @abstract    The minimum number of slots
+ * @discussion  Defaults to 1.
+ */
+@property( atomic, readwrite, assign ) NSUInteger minimumLimit;
+
+/*!
+ * @property    maximumLimit
+ * @abstract    The maximum number of slots
+ * @discussion  Defaults to twice the number of active processors.
+ */
+@property( atomic, readwrite, assign ) NSUInteger maximumLimit;
+
+/*!
+ * @property    targetLoad
+ * @abstract    The load average the limiter aims for
+ * @discussion  Defaults to the number of active processors.
+ */
+@property( atomic, readwrite, assign ) double targetLoad;
+
+/*!
+ * @property    memoryReserve
+ * @abstract    The amount of memory to keep available, in bytes
+ * @discussion  Defaults to 10% of the physical memory.
+ */
+@property( atomic, readwrite, assign ) uint64_t memoryReserve;
+
+/*!
+ * @property    sampleInterval
+ * @abstract    The time between two adjustments of the limit
+ * @discussion  Defaults to 1 second.
+ */
+@property( atomic, readwrite, assign ) NSTimeInterval sampleInterval;
+
+/*!
+ * @property    limit
+ * @abstract    The current number of slots
+ * @discussion  Starts at the number of active processors, bounded by the
+ *              minimum and maximum limits.
+ */
+@property( atomic, readonly ) NSUInteger limit;
+
+/*!
+ * @property    slotsInUse
+ * @abstract    The number of slots currently acquired
+ */
+@property( atomic, readonly ) NSUInteger slotsInUse;
+
+/*!
+ * @method      sharedLimiter
+ * @abstract    Gets a limiter shared by the whole process
+ * @result      The shared limiter
+ */
++ ( instancetype )sharedLimiter;
+
+/*!
+ * @method      acquireSlots:
+ * @abstract    Waits for slots to be available, and acquires them
+ * @discussion  Acquired slots must be released with `releaseSlots:`.
+ * @param       slots   The number of slots needed by the job (at least 1)
+ * @see         releaseSlots:
+ */
+- ( void )acquireSlots: ( NSUInteger )slots;
+
+/*!
+ * @method      acquireSlots:handler:
+ * @abstract    Acquires slots without blocking the calling thread
+ * @discussion  Requests are served in order. A single thread waits for
+ *              slots on behalf of all the asynchronous requests of the
+ *              limiter, and the handler is called on a global queue once
+ *              the slots have been acquired.
+ *              A request for zero slots doesn't acquire anything, but still
+ *              waits for the requests made before it.
+ * @param       slots   The number of slots needed by the job
+ * @param       handler The block to call once the slots have been acquired
+ * @see         releaseSlots:
+ */
+- ( void )acquireSlots: ( NSUInteger )slots handler: ( void ( ^ )( void ) )handler;
+
+/*!
+ * @method      releaseSlots:
+ * @abstract    Releases slots, so waiting jobs may run
+ * @param       slots   The number of slots to release, as passed to `acquireSlots:`
+ * @see         acquireSlots:
+ */
+- ( void )releaseSlots: ( NSUInteger )slots;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,383 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKConcurrencyLimiter.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import <stdio.h>
+#import <stdlib.h>
+#import <string.h>
+#import <unistd.h>
+
+#if defined( __linux__ )
+#import <dirent.h>
+
+typedef struct
+{
+    pid_t    pid;
+    pid_t    ppid;
+    uint64_t resident;
+}
+SKProcessMemory;
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKConcurrencyLimiter()
+
+@property( atomic, readwrite, assign           ) NSUInteger         limit;
+@property( atomic, readwrite, assign           ) NSUInteger         slotsInUse;
+@property( atomic, readwrite, assign           ) NSUInteger         waitingSlots;
+@property( atomic, readwrite, strong           ) NSCondition      * condition;
+@property( atomic, readwrite, strong, nullable ) NSDate           * lastSample;
+@property( atomic, readwrite, strong           ) dispatch_queue_t   admissionQueue;
+
++ ( double )loadAverage;
++ ( uint64_t )availableMemory;
++ ( uint64_t )residentMemoryOfChildren;
+
+- ( void )sample;
+- ( NSUInteger )clampedLimit: ( NSUInteger )limit;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKConcurrencyLimiter
+
++ ( instancetype )sharedLimiter
+{
+    static dispatch_once_t once;
+    static id              instance;
+    
+    dispatch_once
+    (
+        &once,
+        ^( void )
+        {
+            instance = [ self new ];
+        }
+    );
+    
+    return instance;
+}
+
+- ( instancetype )init
+{
+    NSUInteger cpus;
+    
+    if( ( self = [ super init ] ) )
+    {
+        cpus                = MAX( [ NSProcessInfo processInfo ].activeProcessorCount, ( NSUInteger )1 );
+        self.minimumLimit   = 1;
+        self.maximumLimit   = cpus * 2;
+        self.targetLoad     = ( double )cpus;
+        self.memoryReserve  = [ NSProcessInfo processInfo ].physicalMemory / 10;
+        self.sampleInterval = 1;
+        self.limit          = cpus;
+        self.condition      = [ NSCondition new ];
+        self.admissionQueue = dispatch_queue_create( "com.xs-labs.ShellKit.SKConcurrencyLimiter.Admission", DISPATCH_QUEUE_SERIAL );
+    }
+    
+    return self;
+}
+
+- ( void )acquireSlots: ( NSUInteger )slots
+{
+    NSDate * last;
+    
+    slots = MAX( slots, ( NSUInteger )1 );
+    
+    [ self.condition lock ];
+    
+    self.waitingSlots += slots;
+    
+    while( 1 )
+    {
+        last = self.lastSample;
+        
+        /* Sampling may scan all processes, so it's done without holding the lock, by one job at a time */
+        if( last == nil || -[ last timeIntervalSinceNow ] >= self.sampleInterval )
+        {
+            self.lastSample = [ NSDate date ];
+            
+            [ self.condition unlock ];
+            [ self sample ];
+            [ self.condition lock ];
+        }
+        
+        if( self.slotsInUse == 0 || self.slotsInUse + slots <= self.limit )
+        {
+            break;
+        }
+        
+        /* Waiting jobs wake up on releases, and periodically to resample */
+        [ self.condition waitUntilDate: [ NSDate dateWithTimeIntervalSinceNow: MAX( self.sampleInterval, 0.05 ) ] ];
+    }
+    
+    self.waitingSlots -= slots;
+    self.slotsInUse   += slots;
+    
+    [ self.condition unlock ];
+}
+
+- ( void )acquireSlots: ( NSUInteger )slots handler: ( void ( ^ )( void ) )handler
+{
+    /* Requests wait for slots on a serial queue, so they're admitted in order, without blocking workers */
+    dispatch_async
+    (
+        self.admissionQueue,
+        ^( void )
+        {
+            if( slots > 0 )
+            {
+                [ self acquireSlots: slots ];
+            }
+            
+            dispatch_async( dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ), handler );
+        }
+    );
+}
+
+- ( void )releaseSlots: ( NSUInteger )slots
+{
+    slots = MAX( slots, ( NSUInteger )1 );
+    
+    [ self.condition lock ];
+    
+    self.slotsInUse = ( slots < self.slotsInUse ) ? self.slotsInUse - slots : 0;
+    
+    [ self.condition broadcast ];
+    [ self.condition unlock ];
+}
+
+#pragma mark - Private
+
++ ( double )loadAverage
+{
+    double load;
+    
+    if( getloadavg( &load, 1 ) != 1 )
+    {
+        return 0;
+    }
+    
+    return load;
+}
+
++ ( uint64_t )availableMemory
+{
+    uint64_t available;
+    
+    available = 0;
+
+#if defined( __linux__ )
+    
+    {
+        FILE               * fp;
+        char                 line[ 256 ];
+        unsigned long long   kb;
+        
+        fp = fopen( "/proc/meminfo", "r" );
+        
+        if( fp != NULL )
+        {
+            while( fgets( line, sizeof( line ), fp ) != NULL )
+            {
+                if( sscanf( line, "MemAvailable: %llu kB", &kb ) == 1 )
+                {
+                    available = ( uint64_t )kb * 1024;
+                    
+                    break;
+                }
+            }
+            
+            fclose( fp );
+        }
+    }
+
+#endif
+    
+    return available;
+}
+
++ ( uint64_t )residentMemoryOfChildren
+{
+    uint64_t resident;
+    
+    resident = 0;
+
+#if defined( __linux__ )
+    
+    {
+        DIR                 * dir;
+        struct dirent       * entry;
+        FILE                * fp;
+        char                  path[ 64 ];
+        char                  stat[ 512 ];
+        char                * p;
+        NSMutableData       * entries;
+        NSMutableIndexSet   * descendants;
+        SKProcessMemory     * values;
+        SKProcessMemory       process;
+        long                  rss;
+        int                   ppid;
+        NSUInteger            count;
+        NSUInteger            i;
+        BOOL                  changed;
+        
+        dir = opendir( "/proc" );
+        
+        if( dir == NULL )
+        {
+            return 0;
+        }
+        
+        /* PID, parent PID and resident memory of all processes */
+        entries = [ NSMutableData new ];
+        
+        while( ( entry = readdir( dir ) ) != NULL )
+        {
+            if( entry->d_name[ 0 ] < '1' || entry->d_name[ 0 ] > '9' )
+            {
+                continue;
+            }
+            
+            snprintf( path, sizeof( path ), "/proc/%s/stat", entry->d_name );
+            
+            fp = fopen( path, "r" );
+            
+            if( fp == NULL )
+            {
+                continue;
+            }
+            
+            p = fgets( stat, sizeof( stat ), fp );
+            
+            fclose( fp );
+            
+            /* The command name may contain spaces and parenthesis */
+            if( p == NULL || ( p = strrchr( stat, ')' ) ) == NULL )
+            {
+                continue;
+            }
+            
+            if( sscanf( p + 1, " %*c %d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u %*d %*d %*d %*d %*d %*d %*u %*u %ld", &ppid, &rss ) != 2 )
+            {
+                continue;
+            }
+            
+            process.pid      = ( pid_t )atoi( entry->d_name );
+            process.ppid     = ( pid_t )ppid;
+            process.resident = ( rss > 0 ) ? ( uint64_t )rss * ( uint64_t )sysconf( _SC_PAGESIZE ) : 0;
+            
+            [ entries appendBytes: &process length: sizeof( SKProcessMemory ) ];
+        }
+        
+        closedir( dir );
+        
+        values      = ( SKProcessMemory * )( entries.mutableBytes );
+        count       = entries.length / sizeof( SKProcessMemory );
+        descendants = [ NSMutableIndexSet indexSetWithIndex: ( NSUInteger )getpid() ];
+        changed     = YES;
+        
+        while( changed )
+        {
+            changed = NO;
+            
+            for( i = 0; i < count; i++ )
+            {
+                if( [ descendants containsIndex: ( NSUInteger )( values[ i ].pid ) ] == NO && [ descendants containsIndex: ( NSUInteger )( values[ i ].ppid ) ] )
+                {
+                    [ descendants addIndex: ( NSUInteger )( values[ i ].pid ) ];
+                    
+                    resident += values[ i ].resident;
+                    changed   = YES;
+                }
+            }
+        }
+    }
+
+#endif
+    
+    return resident;
+}
+
+- ( void )sample
+{
+    double     load;
+    uint64_t   available;
+    uint64_t   resident;
+    uint64_t   reserve;
+    NSUInteger limit;
+    
+    load      = [ SKConcurrencyLimiter loadAverage ];
+    available = [ SKConcurrencyLimiter availableMemory ];
+    resident  = ( available > 0 && self.slotsInUse > 0 ) ? [ SKConcurrencyLimiter residentMemoryOfChildren ] : 0;
+    reserve   = self.memoryReserve;
+    
+    /* Only the new limit is computed and published under the lock */
+    [ self.condition lock ];
+    
+    limit = self.limit;
+    
+    if( available > 0 && available < reserve )
+    {
+        /* Backs off quickly, before the host starts swapping */
+        limit /= 2;
+    }
+    else if( load > self.targetLoad )
+    {
+        limit = ( limit > 0 ) ? limit - 1 : 0;
+    }
+    else if( self.slotsInUse + self.waitingSlots > limit && load < self.targetLoad * 0.75 )
+    {
+        /* Ramps up only if one more job is expected to fit in memory */
+        if( resident == 0 || self.slotsInUse == 0 || resident / self.slotsInUse <= available - reserve )
+        {
+            limit++;
+        }
+    }
+    
+    self.limit = [ self clampedLimit: limit ];
+    
+    [ self.condition broadcast ];
+    [ self.condition unlock ];
+}
+
+- ( NSUInteger )clampedLimit: ( NSUInteger )limit
+{
+    NSUInteger minimum;
+    NSUInteger maximum;
+    
+    minimum = MAX( self.minimumLimit, ( NSUInteger )1 );
+    maximum = MAX( self.maximumLimit, minimum );
+    
+    return MIN( MAX( limit, minimum ), maximum );
+}
+
+@end
@@ -0,0 +1,133 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKEnvironment.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKEnvironmentBase
+ * @abstract    The base variables of an environment, before overrides
+ */
+typedef NS_ENUM( NSInteger, SKEnvironmentBase )
+{
+    SKEnvironmentBaseInherited, /*! All variables of the current process */
+    SKEnvironmentBaseMinimal,   /*! Only `HOME`, `LANG`, `LOGNAME`, `PATH`, `SHELL`, `TERM`, `TMPDIR` and `USER`, from the current process */
+    SKEnvironmentBaseEmpty      /*! No variable */
+};
+
+/*!
+ * @class       SKEnvironment
+ * @abstract    An immutable set of environment variables for spawned processes
+ * @discussion  The variables are resolved once, when the environment is
+ *              created, and are then converted only once to the
+ *              `KEY=VALUE` block passed to spawned processes, so the same
+ *              environment object can be reused across spawns at no cost.
+ *              Variables are sorted by name, so equal environments always
+ *              produce identical blocks.
+ */
+@interface SKEnvironment: SKObject < NSCopying >
+
+/*!
+ * @property    base
+ * @abstract    The base variables of the environment
+ */
+@property( atomic, readonly ) SKEnvironmentBase base;
+
+/*!
+ * @property    overrides
+ * @abstract    The variables set on top of the base variables
+ */
+@property( atomic, readonly ) NSDictionary< NSString *, NSString * > * overrides;
+
+/*!
+ * @property    variables
+ * @abstract    All the variables of the environment
+ */
+@property( atomic, readonly ) NSDictionary< NSString *, NSString * > * variables;
+
+/*!
+ * @method      inheritedEnvironment
+ * @abstract    Gets a shared environment, inheriting all variables of the current process
+ * @discussion  Variables are read the first time this method is called.
+ * @result      The environment object
+ */
++ ( instancetype )inheritedEnvironment;
+
+/*!
+ * @method      environmentWithBase:overrides:
+ * @abstract    Creates an environment object
+ * @param       base        The base variables
+ * @param       overrides   Optional variables to set on top of the base variables
+ * @result      The environment object
+ */
++ ( instancetype )environmentWithBase: ( SKEnvironmentBase )base overrides: ( nullable NSDictionary< NSString *, NSString * > * )overrides;
+
+/*!
+ * @method      initWithBase:overrides:
+ * @abstract    Creates an environment object
+ * @param       base        The base variables
+ * @param       overrides   Optional variables to set on top of the base variables
+ * @result      The environment object
+ */
+- ( instancetype )initWithBase: ( SKEnvironmentBase )base overrides: ( nullable NSDictionary< NSString *, NSString * > * )overrides NS_DESIGNATED_INITIALIZER;
+
+/*!
+ * @method      environmentByAddingVariables:
+ * @abstract    Creates a new environment, with additional overrides
+ * @param       variables   The variables to set
+ * @result      The new environment object
+ */
+- ( instancetype )environmentByAddingVariables: ( NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      differencesFromEnvironment:
+ * @abstract    Gets the variables that differ from another environment
+ * @discussion  Variables that are missing or have a different value in the
+ *              other environment are returned with their value.
+ *              Variables only present in the other environment are returned
+ *              with `NSNull` as value.
+ * @param       environment The environment to compare with
+ * @result      A dictionary of differing variables
+ */
+- ( NSDictionary< NSString *, id > * )differencesFromEnvironment: ( SKEnvironment * )environment;
+
+/*!
+ * @method      environmentBlock
+ * @abstract    Gets the `NULL` terminated array of `KEY=VALUE` strings
+ * @discussion  The array is built once, and remains valid for the lifetime
+ *              of the environment object.
+ * @result      The environment block, suitable for `posix_spawn` or `execve`
+ */
+- ( char * const * )environmentBlock NS_RETURNS_INNER_POINTER;
+
+@end
+
+NS_ASSUME_NONNULL_END
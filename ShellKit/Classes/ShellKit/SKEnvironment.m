@@ -0,0 +1,278 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKEnvironment.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import <stdlib.h>
+#import <string.h>
+
+extern char ** environ;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKEnvironment()
+
+@property( atomic, readwrite, assign ) SKEnvironmentBase                        base;
+@property( atomic, readwrite, strong ) NSDictionary< NSString *, NSString * > * overrides;
+@property( atomic, readwrite, strong ) NSDictionary< NSString *, NSString * > * variables;
+@property( atomic, readwrite, assign ) char                                   ** block;
+
++ ( NSDictionary< NSString *, NSString * > * )processVariables;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKEnvironment
+
++ ( instancetype )inheritedEnvironment
+{
+    static dispatch_once_t once;
+    static id              instance;
+    
+    dispatch_once
+    (
+        &once,
+        ^( void )
+        {
+            instance = [ [ self alloc ] initWithBase: SKEnvironmentBaseInherited overrides: nil ];
+        }
+    );
+    
+    return instance;
+}
+
++ ( instancetype )environmentWithBase: ( SKEnvironmentBase )base overrides: ( nullable NSDictionary< NSString *, NSString * > * )overrides
+{
+    return [ [ self alloc ] initWithBase: base overrides: overrides ];
+}
+
++ ( NSDictionary< NSString *, NSString * > * )processVariables
+{
+    NSMutableDictionary< NSString *, NSString * > * variables;
+    char                                         ** env;
+    char                                          * sep;
+    NSString                                      * key;
+    NSString                                      * value;
+    
+    variables = [ NSMutableDictionary new ];
+    
+    /* Reads environ directly, as NSProcessInfo may cache its environment */
+    for( env = environ; env != NULL && *( env ) != NULL; env++ )
+    {
+        sep = strchr( *( env ), '=' );
+        
+        if( sep == NULL || sep == *( env ) )
+        {
+            continue;
+        }
+        
+        key   = [ [ NSString alloc ] initWithBytes: *( env ) length: ( NSUInteger )( sep - *( env ) ) encoding: NSUTF8StringEncoding ];
+        value = [ [ NSString alloc ] initWithUTF8String: sep + 1 ];
+        
+        if( key != nil && value != nil )
+        {
+            variables[ key ] = value;
+        }
+    }
+    
+    return variables;
+}
+
+- ( instancetype )init
+{
+    return [ self initWithBase: SKEnvironmentBaseInherited overrides: nil ];
+}
+
+- ( instancetype )initWithBase: ( SKEnvironmentBase )base overrides: ( nullable NSDictionary< NSString *, NSString * > * )overrides
+{
+    NSDictionary< NSString *, NSString * >        * process;
+    NSMutableDictionary< NSString *, NSString * > * variables;
+    NSString                                      * key;
+    
+    if( ( self = [ super init ] ) )
+    {
+        self.base      = base;
+        self.overrides = ( overrides ) ? [ overrides copy ] : @{};
+        variables      = [ NSMutableDictionary new ];
+        
+        if( base == SKEnvironmentBaseInherited )
+        {
+            [ variables addEntriesFromDictionary: [ SKEnvironment processVariables ] ];
+        }
+        else if( base == SKEnvironmentBaseMinimal )
+        {
+            process = [ SKEnvironment processVariables ];
+            
+            for( key in @[ @"HOME", @"LANG", @"LOGNAME", @"PATH", @"SHELL", @"TERM", @"TMPDIR", @"USER" ] )
+            {
+                if( process[ key ] != nil )
+                {
+                    variables[ key ] = process[ key ];
+                }
+            }
+        }
+        
+        [ variables addEntriesFromDictionary: self.overrides ];
+        
+        self.variables = [ variables copy ];
+    }
+    
+    return self;
+}
+
+- ( void )dealloc
+{
+    char ** env;
+    
+    if( self.block == NULL )
+    {
+        return;
+    }
+    
+    for( env = self.block; *( env ) != NULL; env++ )
+    {
+        free( *( env ) );
+    }
+    
+    free( self.block );
+}
+
+- ( id )copyWithZone: ( nullable NSZone * )zone
+{
+    ( void )zone;
+    
+    return self;
+}
+
+- ( BOOL )isEqual: ( nullable id )object
+{
+    if( object == self )
+    {
+        return YES;
+    }
+    
+    if( [ object isKindOfClass: [ SKEnvironment class ] ] == NO )
+    {
+        return NO;
+    }
+    
+    return [ self.variables isEqualToDictionary: ( ( SKEnvironment * )object ).variables ];
+}
+
+- ( NSUInteger )hash
+{
+    return self.variables.hash;
+}
+
+- ( NSString * )description
+{
+    return [ NSString stringWithFormat: @"%@ %lu variables", [ super description ], ( unsigned long )( self.variables.count ) ];
+}
+
+- ( instancetype )environmentByAddingVariables: ( NSDictionary< NSString *, NSString * > * )variables
+{
+    NSMutableDictionary< NSString *, NSString * > * overrides;
+    
+    overrides = [ self.overrides mutableCopy ];
+    
+    [ overrides addEntriesFromDictionary: variables ];
+    
+    return [ [ [ self class ] alloc ] initWithBase: self.base overrides: overrides ];
+}
+
+- ( NSDictionary< NSString *, id > * )differencesFromEnvironment: ( SKEnvironment * )environment
+{
+    NSMutableDictionary< NSString *, id >   * differences;
+    NSDictionary< NSString *, NSString * >  * mine;
+    NSDictionary< NSString *, NSString * >  * theirs;
+    NSString                                * key;
+    
+    differences = [ NSMutableDictionary new ];
+    mine        = self.variables;
+    theirs      = environment.variables;
+    
+    for( key in mine )
+    {
+        if( [ theirs[ key ] isEqualToString: mine[ key ] ] == NO )
+        {
+            differences[ key ] = mine[ key ];
+        }
+    }
+    
+    for( key in theirs )
+    {
+        if( mine[ key ] == nil )
+        {
+            differences[ key ] = [ NSNull null ];
+        }
+    }
+    
+    return differences;
+}
+
+- ( char * const * )environmentBlock
+{
+    NSArray< NSString * > * keys;
+    NSString              * key;
+    char                 ** block;
+    NSUInteger              i;
+    
+    @synchronized( self )
+    {
+        if( self.block != NULL )
+        {
+            return self.block;
+        }
+        
+        keys  = [ self.variables.allKeys sortedArrayUsingSelector: @selector( compare: ) ];
+        block = calloc( keys.count + 1, sizeof( char * ) );
+        i     = 0;
+        
+        if( block == NULL )
+        {
+            return ( char * const * )environ;
+        }
+        
+        for( key in keys )
+        {
+            block[ i ] = strdup( [ NSString stringWithFormat: @"%@=%@", key, self.variables[ key ] ].UTF8String );
+            
+            if( block[ i ] != NULL )
+            {
+                i++;
+            }
+        }
+        
+        self.block = block;
+        
+        return block;
+    }
+}
+
+@end
@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKEventStream+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private SKEventStream interface, used to write events
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKEventStream.h>
+#import <ShellKit/SKTask.h>
+#import <ShellKit/SKTaskStatus.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKEventStream()
+
++ ( uint64_t )nextIdentifier;
+
+- ( void )writeTaskStart: ( uint64_t )identifier script: ( NSString * )script;
+- ( void )writeTaskOutput: ( uint64_t )identifier data: ( NSData * )data type: ( SKTaskOutputType )type;
+- ( void )writeTaskEnd: ( uint64_t )identifier state: ( SKTaskState )state status: ( int )status duration: ( NSTimeInterval )duration;
+- ( void )writeGroupStart: ( uint64_t )identifier name: ( NSString * )name;
+- ( void )writeGroupEnd: ( uint64_t )identifier name: ( NSString * )name state: ( SKTaskState )state duration: ( NSTimeInterval )duration;
+- ( void )writeWarning: ( NSString * )message;
+- ( void )writeError: ( NSString * )message;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,121 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKEventStream.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @class       SKEventStream
+ * @abstract    A machine-readable stream of execution events
+ * @discussion  When set as the event stream of the current shell, events
+ *              are written as JSON Lines (one JSON object per line), in
+ *              addition to the messages printed to the terminal.
+ *              
+ *              Each event has a `time` (seconds since 1970) and an
+ *              `event` key, which is one of:
+ *              
+ *              - `group_start`: `id`, `name`
+ *              - `group_end`: `id`, `name`, `state`, `duration`
+ *              - `task_start`: `id`, `script`
+ *              - `task_output`: `id`, `stream` (`stdout` or `stderr`),
+ *                `data`
+ *              - `task_end`: `id`, `state`, `status` (the exit status, or
+ *                null if no process has run), `duration`
+ *              - `warning`: `message`
+ *              - `error`: `message`
+ *              
+ *              `id` identifies a single run of a task or task group.
+ *              Output data is UTF-8, with invalid sequences replaced by
+ *              U+FFFD. Characters split across reads are kept whole, in
+ *              the next `task_output` event of the same stream.
+ *              `state` is one of `succeeded`, `failed` or `cancelled`.
+ *              
+ *              Events are encoded directly into a preallocated buffer.
+ *              The buffer is written when it is full, after each start
+ *              and end event, warning and error, and when `flush` is
+ *              called. Output events are written at most 50 milliseconds
+ *              after being produced.
+ */
+@interface SKEventStream: SKObject
+
+/*!
+ * @property    fileDescriptor
+ * @abstract    The file descriptor events are written to
+ */
+@property( atomic, readonly ) int fileDescriptor;
+
+/*!
+ * @method      eventStreamWithPath:
+ * @abstract    Creates an event stream writing to a file
+ * @discussion  The file is created if needed, and events are appended.
+ * @param       path    The path of the file
+ * @result      The event stream object, or nil if the file can't be opened
+ */
++ ( nullable instancetype )eventStreamWithPath: ( NSString * )path;
+
+/*!
+ * @method      eventStreamWithFileDescriptor:
+ * @abstract    Creates an event stream writing to a file descriptor
+ * @discussion  The file descriptor isn't closed by the stream.
+ * @param       fd      The file descriptor
+ * @result      The event stream object
+ */
++ ( instancetype )eventStreamWithFileDescriptor: ( int )fd;
+
+/*!
+ * @method      initWithPath:
+ * @abstract    Creates an event stream writing to a file
+ * @discussion  The file is created if needed, and events are appended.
+ * @param       path    The path of the file
+ * @result      The event stream object, or nil if the file can't be opened
+ */
+- ( nullable instancetype )initWithPath: ( NSString * )path;
+
+/*!
+ * @method      initWithFileDescriptor:closesOnDealloc:
+ * @abstract    Creates an event stream writing to a file descriptor
+ * @param       fd      The file descriptor
+ * @param       close   Whether to close the file descriptor when the stream is deallocated
+ * @result      The event stream object
+ */
+- ( instancetype )initWithFileDescriptor: ( int )fd closesOnDealloc: ( BOOL )close NS_DESIGNATED_INITIALIZER;
+
+- ( instancetype )init NS_UNAVAILABLE;
+
+/*!
+ * @method      flush
+ * @abstract    Writes the buffered events
+ */
+- ( void )flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,560 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKEventStream.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKEventStream+Private.h"
+#import "SKUTF8.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <stdatomic.h>
+#import <stdio.h>
+#import <stdlib.h>
+#import <string.h>
+#import <time.h>
+#import <unistd.h>
+
+#define SK_EVENT_STREAM_BUFFER_SIZE 65536
+
+/* Maximum time buffered output events wait before being written, in milliseconds */
+#define SK_EVENT_STREAM_FLUSH_DELAY 50
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKEventStream()
+
+@property( atomic, readwrite, assign ) int                                           fileDescriptor;
+@property( atomic, readwrite, assign ) BOOL                                          closesOnDealloc;
+@property( atomic, readwrite, strong ) NSMutableDictionary< NSNumber *, NSData * > * pendingOutput;
+@property( atomic, readwrite, strong ) NSMutableDictionary< NSNumber *, NSData * > * pendingError;
+
+- ( void )beginEvent: ( const char * )name identifier: ( uint64_t )identifier;
+- ( void )endEventAndFlush: ( BOOL )flush;
+- ( void )scheduleFlush;
+- ( void )appendKey: ( const char * )key;
+- ( void )appendCString: ( const char * )string;
+- ( void )appendBytes: ( const char * )bytes length: ( size_t )length;
+- ( void )appendJSONString: ( NSString * )string;
+- ( void )appendEscapedBytes: ( const uint8_t * )bytes length: ( size_t )length;
+- ( void )writeOutput: ( uint64_t )identifier bytes: ( const uint8_t * )bytes length: ( size_t )length type: ( SKTaskOutputType )type;
+- ( void )appendState: ( SKTaskState )state duration: ( NSTimeInterval )duration;
+- ( void )writeBuffer;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKEventStream
+{
+    char   * _buffer;
+    size_t   _length;
+    BOOL     _flushScheduled;
+}
+
++ ( uint64_t )nextIdentifier
+{
+    static atomic_uint_fast64_t identifier;
+    
+    return ( uint64_t )atomic_fetch_add_explicit( &identifier, 1, memory_order_relaxed ) + 1;
+}
+
++ ( nullable instancetype )eventStreamWithPath: ( NSString * )path
+{
+    return [ [ self alloc ] initWithPath: path ];
+}
+
++ ( instancetype )eventStreamWithFileDescriptor: ( int )fd
+{
+    return [ [ self alloc ] initWithFileDescriptor: fd closesOnDealloc: NO ];
+}
+
+- ( nullable instancetype )initWithPath: ( NSString * )path
+{
+    int fd;
+    
+    fd = open( path.fileSystemRepresentation, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644 );
+    
+    if( fd < 0 )
+    {
+        return nil;
+    }
+    
+    return [ self initWithFileDescriptor: fd closesOnDealloc: YES ];
+}
+
+- ( instancetype )initWithFileDescriptor: ( int )fd closesOnDealloc: ( BOOL )close
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.fileDescriptor  = fd;
+        self.closesOnDealloc = close;
+        self.pendingOutput   = [ NSMutableDictionary new ];
+        self.pendingError    = [ NSMutableDictionary new ];
+        _buffer              = malloc( SK_EVENT_STREAM_BUFFER_SIZE );
+        _length              = 0;
+        _flushScheduled      = NO;
+        
+        if( _buffer == NULL )
+        {
+            return nil;
+        }
+    }
+    
+    return self;
+}
+
+- ( void )dealloc
+{
+    [ self writeBuffer ];
+    
+    if( self.closesOnDealloc )
+    {
+        close( self.fileDescriptor );
+    }
+    
+    free( _buffer );
+}
+
+- ( void )flush
+{
+    @synchronized( self )
+    {
+        [ self writeBuffer ];
+    }
+}
+
+#pragma mark - Events
+
+- ( void )writeTaskStart: ( uint64_t )identifier script: ( NSString * )script
+{
+    @synchronized( self )
+    {
+        [ self beginEvent: "task_start" identifier: identifier ];
+        [ self appendKey: "script" ];
+        [ self appendJSONString: script ];
+        [ self endEventAndFlush: YES ];
+    }
+}
+
+- ( void )writeTaskOutput: ( uint64_t )identifier data: ( NSData * )data type: ( SKTaskOutputType )type
+{
+    NSMutableDictionary< NSNumber *, NSData * > * pendings;
+    NSData                                      * pending;
+    NSMutableData                               * bytes;
+    size_t                                        length;
+    
+    if( data.length == 0 )
+    {
+        return;
+    }
+    
+    @synchronized( self )
+    {
+        /* A multibyte character may be split across chunks of output */
+        pendings = ( type == SKTaskOutputTypeStandardError ) ? self.pendingError : self.pendingOutput;
+        pending  = pendings[ @( identifier ) ];
+        
+        if( pending != nil )
+        {
+            bytes = [ pending mutableCopy ];
+            
+            [ bytes appendData: data ];
+            
+            data = bytes;
+        }
+        
+        length = SKUTF8CompleteLength( data.bytes, data.length );
+        
+        if( length < data.length )
+        {
+            pendings[ @( identifier ) ] = [ data subdataWithRange: NSMakeRange( length, data.length - length ) ];
+        }
+        else
+        {
+            [ pendings removeObjectForKey: @( identifier ) ];
+        }
+        
+        if( length > 0 )
+        {
+            [ self writeOutput: identifier bytes: data.bytes length: length type: type ];
+        }
+    }
+}
+
+- ( void )writeTaskEnd: ( uint64_t )identifier state: ( SKTaskState )state status: ( int )status duration: ( NSTimeInterval )duration
+{
+    char     number[ 32 ];
+    NSData * output;
+    NSData * error;
+    
+    @synchronized( self )
+    {
+        output = self.pendingOutput[ @( identifier ) ];
+        error  = self.pendingError[ @( identifier ) ];
+        
+        /* Output ended within a multibyte character */
+        if( output != nil )
+        {
+            [ self.pendingOutput removeObjectForKey: @( identifier ) ];
+            [ self writeOutput: identifier bytes: output.bytes length: output.length type: SKTaskOutputTypeStandardOutput ];
+        }
+        
+        if( error != nil )
+        {
+            [ self.pendingError removeObjectForKey: @( identifier ) ];
+            [ self writeOutput: identifier bytes: error.bytes length: error.length type: SKTaskOutputTypeStandardError ];
+        }
+        
+        [ self beginEvent: "task_end" identifier: identifier ];
+        [ self appendState: state duration: duration ];
+        [ self appendKey: "status" ];
+        
+        if( status < 0 )
+        {
+            [ self appendCString: "null" ];
+        }
+        else
+        {
+            snprintf( number, sizeof( number ), "%i", status );
+            
+            [ self appendCString: number ];
+        }
+        
+        [ self endEventAndFlush: YES ];
+    }
+}
+
+- ( void )writeGroupStart: ( uint64_t )identifier name: ( NSString * )name
+{
+    @synchronized( self )
+    {
+        [ self beginEvent: "group_start" identifier: identifier ];
+        [ self appendKey: "name" ];
+        [ self appendJSONString: name ];
+        [ self endEventAndFlush: YES ];
+    }
+}
+
+- ( void )writeGroupEnd: ( uint64_t )identifier name: ( NSString * )name state: ( SKTaskState )state duration: ( NSTimeInterval )duration
+{
+    @synchronized( self )
+    {
+        [ self beginEvent: "group_end" identifier: identifier ];
+        [ self appendKey: "name" ];
+        [ self appendJSONString: name ];
+        [ self appendState: state duration: duration ];
+        [ self endEventAndFlush: YES ];
+    }
+}
+
+- ( void )writeWarning: ( NSString * )message
+{
+    @synchronized( self )
+    {
+        [ self beginEvent: "warning" identifier: 0 ];
+        [ self appendKey: "message" ];
+        [ self appendJSONString: message ];
+        [ self endEventAndFlush: YES ];
+    }
+}
+
+- ( void )writeError: ( NSString * )message
+{
+    @synchronized( self )
+    {
+        [ self beginEvent: "error" identifier: 0 ];
+        [ self appendKey: "message" ];
+        [ self appendJSONString: message ];
+        [ self endEventAndFlush: YES ];
+    }
+}
+
+#pragma mark - Private
+
+- ( void )writeOutput: ( uint64_t )identifier bytes: ( const uint8_t * )bytes length: ( size_t )length type: ( SKTaskOutputType )type
+{
+    [ self beginEvent: "task_output" identifier: identifier ];
+    [ self appendKey: "stream" ];
+    [ self appendCString: ( type == SKTaskOutputTypeStandardError ) ? "\"stderr\"" : "\"stdout\"" ];
+    [ self appendKey: "data" ];
+    [ self appendCString: "\"" ];
+    [ self appendEscapedBytes: bytes length: length ];
+    [ self appendCString: "\"" ];
+    [ self endEventAndFlush: NO ];
+}
+
+- ( void )beginEvent: ( const char * )name identifier: ( uint64_t )identifier
+{
+    struct timespec ts;
+    char            header[ 128 ];
+    
+    clock_gettime( CLOCK_REALTIME, &ts );
+    
+    if( identifier > 0 )
+    {
+        snprintf( header, sizeof( header ), "{\"time\":%lld.%06ld,\"event\":\"%s\",\"id\":%llu", ( long long )( ts.tv_sec ), ( long )( ts.tv_nsec / 1000 ), name, ( unsigned long long )identifier );
+    }
+    else
+    {
+        snprintf( header, sizeof( header ), "{\"time\":%lld.%06ld,\"event\":\"%s\"", ( long long )( ts.tv_sec ), ( long )( ts.tv_nsec / 1000 ), name );
+    }
+    
+    [ self appendCString: header ];
+}
+
+- ( void )endEventAndFlush: ( BOOL )flush
+{
+    [ self appendCString: "}\n" ];
+    
+    if( flush )
+    {
+        [ self writeBuffer ];
+    }
+    else
+    {
+        [ self scheduleFlush ];
+    }
+}
+
+- ( void )scheduleFlush
+{
+    if( _flushScheduled || _length == 0 )
+    {
+        return;
+    }
+    
+    _flushScheduled = YES;
+    
+    dispatch_after
+    (
+        dispatch_time( DISPATCH_TIME_NOW, ( int64_t )SK_EVENT_STREAM_FLUSH_DELAY * ( int64_t )NSEC_PER_MSEC ),
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            @synchronized( self )
+            {
+                self->_flushScheduled = NO;
+                
+                [ self writeBuffer ];
+            }
+        }
+    );
+}
+
+- ( void )appendKey: ( const char * )key
+{
+    [ self appendCString: ",\"" ];
+    [ self appendCString: key ];
+    [ self appendCString: "\":" ];
+}
+
+- ( void )appendCString: ( const char * )string
+{
+    [ self appendBytes: string length: strlen( string ) ];
+}
+
+- ( void )appendBytes: ( const char * )bytes length: ( size_t )length
+{
+    size_t n;
+    
+    while( length > 0 )
+    {
+        if( _length == SK_EVENT_STREAM_BUFFER_SIZE )
+        {
+            [ self writeBuffer ];
+        }
+        
+        n = MIN( length, SK_EVENT_STREAM_BUFFER_SIZE - _length );
+        
+        memcpy( _buffer + _length, bytes, n );
+        
+        _length += n;
+        bytes   += n;
+        length  -= n;
+    }
+}
+
+- ( void )appendJSONString: ( NSString * )string
+{
+    uint8_t    chunk[ 1024 ];
+    NSUInteger used;
+    NSRange    range;
+    
+    [ self appendCString: "\"" ];
+    
+    range = NSMakeRange( 0, string.length );
+    
+    /* Converted by chunks, so no temporary UTF-8 string is allocated */
+    while( range.length > 0 )
+    {
+        used = 0;
+        
+        if( [ string getBytes: chunk maxLength: sizeof( chunk ) usedLength: &used encoding: NSUTF8StringEncoding options: NSStringEncodingConversionAllowLossy range: range remainingRange: &range ] == NO || used == 0 )
+        {
+            break;
+        }
+        
+        [ self appendEscapedBytes: chunk length: used ];
+    }
+    
+    [ self appendCString: "\"" ];
+}
+
+- ( void )appendEscapedBytes: ( const uint8_t * )bytes length: ( size_t )length
+{
+    static const char hex[] = "0123456789abcdef";
+    
+    char    escape[ 6 ];
+    size_t  i;
+    size_t  n;
+    size_t  start;
+    uint8_t c;
+    
+    start = 0;
+    i     = 0;
+    
+    while( i < length )
+    {
+        c = bytes[ i ];
+        
+        if( c >= 0x20 && c < 0x80 && c != '"' && c != '\\' )
+        {
+            i++;
+            
+            continue;
+        }
+        
+        /* Valid UTF-8 sequences are copied as is */
+        if( c >= 0x80 )
+        {
+            n = SKUTF8SequenceLength( bytes + i, length - i );
+            
+            if( n > 0 )
+            {
+                i += n;
+                
+                continue;
+            }
+        }
+        
+        [ self appendBytes: ( const char * )( bytes + start ) length: i - start ];
+        
+        if( c == '"' || c == '\\' )
+        {
+            escape[ 0 ] = '\\';
+            escape[ 1 ] = ( char )c;
+            
+            [ self appendBytes: escape length: 2 ];
+        }
+        else if( c == '\n' )
+        {
+            [ self appendCString: "\\n" ];
+        }
+        else if( c == '\r' )
+        {
+            [ self appendCString: "\\r" ];
+        }
+        else if( c == '\t' )
+        {
+            [ self appendCString: "\\t" ];
+        }
+        else if( c < 0x20 )
+        {
+            escape[ 0 ] = '\\';
+            escape[ 1 ] = 'u';
+            escape[ 2 ] = '0';
+            escape[ 3 ] = '0';
+            escape[ 4 ] = hex[ c >> 4 ];
+            escape[ 5 ] = hex[ c & 0xF ];
+            
+            [ self appendBytes: escape length: 6 ];
+        }
+        else
+        {
+            /* Invalid or truncated UTF-8 sequence */
+            [ self appendCString: "\\ufffd" ];
+        }
+        
+        i++;
+        
+        start = i;
+    }
+    
+    [ self appendBytes: ( const char * )( bytes + start ) length: i - start ];
+}
+
+- ( void )appendState: ( SKTaskState )state duration: ( NSTimeInterval )duration
+{
+    char number[ 32 ];
+    
+    [ self appendKey: "state" ];
+    
+    switch( state )
+    {
+        case SKTaskStatePending:   [ self appendCString: "\"pending\"" ];   break;
+        case SKTaskStateRunning:   [ self appendCString: "\"running\"" ];   break;
+        case SKTaskStateSucceeded: [ self appendCString: "\"succeeded\"" ]; break;
+        case SKTaskStateFailed:    [ self appendCString: "\"failed\"" ];    break;
+        case SKTaskStateCancelled: [ self appendCString: "\"cancelled\"" ]; break;
+    }
+    
+    snprintf( number, sizeof( number ), "%.6f", duration );
+    
+    [ self appendKey: "duration" ];
+    [ self appendCString: number ];
+}
+
+- ( void )writeBuffer
+{
+    size_t  written;
+    ssize_t n;
+    
+    written = 0;
+    
+    while( written < _length )
+    {
+        n = write( self.fileDescriptor, _buffer + written, _length - written );
+        
+        if( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        
+        /* Events are dropped, rather than failing tasks, if the stream is broken */
+        if( n <= 0 )
+        {
+            break;
+        }
+        
+        written += ( size_t )n;
+    }
+    
+    _length = 0;
+}
+
+@end
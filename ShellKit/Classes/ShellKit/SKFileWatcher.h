@@ -0,0 +1,118 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKFileWatcher.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKFileWatcherHandler
+ * @abstract    Handler called when watched files have changed
+ * @param       paths   The absolute paths of the changed files
+ */
+typedef void ( ^ SKFileWatcherHandler )( NSSet< NSString * > * paths );
+
+/*!
+ * @class       SKFileWatcher
+ * @abstract    Watches files matching glob patterns
+ * @discussion  Uses inotify on Linux, watching the directories containing
+ *              matching files, as well as the deepest directory of each
+ *              pattern without wildcards, so new files are also detected.
+ *              Other platforms fall back to polling modification dates.
+ *              Bursts of events are coalesced: the handler is called once
+ *              no event has been received during the latency interval.
+ *              The handler is called on a private thread.
+ */
+@interface SKFileWatcher: SKObject
+
+/*!
+ * @property    patterns
+ * @abstract    The absolute glob patterns of the watched files
+ */
+@property( atomic, readonly ) NSArray< NSString * > * patterns;
+
+/*!
+ * @property    latency
+ * @abstract    The time to wait for events to settle, in seconds
+ */
+@property( atomic, readwrite, assign ) NSTimeInterval latency;
+
+/*!
+ * @property    error
+ * @abstract    An optional error, set if watching could not start
+ */
+@property( atomic, readonly, nullable ) NSError * error;
+
+/*!
+ * @method      absolutePattern:
+ * @abstract    Makes a pattern absolute, relative to the current directory
+ * @param       pattern The glob pattern
+ * @result      The absolute glob pattern
+ */
++ ( NSString * )absolutePattern: ( NSString * )pattern;
+
+/*!
+ * @method      path:matchesPattern:
+ * @abstract    Checks if an absolute path matches an absolute glob pattern
+ * @param       path    The path
+ * @param       pattern The glob pattern
+ * @result      YES if the path matches the pattern, otherwise NO
+ */
++ ( BOOL )path: ( NSString * )path matchesPattern: ( NSString * )pattern;
+
+/*!
+ * @method      initWithPatterns:handler:
+ * @abstract    Creates a file watcher
+ * @param       patterns    Glob patterns, relative to the current directory or absolute
+ * @param       handler     The handler to call when files have changed
+ * @result      The file watcher object
+ */
+- ( instancetype )initWithPatterns: ( NSArray< NSString * > * )patterns handler: ( SKFileWatcherHandler )handler NS_DESIGNATED_INITIALIZER;
+
+/*!
+ * @method      start
+ * @abstract    Starts watching files
+ * @discussion  Does nothing if the watcher has already been started.
+ * @result      YES if watching has started, otherwise NO, with the error set
+ * @see         error
+ */
+- ( BOOL )start;
+
+/*!
+ * @method      stop
+ * @abstract    Stops watching files
+ * @discussion  Once this method returns, the handler will not be called
+ *              anymore.
+ */
+- ( void )stop;
+
+@end
+
+NS_ASSUME_NONNULL_END
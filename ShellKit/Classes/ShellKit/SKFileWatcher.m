@@ -0,0 +1,529 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKFileWatcher.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKFileWatcher.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <fnmatch.h>
+#import <glob.h>
+#import <poll.h>
+#import <string.h>
+#import <unistd.h>
+
+#if defined( __linux__ )
+#import <sys/inotify.h>
+#endif
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKFileWatcher()
+
+@property( atomic, readwrite, strong           ) NSArray< NSString * > * patterns;
+@property( atomic, readwrite, copy             ) SKFileWatcherHandler    handler;
+@property( atomic, readwrite, strong, nullable ) NSError               * error;
+@property( atomic, readwrite, strong, nullable ) NSThread              * thread;
+@property( atomic, readwrite, strong, nullable ) dispatch_semaphore_t    done;
+@property( atomic, readwrite, assign           ) int                     stopReadDescriptor;
+@property( atomic, readwrite, assign           ) int                     stopWriteDescriptor;
+
++ ( NSArray< NSString * > * )pathsMatchingPattern: ( NSString * )pattern;
++ ( NSString * )staticDirectoryForPattern: ( NSString * )pattern;
+
+- ( void )watch: ( int )fd;
+- ( void )deliver: ( NSSet< NSString * > * )paths;
+- ( BOOL )waitForStopWithTimeout: ( int )timeout;
+
+#if defined( __linux__ )
+- ( void )watchWithInotify: ( int )fd;
+- ( void )updateWatches: ( NSMutableDictionary< NSNumber *, NSString * > * )watches inotify: ( int )fd;
+#else
+- ( void )watchByPolling;
+- ( NSDictionary< NSString *, NSArray * > * )snapshot;
+#endif
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKFileWatcher
+
++ ( NSString * )absolutePattern: ( NSString * )pattern
+{
+    if( pattern.isAbsolutePath )
+    {
+        return pattern.stringByStandardizingPath;
+    }
+    
+    return [ [ NSFileManager defaultManager ].currentDirectoryPath stringByAppendingPathComponent: pattern ].stringByStandardizingPath;
+}
+
++ ( BOOL )path: ( NSString * )path matchesPattern: ( NSString * )pattern
+{
+    return fnmatch( pattern.fileSystemRepresentation, path.fileSystemRepresentation, FNM_PATHNAME ) == 0;
+}
+
++ ( NSArray< NSString * > * )pathsMatchingPattern: ( NSString * )pattern
+{
+    NSMutableArray< NSString * > * paths;
+    glob_t                         g;
+    size_t                         i;
+    
+    paths = [ NSMutableArray new ];
+    
+    memset( &g, 0, sizeof( glob_t ) );
+    
+    if( glob( pattern.fileSystemRepresentation, 0, NULL, &g ) == 0 )
+    {
+        for( i = 0; i < g.gl_pathc; i++ )
+        {
+            [ paths addObject: [ [ NSFileManager defaultManager ] stringWithFileSystemRepresentation: g.gl_pathv[ i ] length: strlen( g.gl_pathv[ i ] ) ] ];
+        }
+    }
+    
+    globfree( &g );
+    
+    return paths;
+}
+
++ ( NSString * )staticDirectoryForPattern: ( NSString * )pattern
+{
+    NSString * directory;
+    NSString * component;
+    BOOL       isDir;
+    
+    directory = @"/";
+    
+    for( component in pattern.stringByDeletingLastPathComponent.pathComponents )
+    {
+        if( [ component rangeOfCharacterFromSet: [ NSCharacterSet characterSetWithCharactersInString: @"*?[" ] ].location != NSNotFound )
+        {
+            break;
+        }
+        
+        directory = [ directory stringByAppendingPathComponent: component ];
+    }
+    
+    /* New directories are picked up once their closest existing parent changes */
+    while( directory.length > 1 && ( [ [ NSFileManager defaultManager ] fileExistsAtPath: directory isDirectory: &isDir ] == NO || isDir == NO ) )
+    {
+        directory = directory.stringByDeletingLastPathComponent;
+    }
+    
+    return directory;
+}
+
+- ( instancetype )init
+{
+    return [ self initWithPatterns: @[] handler: ^( NSSet< NSString * > * paths ) { ( void )paths; } ];
+}
+
+- ( instancetype )initWithPatterns: ( NSArray< NSString * > * )patterns handler: ( SKFileWatcherHandler )handler
+{
+    NSMutableArray< NSString * > * absolute;
+    NSString                     * pattern;
+    
+    if( ( self = [ super init ] ) )
+    {
+        absolute = [ NSMutableArray new ];
+        
+        for( pattern in patterns )
+        {
+            [ absolute addObject: [ SKFileWatcher absolutePattern: pattern ] ];
+        }
+        
+        self.patterns            = absolute;
+        self.handler             = handler;
+        self.latency             = 0.2;
+        self.stopReadDescriptor  = -1;
+        self.stopWriteDescriptor = -1;
+    }
+    
+    return self;
+}
+
+- ( void )dealloc
+{
+    [ self stop ];
+}
+
+- ( BOOL )start
+{
+    int fds[ 2 ];
+    int fd;
+    
+    @synchronized( self )
+    {
+        if( self.done != nil )
+        {
+            return YES;
+        }
+        
+        if( pipe( fds ) != 0 )
+        {
+            self.error = [ self errorWithDescription: @"Cannot create pipe: %s", strerror( errno ) ];
+            
+            return NO;
+        }
+        
+        fcntl( fds[ 0 ], F_SETFD, FD_CLOEXEC );
+        fcntl( fds[ 1 ], F_SETFD, FD_CLOEXEC );
+
+#if defined( __linux__ )
+        
+        /* Created here, so a failure is reported to the caller */
+        fd = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+        
+        if( fd == -1 )
+        {
+            self.error = [ self errorWithDescription: @"Cannot initialize inotify: %s", strerror( errno ) ];
+            
+            close( fds[ 0 ] );
+            close( fds[ 1 ] );
+            
+            return NO;
+        }
+
+#else
+        
+        fd = -1;
+
+#endif
+        
+        self.error               = nil;
+        self.stopReadDescriptor  = fds[ 0 ];
+        self.stopWriteDescriptor = fds[ 1 ];
+        self.done                = dispatch_semaphore_create( 0 );
+        
+        dispatch_async
+        (
+            dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+            ^( void )
+            {
+                [ self watch: fd ];
+            }
+        );
+    }
+    
+    return YES;
+}
+
+- ( void )stop
+{
+    dispatch_semaphore_t done;
+    char                 c;
+    
+    @synchronized( self )
+    {
+        done = self.done;
+        
+        if( done == nil )
+        {
+            return;
+        }
+        
+        c = 0;
+        
+        if( self.stopWriteDescriptor != -1 )
+        {
+            ( void )write( self.stopWriteDescriptor, &c, 1 );
+        }
+    }
+    
+    /* The handler may stop the watcher, from the watcher's thread */
+    if( self.thread != [ NSThread currentThread ] )
+    {
+        dispatch_semaphore_wait( done, DISPATCH_TIME_FOREVER );
+    }
+}
+
+#pragma mark - Private
+
+- ( void )watch: ( int )fd
+{
+    self.thread = [ NSThread currentThread ];
+
+#if defined( __linux__ )
+    
+    [ self watchWithInotify: fd ];
+    close( fd );
+
+#else
+    
+    ( void )fd;
+    
+    [ self watchByPolling ];
+
+#endif
+    
+    @synchronized( self )
+    {
+        close( self.stopReadDescriptor );
+        close( self.stopWriteDescriptor );
+        
+        self.stopReadDescriptor  = -1;
+        self.stopWriteDescriptor = -1;
+        self.thread              = nil;
+        
+        dispatch_semaphore_signal( ( dispatch_semaphore_t )( self.done ) );
+        
+        self.done = nil;
+    }
+}
+
+- ( void )deliver: ( NSSet< NSString * > * )paths
+{
+    NSMutableSet< NSString * > * matching;
+    NSString                   * path;
+    NSString                   * pattern;
+    
+    matching = [ NSMutableSet new ];
+    
+    for( path in paths )
+    {
+        for( pattern in self.patterns )
+        {
+            if( [ SKFileWatcher path: path matchesPattern: pattern ] )
+            {
+                [ matching addObject: path ];
+                
+                break;
+            }
+        }
+    }
+    
+    if( matching.count > 0 )
+    {
+        self.handler( matching );
+    }
+}
+
+- ( BOOL )waitForStopWithTimeout: ( int )timeout
+{
+    struct pollfd fds[ 1 ];
+    
+    fds[ 0 ].fd      = self.stopReadDescriptor;
+    fds[ 0 ].events  = POLLIN;
+    fds[ 0 ].revents = 0;
+    
+    return poll( fds, 1, timeout ) > 0;
+}
+
+#if defined( __linux__ )
+
+- ( void )watchWithInotify: ( int )fd
+{
+    NSMutableDictionary< NSNumber *, NSString * > * watches;
+    NSMutableSet< NSString * >                    * changed;
+    NSString                                      * directory;
+    NSString                                      * pattern;
+    struct pollfd                                   fds[ 2 ];
+    struct inotify_event                          * event;
+    ssize_t                                         length;
+    ssize_t                                         i;
+    BOOL                                            pending;
+    int                                             n;
+    char                                            buffer[ 4096 ] __attribute__( ( aligned( __alignof__( struct inotify_event ) ) ) );
+    
+    watches = [ NSMutableDictionary new ];
+    changed = [ NSMutableSet new ];
+    pending = NO;
+    
+    [ self updateWatches: watches inotify: fd ];
+    
+    while( 1 )
+    {
+        fds[ 0 ].fd      = fd;
+        fds[ 0 ].events  = POLLIN;
+        fds[ 0 ].revents = 0;
+        fds[ 1 ].fd      = self.stopReadDescriptor;
+        fds[ 1 ].events  = POLLIN;
+        fds[ 1 ].revents = 0;
+        
+        /* Waits indefinitely, until a burst of events is over */
+        n = poll( fds, 2, ( pending ) ? ( int )( self.latency * 1000 ) : -1 );
+        
+        if( n < 0 && errno == EINTR )
+        {
+            continue;
+        }
+        
+        if( n < 0 || fds[ 1 ].revents != 0 )
+        {
+            break;
+        }
+        
+        if( n == 0 )
+        {
+            /* Directories may have been created or removed */
+            [ self updateWatches: watches inotify: fd ];
+            [ self deliver: changed ];
+            [ changed removeAllObjects ];
+            
+            pending = NO;
+            
+            continue;
+        }
+        
+        while( ( length = read( fd, buffer, sizeof( buffer ) ) ) > 0 )
+        {
+            for( i = 0; i < length; i += ( ssize_t )( sizeof( struct inotify_event ) + event->len ) )
+            {
+                event   = ( struct inotify_event * )( void * )( buffer + i );
+                pending = YES;
+                
+                if( event->mask & IN_Q_OVERFLOW )
+                {
+                    /* Events were lost - Consider every file as changed */
+                    for( pattern in self.patterns )
+                    {
+                        [ changed addObjectsFromArray: [ SKFileWatcher pathsMatchingPattern: pattern ] ];
+                    }
+                    
+                    continue;
+                }
+                
+                if( event->mask & IN_IGNORED )
+                {
+                    [ watches removeObjectForKey: @( event->wd ) ];
+                    
+                    continue;
+                }
+                
+                directory = watches[ @( event->wd ) ];
+                
+                if( directory != nil && event->len > 0 )
+                {
+                    [ changed addObject: [ directory stringByAppendingPathComponent: [ [ NSFileManager defaultManager ] stringWithFileSystemRepresentation: event->name length: strlen( event->name ) ] ] ];
+                }
+            }
+        }
+    }
+}
+
+- ( void )updateWatches: ( NSMutableDictionary< NSNumber *, NSString * > * )watches inotify: ( int )fd
+{
+    NSMutableSet< NSString * > * directories;
+    NSString                   * pattern;
+    NSString                   * path;
+    NSString                   * directory;
+    int                          wd;
+    
+    directories = [ NSMutableSet new ];
+    
+    for( pattern in self.patterns )
+    {
+        [ directories addObject: [ SKFileWatcher staticDirectoryForPattern: pattern ] ];
+        
+        for( path in [ SKFileWatcher pathsMatchingPattern: pattern ] )
+        {
+            [ directories addObject: path.stringByDeletingLastPathComponent ];
+        }
+    }
+    
+    [ directories minusSet: [ NSSet setWithArray: watches.allValues ] ];
+    
+    for( directory in directories )
+    {
+        wd = inotify_add_watch( fd, directory.fileSystemRepresentation, IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR );
+        
+        if( wd != -1 )
+        {
+            watches[ @( wd ) ] = directory;
+        }
+    }
+}
+
+#else
+
+- ( void )watchByPolling
+{
+    NSDictionary< NSString *, NSArray * > * last;
+    NSDictionary< NSString *, NSArray * > * current;
+    NSMutableSet< NSString * >            * changed;
+    NSMutableSet< NSString * >            * paths;
+    NSString                              * path;
+    
+    last    = [ self snapshot ];
+    changed = [ NSMutableSet new ];
+    
+    while( [ self waitForStopWithTimeout: ( int )( self.latency * 1000 ) ] == NO )
+    {
+        current = [ self snapshot ];
+        paths   = [ NSMutableSet setWithArray: last.allKeys ];
+        
+        [ paths addObjectsFromArray: current.allKeys ];
+        
+        for( path in paths )
+        {
+            if( [ last[ path ] isEqual: current[ path ] ] == NO )
+            {
+                [ changed addObject: path ];
+            }
+        }
+        
+        /* Delivers once a scan shows no new changes */
+        if( [ last isEqual: current ] && changed.count > 0 )
+        {
+            [ self deliver: changed ];
+            [ changed removeAllObjects ];
+        }
+        
+        last = current;
+    }
+}
+
+- ( NSDictionary< NSString *, NSArray * > * )snapshot
+{
+    NSMutableDictionary< NSString *, NSArray * > * snapshot;
+    NSDictionary                                 * attributes;
+    NSString                                     * pattern;
+    NSString                                     * path;
+    
+    snapshot = [ NSMutableDictionary new ];
+    
+    for( pattern in self.patterns )
+    {
+        for( path in [ SKFileWatcher pathsMatchingPattern: pattern ] )
+        {
+            attributes = [ [ NSFileManager defaultManager ] attributesOfItemAtPath: path error: NULL ];
+            
+            if( attributes != nil )
+            {
+                snapshot[ path ] = @[ ( attributes.fileModificationDate ) ? attributes.fileModificationDate : [ NSNull null ], @( attributes.fileSize ) ];
+            }
+        }
+    }
+    
+    return snapshot;
+}
+
+#endif
+
+@end
@@ -0,0 +1,74 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKFuture+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private interface of SKFuture, used by runnable objects
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKFuture.h>
+#import <ShellKit/SKRunableObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKFuture()
+
+/*!
+ * @method      backgroundFutureByRunning:variables:
+ * @abstract    Runs a runnable object synchronously, on a background thread
+ * @discussion  Messages are buffered like those of the calling thread.
+ *              Cancelling the future cancels the object, if it responds
+ *              to `cancel`.
+ * @param       object      The runnable object
+ * @param       variables   Optional variables
+ * @result      A future, finishing when the object has run
+ */
++ ( SKFuture * )backgroundFutureByRunning: ( id< SKRunableObject > )object variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      initWithCancellationHandler:
+ * @abstract    Creates a pending future
+ * @discussion  The cancellation handler should stop the underlying run,
+ *              which then finishes the future. Futures without a
+ *              cancellation handler finish right away when cancelled.
+ * @param       handler     An optional block called when the future is cancelled
+ * @result      The future object
+ */
+- ( instancetype )initWithCancellationHandler: ( nullable void ( ^ )( void ) )handler NS_DESIGNATED_INITIALIZER;
+
+/*!
+ * @method      finishWithSuccess:error:
+ * @abstract    Finishes the future
+ * @discussion  A failed future is marked as cancelled if it was cancelled.
+ *              Does nothing if the future has already finished.
+ * @param       success     Whether the run has succeeded
+ * @param       error       An optional error, for failures
+ */
+- ( void )finishWithSuccess: ( BOOL )success error: ( nullable NSError * )error;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,227 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKFuture.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol SKRunableObject;
+@class    SKFuture;
+
+/*!
+ * @typedef     SKFutureState
+ * @abstract    State of a future
+ */
+typedef NS_ENUM( NSInteger, SKFutureState )
+{
+    SKFutureStatePending,   /*! Not finished yet */
+    SKFutureStateSucceeded, /*! Finished successfully */
+    SKFutureStateFailed,    /*! Finished with a failure */
+    SKFutureStateCancelled  /*! Finished after having been cancelled */
+};
+
+/*!
+ * @typedef     SKFutureHandler
+ * @abstract    Block called when a future has finished
+ * @param       future  The finished future
+ */
+typedef void ( ^ SKFutureHandler )( SKFuture * future );
+
+/*!
+ * @class       SKFuture
+ * @abstract    The eventual result of an asynchronous run
+ * @discussion  A future finishes once, by succeeding, failing or being
+ *              cancelled. Handlers may be added at any time - Handlers
+ *              added to a finished future are called right away.
+ *              
+ *              Futures are composed with `then:` and `otherwise:`, which
+ *              return new futures, and with `all:`, `any:` and `race:`.
+ *              Cancelling a composed future cancels the futures it is
+ *              waiting for, down to the runnable objects.
+ *              
+ *              Handlers and continuation blocks are called on the
+ *              completion queue of the future. Futures returned by
+ *              `then:` and `otherwise:` use the same completion queue.
+ * @see         SKRunableObject
+ */
+@interface SKFuture: SKObject
+
+/*!
+ * @property    state
+ * @abstract    The state of the future
+ * @see         SKFutureState
+ */
+@property( atomic, readonly ) SKFutureState state;
+
+/*!
+ * @property    finished
+ * @abstract    Set once the future has succeeded, failed, or been cancelled
+ */
+@property( atomic, readonly, getter = isFinished ) BOOL finished;
+
+/*!
+ * @property    error
+ * @abstract    An optional error, set if the future has failed or been cancelled
+ */
+@property( atomic, readonly, nullable ) NSError * error;
+
+/*!
+ * @property    completionQueue
+ * @abstract    The queue handlers and continuation blocks are called on
+ * @discussion  Defaults to the global concurrent queue. Note that waiting
+ *              on a future from a serial completion queue, for a future
+ *              using the same queue, would deadlock.
+ */
+@property( atomic, readwrite, strong ) dispatch_queue_t completionQueue;
+
+/*!
+ * @method      futureByRunning:variables:
+ * @abstract    Runs a runnable object asynchronously
+ * @discussion  Objects implementing `runAsynchronously:` are run natively.
+ *              Other objects are run synchronously, on a background
+ *              thread.
+ * @param       object      The runnable object
+ * @param       variables   Optional variables
+ * @result      A future, finishing when the object has run
+ * @see         SKRunableObject
+ */
++ ( SKFuture * )futureByRunning: ( id< SKRunableObject > )object variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      succeededFuture
+ * @abstract    Creates a future that has already succeeded
+ * @result      The future object
+ */
++ ( SKFuture * )succeededFuture;
+
+/*!
+ * @method      futureWithError:
+ * @abstract    Creates a future that has already failed
+ * @param       error   The error of the future
+ * @result      The future object
+ */
++ ( SKFuture * )futureWithError: ( NSError * )error;
+
+/*!
+ * @method      all:
+ * @abstract    Waits for all futures to succeed
+ * @discussion  The returned future succeeds when all the futures have
+ *              succeeded. It fails as soon as one of them fails, in which
+ *              case the other ones are cancelled.
+ *              Succeeds right away if the array is empty.
+ * @param       futures     The futures to wait for
+ * @result      A new future
+ */
++ ( SKFuture * )all: ( NSArray< SKFuture * > * )futures;
+
+/*!
+ * @method      any:
+ * @abstract    Waits for the first future to succeed
+ * @discussion  The returned future succeeds as soon as one of the futures
+ *              succeeds, in which case the other ones are cancelled. It
+ *              fails with the last error when all of them have failed.
+ *              Fails right away if the array is empty.
+ * @param       futures     The futures to wait for
+ * @result      A new future
+ */
++ ( SKFuture * )any: ( NSArray< SKFuture * > * )futures;
+
+/*!
+ * @method      race:
+ * @abstract    Waits for the first future to finish
+ * @discussion  The returned future finishes like the first of the futures
+ *              to finish, successfully or not. The other ones are
+ *              cancelled.
+ *              Fails right away if the array is empty.
+ * @param       futures     The futures to wait for
+ * @result      A new future
+ */
++ ( SKFuture * )race: ( NSArray< SKFuture * > * )futures;
+
+/*!
+ * @method      then:
+ * @abstract    Continues with another future, once this one has succeeded
+ * @discussion  The block is not called if this future fails or is
+ *              cancelled, in which case the returned future finishes the
+ *              same way.
+ * @param       block   A block returning the future to continue with
+ * @result      A new future, finishing like the future returned by the block
+ */
+- ( SKFuture * )then: ( SKFuture * ( ^ )( void ) )block;
+
+/*!
+ * @method      thenRun:variables:
+ * @abstract    Runs a runnable object, once this future has succeeded
+ * @param       object      The runnable object
+ * @param       variables   Optional variables
+ * @result      A new future, finishing when the object has run
+ * @see         futureByRunning:variables:
+ */
+- ( SKFuture * )thenRun: ( id< SKRunableObject > )object variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      otherwise:
+ * @abstract    Continues with another future, if this one fails
+ * @discussion  The block is not called if this future succeeds or is
+ *              cancelled, in which case the returned future finishes the
+ *              same way.
+ * @param       block   A block receiving the error, and returning the future to continue with
+ * @result      A new future, finishing like the future returned by the block
+ */
+- ( SKFuture * )otherwise: ( SKFuture * ( ^ )( NSError * _Nullable error ) )block;
+
+/*!
+ * @method      whenFinished:
+ * @abstract    Adds a handler, called once the future has finished
+ * @param       handler     The handler
+ */
+- ( void )whenFinished: ( SKFutureHandler )handler;
+
+/*!
+ * @method      cancel
+ * @abstract    Cancels the future
+ * @discussion  The runnable object or the futures this future is waiting
+ *              for are cancelled. The future finishes in the cancelled
+ *              state once they have ended, unless they have succeeded in
+ *              the meantime.
+ *              Does nothing if the future has already finished.
+ */
+- ( void )cancel;
+
+/*!
+ * @method      wait
+ * @abstract    Blocks until the future has finished
+ * @result      YES if the future has succeeded, otherwise NO
+ */
+- ( BOOL )wait;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,535 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKFuture.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKFuture+Private.h"
+#import "SKShell+Private.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKFuture()
+
+@property( atomic, readwrite, assign           ) SKFutureState                       state;
+@property( atomic, readwrite, strong, nullable ) NSError                           * error;
+@property( atomic, readwrite, assign           ) BOOL                                cancelled;
+@property( atomic, readwrite, copy,   nullable ) void ( ^ cancellationHandler )( void );
+@property( atomic, readwrite, strong, nullable ) NSMutableArray< SKFutureHandler > * handlers;
+@property( atomic, readwrite, strong           ) NSCondition                       * condition;
+
++ ( void )cancelFutures: ( NSArray< SKFuture * > * )futures;
+
+- ( void )finishWithState: ( SKFutureState )state error: ( nullable NSError * )error;
+- ( void )finishLike: ( SKFuture * )future;
+- ( void )continueWith: ( SKFuture * )future;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKFuture
+
++ ( SKFuture * )futureByRunning: ( id< SKRunableObject > )object variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    if( [ ( NSObject * )object respondsToSelector: @selector( runAsynchronously: ) ] )
+    {
+        return [ object runAsynchronously: variables ];
+    }
+    
+    return [ self backgroundFutureByRunning: object variables: variables ];
+}
+
++ ( SKFuture * )backgroundFutureByRunning: ( id< SKRunableObject > )object variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    SKFuture              * future;
+    NSMutableString       * buffer;
+    NSArray< NSString * > * hierarchy;
+    
+    buffer    = [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    future    = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            if( [ ( NSObject * )object respondsToSelector: @selector( cancel ) ] )
+            {
+                [ ( id )object cancel ];
+            }
+        }
+    ];
+    
+    dispatch_async
+    (
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            __block BOOL success;
+            
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    success = [ object run: variables ];
+                }
+            ];
+            
+            [ future finishWithSuccess: success error: object.error ];
+        }
+    );
+    
+    return future;
+}
+
++ ( SKFuture * )succeededFuture
+{
+    SKFuture * future;
+    
+    future = [ SKFuture new ];
+    
+    [ future finishWithSuccess: YES error: nil ];
+    
+    return future;
+}
+
++ ( SKFuture * )futureWithError: ( NSError * )error
+{
+    SKFuture * future;
+    
+    future = [ SKFuture new ];
+    
+    [ future finishWithSuccess: NO error: error ];
+    
+    return future;
+}
+
++ ( SKFuture * )all: ( NSArray< SKFuture * > * )futures
+{
+    SKFuture           * all;
+    SKFuture           * future;
+    __block NSUInteger   remaining;
+    
+    futures   = [ futures copy ];
+    remaining = futures.count;
+    all       = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            [ SKFuture cancelFutures: futures ];
+        }
+    ];
+    
+    if( futures.count == 0 )
+    {
+        [ all finishWithSuccess: YES error: nil ];
+    }
+    
+    for( future in futures )
+    {
+        [ future whenFinished: ^( SKFuture * finished )
+            {
+                BOOL done;
+                
+                /* The first failure wins - The other futures are no longer needed */
+                if( finished.state != SKFutureStateSucceeded )
+                {
+                    [ all finishLike: finished ];
+                    [ SKFuture cancelFutures: futures ];
+                    
+                    return;
+                }
+                
+                @synchronized( all )
+                {
+                    done = --remaining == 0;
+                }
+                
+                if( done )
+                {
+                    [ all finishWithSuccess: YES error: nil ];
+                }
+            }
+        ];
+    }
+    
+    return all;
+}
+
++ ( SKFuture * )any: ( NSArray< SKFuture * > * )futures
+{
+    SKFuture           * any;
+    SKFuture           * future;
+    __block NSUInteger   remaining;
+    
+    futures   = [ futures copy ];
+    remaining = futures.count;
+    any       = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            [ SKFuture cancelFutures: futures ];
+        }
+    ];
+    
+    if( futures.count == 0 )
+    {
+        [ any finishWithSuccess: NO error: [ any errorWithDescription: @"No future to wait for" ] ];
+    }
+    
+    for( future in futures )
+    {
+        [ future whenFinished: ^( SKFuture * finished )
+            {
+                BOOL done;
+                
+                if( finished.state == SKFutureStateSucceeded )
+                {
+                    [ any finishWithSuccess: YES error: nil ];
+                    [ SKFuture cancelFutures: futures ];
+                    
+                    return;
+                }
+                
+                @synchronized( any )
+                {
+                    done = --remaining == 0;
+                }
+                
+                /* All futures have failed - The last error is kept */
+                if( done )
+                {
+                    [ any finishLike: finished ];
+                }
+            }
+        ];
+    }
+    
+    return any;
+}
+
++ ( SKFuture * )race: ( NSArray< SKFuture * > * )futures
+{
+    SKFuture * race;
+    SKFuture * future;
+    
+    futures = [ futures copy ];
+    race    = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            [ SKFuture cancelFutures: futures ];
+        }
+    ];
+    
+    if( futures.count == 0 )
+    {
+        [ race finishWithSuccess: NO error: [ race errorWithDescription: @"No future to wait for" ] ];
+    }
+    
+    for( future in futures )
+    {
+        [ future whenFinished: ^( SKFuture * finished )
+            {
+                [ race finishLike: finished ];
+                [ SKFuture cancelFutures: futures ];
+            }
+        ];
+    }
+    
+    return race;
+}
+
+- ( instancetype )init
+{
+    return [ self initWithCancellationHandler: nil ];
+}
+
+- ( instancetype )initWithCancellationHandler: ( nullable void ( ^ )( void ) )handler
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.state               = SKFutureStatePending;
+        self.cancellationHandler = handler;
+        self.handlers            = [ NSMutableArray new ];
+        self.condition           = [ NSCondition new ];
+        self.completionQueue     = dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 );
+    }
+    
+    return self;
+}
+
+- ( BOOL )isFinished
+{
+    return self.state != SKFutureStatePending;
+}
+
+- ( SKFuture * )then: ( SKFuture * ( ^ )( void ) )block
+{
+    SKFuture * future;
+    
+    future = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            [ self cancel ];
+        }
+    ];
+    
+    future.completionQueue = self.completionQueue;
+    
+    [ self whenFinished: ^( SKFuture * previous )
+        {
+            if( previous.state != SKFutureStateSucceeded )
+            {
+                [ future finishLike: previous ];
+            }
+            else if( future.cancelled )
+            {
+                [ future finishWithSuccess: NO error: nil ];
+            }
+            else
+            {
+                [ future continueWith: block() ];
+            }
+        }
+    ];
+    
+    return future;
+}
+
+- ( SKFuture * )thenRun: ( id< SKRunableObject > )object variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    return [ self then: ^ SKFuture * ( void )
+        {
+            return [ SKFuture futureByRunning: object variables: variables ];
+        }
+    ];
+}
+
+- ( SKFuture * )otherwise: ( SKFuture * ( ^ )( NSError * _Nullable error ) )block
+{
+    SKFuture * future;
+    
+    future = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            [ self cancel ];
+        }
+    ];
+    
+    future.completionQueue = self.completionQueue;
+    
+    [ self whenFinished: ^( SKFuture * previous )
+        {
+            if( previous.state != SKFutureStateFailed )
+            {
+                [ future finishLike: previous ];
+            }
+            else if( future.cancelled )
+            {
+                [ future finishWithSuccess: NO error: previous.error ];
+            }
+            else
+            {
+                [ future continueWith: block( previous.error ) ];
+            }
+        }
+    ];
+    
+    return future;
+}
+
+- ( void )whenFinished: ( SKFutureHandler )handler
+{
+    dispatch_queue_t queue;
+    
+    [ self.condition lock ];
+    
+    if( self.state == SKFutureStatePending )
+    {
+        [ self.handlers addObject: [ handler copy ] ];
+        [ self.condition unlock ];
+        
+        return;
+    }
+    
+    queue = self.completionQueue;
+    
+    [ self.condition unlock ];
+    
+    dispatch_async
+    (
+        queue,
+        ^( void )
+        {
+            handler( self );
+        }
+    );
+}
+
+- ( void )cancel
+{
+    void ( ^ handler )( void );
+    
+    [ self.condition lock ];
+    
+    if( self.state != SKFutureStatePending || self.cancelled )
+    {
+        [ self.condition unlock ];
+        
+        return;
+    }
+    
+    self.cancelled = YES;
+    handler        = self.cancellationHandler;
+    
+    [ self.condition unlock ];
+    
+    /* The future finishes when the run it is waiting for has ended */
+    if( handler != nil )
+    {
+        handler();
+    }
+    else
+    {
+        [ self finishWithSuccess: NO error: nil ];
+    }
+}
+
+- ( BOOL )wait
+{
+    BOOL success;
+    
+    [ self.condition lock ];
+    
+    while( self.state == SKFutureStatePending )
+    {
+        [ self.condition wait ];
+    }
+    
+    success = self.state == SKFutureStateSucceeded;
+    
+    [ self.condition unlock ];
+    
+    return success;
+}
+
+- ( void )finishWithSuccess: ( BOOL )success error: ( nullable NSError * )error
+{
+    if( success )
+    {
+        [ self finishWithState: SKFutureStateSucceeded error: nil ];
+    }
+    else if( self.cancelled )
+    {
+        [ self finishWithState: SKFutureStateCancelled error: ( error ) ? error : [ self errorWithDescription: @"Future was cancelled" ] ];
+    }
+    else
+    {
+        [ self finishWithState: SKFutureStateFailed error: ( error ) ? error : [ self errorWithDescription: @"Future has failed" ] ];
+    }
+}
+
+#pragma mark - Private
+
++ ( void )cancelFutures: ( NSArray< SKFuture * > * )futures
+{
+    SKFuture * future;
+    
+    for( future in futures )
+    {
+        [ future cancel ];
+    }
+}
+
+- ( void )finishWithState: ( SKFutureState )state error: ( nullable NSError * )error
+{
+    NSArray< SKFutureHandler > * handlers;
+    SKFutureHandler              handler;
+    dispatch_queue_t             queue;
+    
+    [ self.condition lock ];
+    
+    if( self.state != SKFutureStatePending )
+    {
+        [ self.condition unlock ];
+        
+        return;
+    }
+    
+    /* Handlers and the cancellation handler may reference the future - They're released here */
+    handlers                 = [ self.handlers copy ];
+    queue                    = self.completionQueue;
+    self.handlers            = nil;
+    self.cancellationHandler = nil;
+    self.error               = error;
+    self.state               = state;
+    
+    [ self.condition broadcast ];
+    [ self.condition unlock ];
+    
+    for( handler in handlers )
+    {
+        dispatch_async
+        (
+            queue,
+            ^( void )
+            {
+                handler( self );
+            }
+        );
+    }
+}
+
+- ( void )finishLike: ( SKFuture * )future
+{
+    if( future.state == SKFutureStateCancelled )
+    {
+        [ self finishWithState: SKFutureStateCancelled error: future.error ];
+    }
+    else
+    {
+        [ self finishWithSuccess: future.state == SKFutureStateSucceeded error: future.error ];
+    }
+}
+
+- ( void )continueWith: ( SKFuture * )future
+{
+    BOOL cancelled;
+    
+    [ self.condition lock ];
+    
+    /* Cancelling now cancels the future the continuation is waiting for */
+    self.cancellationHandler = ^( void )
+    {
+        [ future cancel ];
+    };
+    
+    cancelled = self.cancelled;
+    
+    [ self.condition unlock ];
+    
+    if( cancelled )
+    {
+        [ future cancel ];
+    }
+    
+    [ future whenFinished: ^( SKFuture * finished )
+        {
+            [ self finishLike: finished ];
+        }
+    ];
+}
+
+@end
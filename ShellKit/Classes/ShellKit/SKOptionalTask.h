@@ -42,6 +42,54 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @interface SKOptionalTask: SKTask
 
+/*!
+ * @property    detached
+ * @abstract    Runs the task in the background
+ * @discussion  Disabled by default. When enabled, `run:` starts the task in
+ *              the background and returns immediately, so a task group
+ *              continues with its next task.
+ *              The task is joined at the end of the enclosing task group,
+ *              when a barrier is run, or by calling `join`.
+ *              Output and messages of the task are buffered, and printed
+ *              when the task is joined, so they don't interleave with the
+ *              output of other tasks.
+ *              Detached tasks run in their own process group, so
+ *              cancelling them stops all the processes they started.
+ * @see         join
+ * @see         SKTaskBarrier
+ */
+@property( atomic, readwrite, assign, getter = isDetached ) BOOL detached;
+
+/*!
+ * @property    joinTimeout
+ * @abstract    The maximum time to wait for a detached task, when joining
+ * @discussion  Defaults to 60 seconds. If the task hasn't finished in time,
+ *              it is cancelled, and killed if it's still running 5 seconds
+ *              later. Zero means no timeout.
+ * @see         join
+ */
+@property( atomic, readwrite, assign ) NSTimeInterval joinTimeout;
+
+/*!
+ * @method      joinBackgroundTasks
+ * @abstract    Joins all the optional tasks running in the background
+ * @result      YES if all tasks have finished in time, otherwise NO
+ * @see         join
+ */
++ ( BOOL )joinBackgroundTasks;
+
+/*!
+ * @method      join
+ * @abstract    Waits for a detached task to finish, and prints its output
+ * @discussion  The wait is bounded by the join timeout, plus the time needed
+ *              to stop the task. If the task can't be stopped, the error is
+ *              set, and the task stays in the background.
+ *              Does nothing if the task isn't running in the background.
+ * @result      YES if the task has finished in time, otherwise NO
+ * @see         joinTimeout
+ */
+- ( BOOL )join;
+
 @end
 
 NS_ASSUME_NONNULL_END
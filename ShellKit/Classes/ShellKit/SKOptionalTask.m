@@ -28,18 +28,243 @@
  */
 
 #import <ShellKit/ShellKit.h>
+#import "SKTask+Private.h"
+#import "SKFuture+Private.h"
+#import <signal.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @interface SKOptionalTask()
 
+@property( atomic, readwrite, strong, nullable ) dispatch_group_t   background;
+@property( atomic, readwrite, strong, nullable ) NSString         * backgroundScript;
+
++ ( NSMutableArray< SKOptionalTask * > * )backgroundTasks;
+
+- ( BOOL )runOptional: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
 @end
 
 NS_ASSUME_NONNULL_END
 
 @implementation SKOptionalTask
 
-- ( BOOL )run: ( NSDictionary< NSString *, NSString * > * )variables
++ ( NSMutableArray< SKOptionalTask * > * )backgroundTasks
+{
+    static dispatch_once_t                      once;
+    static NSMutableArray< SKOptionalTask * > * tasks;
+    
+    dispatch_once
+    (
+        &once,
+        ^( void )
+        {
+            tasks = [ NSMutableArray new ];
+        }
+    );
+    
+    return tasks;
+}
+
++ ( BOOL )joinBackgroundTasks
+{
+    NSArray< SKOptionalTask * > * tasks;
+    SKOptionalTask              * task;
+    BOOL                          joined;
+    
+    @synchronized( [ self backgroundTasks ] )
+    {
+        tasks = [ [ self backgroundTasks ] copy ];
+    }
+    
+    joined = YES;
+    
+    for( task in tasks )
+    {
+        joined = [ task join ] && joined;
+    }
+    
+    return joined;
+}
+
+- ( instancetype )initWithShellScript: ( NSString * )script recoverTasks: ( nullable NSArray< SKTask * > * )recover
+{
+    if( ( self = [ super initWithShellScript: script recoverTasks: recover ] ) )
+    {
+        self.joinTimeout = 60;
+    }
+    
+    return self;
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    dispatch_group_t        group;
+    NSMutableString       * buffer;
+    NSArray< NSString * > * hierarchy;
+    NSString              * script;
+    SKTask                * recover;
+    
+    if( self.detached == NO )
+    {
+        return [ self runOptional: variables ];
+    }
+    
+    /* A task can only run once in the background at a time */
+    [ self join ];
+    
+    group     = dispatch_group_create();
+    buffer    = [ NSMutableString new ];
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    script    = [ self scriptWithVariables: variables ];
+    script    = ( script ) ? script : self.script;
+    
+    /* Cancelling must stop everything the task has started, as its output is read until all the processes exit */
+    self.runsInOwnProcessGroup = YES;
+    
+    for( recover in self.recover )
+    {
+        recover.runsInOwnProcessGroup = YES;
+    }
+    
+    @synchronized( self )
+    {
+        self.background       = group;
+        self.backgroundScript = script;
+        self.outputBuffer     = buffer;
+    }
+    
+    @synchronized( [ SKOptionalTask backgroundTasks ] )
+    {
+        [ [ SKOptionalTask backgroundTasks ] addObject: self ];
+    }
+    
+    [ [ SKShell currentShell ] printMessage: @"Running task in background: %@" status: SKStatusExecute color: SKColorNone, [ script stringWithShellColor: SKColorCyan ] ];
+    
+    dispatch_group_async
+    (
+        group,
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            [ [ SKShell currentShell ] setMessageBufferForCurrentThread: buffer ];
+            [ [ SKShell currentShell ] setPromptHierarchyForCurrentThread: hierarchy ];
+            [ self runOptional: variables ];
+            [ [ SKShell currentShell ] setPromptHierarchyForCurrentThread: nil ];
+            [ [ SKShell currentShell ] setMessageBufferForCurrentThread: nil ];
+        }
+    );
+    
+    return YES;
+}
+
+- ( SKFuture * )runAsynchronously: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSMutableString * buffer;
+    
+    /* Detaching may join a previous run of the task, which blocks */
+    if( self.detached )
+    {
+        return [ SKFuture backgroundFutureByRunning: self variables: variables ];
+    }
+    
+    buffer = ( self.outputBuffer ) ? self.outputBuffer : [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+    
+    return [ [ super runAsynchronously: variables ] otherwise: ^ SKFuture * ( NSError * _Nullable error )
+        {
+            ( void )error;
+            
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer block: ^( void )
+                {
+                    [ [ SKShell currentShell ] printSuccessMessage: @"Task is marked as optional - Not failing" ];
+                }
+            ];
+            
+            return [ SKFuture succeededFuture ];
+        }
+    ];
+}
+
+- ( BOOL )join
+{
+    dispatch_group_t  group;
+    NSMutableString * buffer;
+    NSString        * script;
+    BOOL              finished;
+    BOOL              stopped;
+    
+    @synchronized( self )
+    {
+        group  = self.background;
+        buffer = self.outputBuffer;
+        script = self.backgroundScript;
+    }
+    
+    if( group == nil || buffer == nil || script == nil )
+    {
+        return YES;
+    }
+    
+    finished = dispatch_group_wait( group, ( self.joinTimeout > 0 ) ? dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( self.joinTimeout * NSEC_PER_SEC ) ) : DISPATCH_TIME_FOREVER ) == 0;
+    stopped  = finished;
+    
+    /* Processes ignoring SIGTERM are killed after a grace period, as with services */
+    if( finished == NO )
+    {
+        [ self cancel ];
+        
+        stopped = dispatch_group_wait( group, dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 5 * NSEC_PER_SEC ) ) ) == 0;
+    }
+    
+    if( stopped == NO )
+    {
+        [ self cancelWithSignal: SIGKILL ];
+        
+        stopped = dispatch_group_wait( group, dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 5 * NSEC_PER_SEC ) ) ) == 0;
+    }
+    
+    /* The task stays in the background, and may be joined again */
+    if( stopped == NO )
+    {
+        self.error = [ self errorWithDescription: @"Background task could not be stopped: %@", script ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        return NO;
+    }
+    
+    @synchronized( self )
+    {
+        if( self.background != group )
+        {
+            /* Already joined from another thread */
+            return finished;
+        }
+        
+        self.background       = nil;
+        self.backgroundScript = nil;
+        self.outputBuffer     = nil;
+    }
+    
+    @synchronized( [ SKOptionalTask backgroundTasks ] )
+    {
+        [ [ SKOptionalTask backgroundTasks ] removeObject: self ];
+    }
+    
+    [ [ SKShell currentShell ] printMessage: @"Joining background task: %@" status: SKStatusExecute color: SKColorNone, [ script stringWithShellColor: SKColorCyan ] ];
+    [ [ SKShell currentShell ] printBufferedMessages: buffer ];
+    
+    if( finished == NO )
+    {
+        [ [ SKShell currentShell ] printWarningMessage: @"Background task did not finish in time - Cancelled" ];
+    }
+    
+    return finished;
+}
+
+#pragma mark - Private
+
+- ( BOOL )runOptional: ( nullable NSDictionary< NSString *, NSString * > * )variables
 {
     if( [ super run: variables ] == NO )
     {
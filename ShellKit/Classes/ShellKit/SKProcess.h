@@ -0,0 +1,198 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKProcess.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+#import <ShellKit/SKEnvironment.h>
+#import <ShellKit/SKProcessAttributes.h>
+#import <sys/types.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @class       SKProcess
+ * @abstract    Spawns a child process
+ * @discussion  Similar to `NSTask`, but passes the prebuilt block of an
+ *              `SKEnvironment` object to the child process, instead of
+ *              converting an environment dictionary on each launch.
+ *              File descriptors other than the standard ones are not
+ *              inherited by the child process.
+ */
+@interface SKProcess: SKObject
+
+/*!
+ * @property    launchPath
+ * @abstract    The path of the executable
+ */
+@property( atomic, readwrite, strong ) NSString * launchPath;
+
+/*!
+ * @property    arguments
+ * @abstract    The arguments, not including the executable path
+ */
+@property( atomic, readwrite, strong ) NSArray< NSString * > * arguments;
+
+/*!
+ * @property    environment
+ * @abstract    The environment of the process
+ * @discussion  If nil, the environment of the current process is used, as
+ *              it is when the process is launched.
+ */
+@property( atomic, readwrite, strong, nullable ) SKEnvironment * environment;
+
+/*!
+ * @property    standardInput
+ * @abstract    An optional pipe used as `stdin`
+ * @discussion  If nil, `stdin` is inherited.
+ */
+@property( atomic, readwrite, strong, nullable ) NSPipe * standardInput;
+
+/*!
+ * @property    standardOutput
+ * @abstract    An optional pipe used as `stdout`
+ * @discussion  If nil, `stdout` is inherited.
+ */
+@property( atomic, readwrite, strong, nullable ) NSPipe * standardOutput;
+
+/*!
+ * @property    standardError
+ * @abstract    An optional pipe used as `stderr`
+ * @discussion  If nil, `stderr` is inherited.
+ */
+@property( atomic, readwrite, strong, nullable ) NSPipe * standardError;
+
+/*!
+ * @property    createsProcessGroup
+ * @abstract    Runs the process in a new process group
+ * @discussion  When set, signals are sent to the whole process group, so
+ *              commands started by a shell are also terminated.
+ *              Note that such a process doesn't receive signals sent to the
+ *              foreground process group of the terminal, like `SIGINT`.
+ */
+@property( atomic, readwrite, assign ) BOOL createsProcessGroup;
+
+/*!
+ * @property    attributes
+ * @abstract    Optional scheduling attributes and resource limits
+ * @discussion  When set, the process is forked, and the attributes are
+ *              applied in the child before executing the command, instead
+ *              of using `posix_spawn`.
+ * @see         SKProcessAttributes
+ */
+@property( atomic, readwrite, copy, nullable ) SKProcessAttributes * attributes;
+
+/*!
+ * @property    terminationHandler
+ * @abstract    An optional block called once the process has exited
+ * @discussion  Must be set before launching the process. The exit is
+ *              detected with a dispatch source (using a process descriptor
+ *              on Linux), so no thread is blocked waiting for it.
+ *              The handler is called once, on a global queue, and is
+ *              released afterwards.
+ */
+@property( atomic, readwrite, copy, nullable ) void ( ^ terminationHandler )( SKProcess * process );
+
+/*!
+ * @property    processIdentifier
+ * @abstract    The PID of the process, or 0 if it wasn't launched
+ */
+@property( atomic, readonly ) pid_t processIdentifier;
+
+/*!
+ * @property    terminationStatus
+ * @abstract    The exit status of the process, or the signal number if the process was killed
+ */
+@property( atomic, readonly ) int terminationStatus;
+
+/*!
+ * @property    terminationSignal
+ * @abstract    The signal that killed the process, or 0 if the process
+ *              exited by itself or hasn't exited yet
+ */
+@property( atomic, readonly ) int terminationSignal;
+
+/*!
+ * @property    running
+ * @abstract    Set if the process was launched and hasn't exited yet
+ */
+@property( atomic, readonly, getter = isRunning ) BOOL running;
+
+/*!
+ * @property    error
+ * @abstract    An optional error, set if the process could not be launched
+ */
+@property( atomic, readonly, nullable ) NSError * error;
+
+/*!
+ * @method      launch
+ * @abstract    Launches the process
+ * @discussion  The parent's ends of the pipes are not closed, but their
+ *              child's ends are, so reading from them ends when the process
+ *              exits.
+ * @result      YES if the process was launched, otherwise NO
+ */
+- ( BOOL )launch;
+
+/*!
+ * @method      waitUntilExit
+ * @abstract    Blocks until the process has exited
+ * @discussion  May be called from several threads at once.
+ */
+- ( void )waitUntilExit;
+
+/*!
+ * @method      terminate
+ * @abstract    Sends `SIGTERM` to the process, if running
+ */
+- ( void )terminate;
+
+/*!
+ * @method      sendSignal:
+ * @abstract    Sends a signal to the process, if running
+ * @discussion  The signal is sent to the process group if the process was
+ *              launched in a new process group, so the processes it started
+ *              are reached. Once the process has exited, nothing is sent,
+ *              as the ID of its process group may then be reused.
+ * @param       signal  The signal number
+ */
+- ( void )sendSignal: ( int )signal;
+
+/*!
+ * @method      terminateWithGracePeriod:
+ * @abstract    Terminates the process, and waits for it to exit
+ * @discussion  `SIGTERM` is sent first. If the process is still running
+ *              after the grace period, `SIGKILL` is sent. Both are sent to
+ *              the process group, if the process was launched in a new one.
+ * @param       period  The time to wait before sending `SIGKILL`
+ */
+- ( void )terminateWithGracePeriod: ( NSTimeInterval )period;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,1117 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKProcess.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+/* Needed for the CPU affinity functions of glibc */
+#if defined( __linux__ ) && !defined( _GNU_SOURCE )
+#define _GNU_SOURCE
+#endif
+
+#import <ShellKit/ShellKit.h>
+#import "SKProcess.h"
+#import "SKRecording+Private.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <signal.h>
+#import <spawn.h>
+#import <stdlib.h>
+#import <string.h>
+#import <sys/resource.h>
+#import <sys/syscall.h>
+#import <sys/wait.h>
+#import <unistd.h>
+
+#if defined( __linux__ )
+#import <sched.h>
+#endif
+
+extern char ** environ;
+
+/* Whether posix_spawn can close the descriptors inherited by the child */
+#if defined( __APPLE__ )
+#define SK_SPAWN_CLOSES_DESCRIPTORS 1
+#elif defined( __GLIBC__ ) && defined( __GLIBC_PREREQ )
+#if __GLIBC_PREREQ( 2, 34 )
+#define SK_SPAWN_CLOSES_DESCRIPTORS 1
+#endif
+#endif
+
+#ifndef SK_SPAWN_CLOSES_DESCRIPTORS
+#define SK_SPAWN_CLOSES_DESCRIPTORS 0
+#endif
+
+#ifndef CLOSE_RANGE_CLOEXEC
+#define CLOSE_RANGE_CLOEXEC ( 1U << 2 )
+#endif
+
+/* Steps of the setup of a forked child, reported to the parent on failure */
+typedef NS_ENUM( int, SKProcessSetupStep )
+{
+    SKProcessSetupStepExec,
+    SKProcessSetupStepAffinity,
+    SKProcessSetupStepIOPriority,
+    SKProcessSetupStepNice,
+    SKProcessSetupStepLimits
+};
+
+static void SKProcessChildFail( int fd, SKProcessSetupStep step ) __attribute__( ( noreturn ) );
+static void SKProcessWrite( int fd, const void * bytes, size_t length );
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKProcess()
+
+@property( atomic, readwrite, assign           ) pid_t                                  processIdentifier;
+@property( atomic, readwrite, assign           ) int                                    terminationStatus;
+@property( atomic, readwrite, assign           ) int                                    terminationSignal;
+@property( atomic, readwrite, assign           ) BOOL                                   exited;
+@property( atomic, readwrite, strong, nullable ) NSError                              * error;
+@property( atomic, readwrite, strong, nullable ) SKRecording                          * recording;
+@property( atomic, readwrite, strong, nullable ) NSDate                               * launchDate;
+@property( atomic, readwrite, strong, nullable ) NSMutableArray< SKRecordedOutput * > * recordedOutput;
+@property( atomic, readwrite, strong, nullable ) dispatch_group_t                       recorders;
+@property( atomic, readwrite, assign           ) BOOL                                   replaying;
+@property( atomic, readwrite, assign           ) int                                    replaySignal;
+@property( atomic, readwrite, strong, nullable ) NSCondition                          * replayCondition;
+@property( atomic, readwrite, strong, nullable ) dispatch_source_t                      terminationSource;
+
++ ( dispatch_queue_t )terminationQueue;
+
+- ( int )spawnWithArguments: ( char * const * )argv environment: ( char * const * )envp descriptors: ( const int * )descriptors processIdentifier: ( pid_t * )pid;
+- ( int )forkWithArguments: ( char * const * )argv environment: ( char * const * )envp descriptors: ( const int * )descriptors processIdentifier: ( pid_t * )pid failedStep: ( SKProcessSetupStep * )step;
+- ( void )recordOutputFrom: ( NSFileHandle * )source to: ( nullable NSFileHandle * )destination stream: ( int )stream;
+- ( void )endRecording;
+- ( BOOL )replayFromRecording: ( SKRecording * )recording;
+- ( void )replayRun: ( SKRecordedRun * )run output: ( nullable NSFileHandle * )output error: ( nullable NSFileHandle * )error timeScale: ( double )scale;
+- ( BOOL )waitForReplayUntilDate: ( NSDate * )date;
+- ( void )reap;
+- ( void )monitorTermination;
+- ( void )notifyTermination;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* Only async-signal-safe functions may be called in a child forked from a multithreaded process */
+static void SKProcessChildFail( int fd, SKProcessSetupStep step )
+{
+    int report[ 2 ];
+    
+    report[ 0 ] = ( int )step;
+    report[ 1 ] = errno;
+    
+    ( void )write( fd, report, sizeof( report ) );
+    _exit( 127 );
+}
+
+static void SKProcessWrite( int fd, const void * bytes, size_t length )
+{
+    ssize_t written;
+    
+    while( length > 0 )
+    {
+        written = write( fd, bytes, length );
+        
+        if( written == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        
+        if( written <= 0 )
+        {
+            return;
+        }
+        
+        bytes   = ( const char * )bytes + written;
+        length -= ( size_t )written;
+    }
+}
+
+@implementation SKProcess
+
++ ( dispatch_queue_t )terminationQueue
+{
+    static dispatch_once_t  once;
+    static dispatch_queue_t queue;
+    
+    dispatch_once
+    (
+        &once,
+        ^( void )
+        {
+            queue = dispatch_queue_create( "com.xs-labs.ShellKit.SKProcess.Termination", DISPATCH_QUEUE_SERIAL );
+        }
+    );
+    
+    return queue;
+}
+
+- ( instancetype )init
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.launchPath = @"/bin/sh";
+        self.arguments  = @[];
+    }
+    
+    return self;
+}
+
+- ( BOOL )isRunning
+{
+    [ self reap ];
+    
+    return ( self.processIdentifier != 0 || self.replaying ) && self.exited == NO;
+}
+
+- ( BOOL )launch
+{
+    SKEnvironment      * environment;
+    char * const       * envp;
+    SKRecording        * recording;
+    NSPipe             * recordedOutput;
+    NSPipe             * recordedError;
+    NSString           * argument;
+    NSString           * action;
+    char              ** argv;
+    NSUInteger           i;
+    pid_t                pid;
+    int                  result;
+    int                  descriptors[ 3 ];
+    SKProcessSetupStep   step;
+    
+    @synchronized( self )
+    {
+        if( self.processIdentifier != 0 || self.replaying )
+        {
+            self.error = [ self errorWithDescription: @"Process has already been launched" ];
+            
+            return NO;
+        }
+        
+        recording = [ SKShell currentShell ].recording;
+        
+        if( recording.mode == SKRecordingModeReplay )
+        {
+            return [ self replayFromRecording: ( SKRecording * )recording ];
+        }
+        
+        environment = self.environment;
+        argv        = calloc( self.arguments.count + 2, sizeof( char * ) );
+        
+        if( argv == NULL )
+        {
+            self.error = [ self errorWithDescription: @"Cannot allocate memory for arguments" ];
+            
+            return NO;
+        }
+        
+        argv[ 0 ] = ( char * )( self.launchPath.fileSystemRepresentation );
+        i         = 1;
+        
+        for( argument in self.arguments )
+        {
+            argv[ i++ ] = ( char * )( argument.UTF8String );
+        }
+        
+        descriptors[ 0 ] = ( self.standardInput  ) ? self.standardInput.fileHandleForReading.fileDescriptor  : -1;
+        descriptors[ 1 ] = ( self.standardOutput ) ? self.standardOutput.fileHandleForWriting.fileDescriptor : -1;
+        descriptors[ 2 ] = ( self.standardError  ) ? self.standardError.fileHandleForWriting.fileDescriptor  : -1;
+        recordedOutput   = nil;
+        recordedError    = nil;
+        
+        /* When recording, the output goes through pipes of our own, and is copied to its destination */
+        if( recording != nil )
+        {
+            recordedOutput   = [ NSPipe pipe ];
+            recordedError    = [ NSPipe pipe ];
+            descriptors[ 1 ] = recordedOutput.fileHandleForWriting.fileDescriptor;
+            descriptors[ 2 ] = recordedError.fileHandleForWriting.fileDescriptor;
+        }
+        
+        pid             = 0;
+        step            = SKProcessSetupStepExec;
+        self.launchDate = [ NSDate date ];
+        
+        /* Without an explicit environment, the live environment is passed, so setenv() changes are seen */
+        if( environment != nil )
+        {
+            envp = environment.environmentBlock;
+        }
+        else
+        {
+            envp = environ;
+        }
+        
+        /* Pipes may be inherited by processes spawned concurrently, so children close all but the standard descriptors */
+        if( self.attributes != nil || SK_SPAWN_CLOSES_DESCRIPTORS == 0 )
+        {
+            result = [ self forkWithArguments: argv environment: envp descriptors: descriptors processIdentifier: &pid failedStep: &step ];
+        }
+        else
+        {
+            result = [ self spawnWithArguments: argv environment: envp descriptors: descriptors processIdentifier: &pid ];
+        }
+        
+        free( argv );
+        
+        if( result != 0 )
+        {
+            switch( step )
+            {
+                case SKProcessSetupStepExec:       action = @"launch";                     break;
+                case SKProcessSetupStepAffinity:   action = @"set the CPU affinity of";    break;
+                case SKProcessSetupStepIOPriority: action = @"set the I/O priority of";    break;
+                case SKProcessSetupStepNice:       action = @"set the nice value of";      break;
+                case SKProcessSetupStepLimits:     action = @"set the resource limits of"; break;
+            }
+            
+            self.error = [ self errorWithDescription: @"Cannot %@ %@: %s", action, self.launchPath, strerror( result ) ];
+            
+            return NO;
+        }
+        
+        self.processIdentifier = pid;
+        
+        /* Closes the child's ends, so reading ends when the process exits */
+        [ self.standardInput.fileHandleForReading closeFile ];
+        
+        if( recording != nil && recordedOutput != nil && recordedError != nil )
+        {
+            self.recording      = recording;
+            self.recordedOutput = [ NSMutableArray new ];
+            self.recorders      = dispatch_group_create();
+            
+            [ recording beginRun ];
+            [ recordedOutput.fileHandleForWriting closeFile ];
+            [ recordedError.fileHandleForWriting  closeFile ];
+            
+            /* The destination pipes are closed once all the output has been copied */
+            [ self recordOutputFrom: recordedOutput.fileHandleForReading to: self.standardOutput.fileHandleForWriting stream: STDOUT_FILENO ];
+            [ self recordOutputFrom: recordedError.fileHandleForReading  to: self.standardError.fileHandleForWriting  stream: STDERR_FILENO ];
+        }
+        else
+        {
+            [ self.standardOutput.fileHandleForWriting closeFile ];
+            [ self.standardError.fileHandleForWriting  closeFile ];
+        }
+        
+        [ self monitorTermination ];
+        
+        return YES;
+    }
+}
+
+- ( void )waitUntilExit
+{
+    siginfo_t info;
+    pid_t     pid;
+    
+    if( self.replaying )
+    {
+        [ self.replayCondition lock ];
+        
+        while( self.exited == NO )
+        {
+            [ self.replayCondition wait ];
+        }
+        
+        [ self.replayCondition unlock ];
+        
+        return;
+    }
+    
+    pid = self.processIdentifier;
+    
+    if( pid == 0 )
+    {
+        return;
+    }
+    
+    while( self.exited == NO )
+    {
+        /* Waits without reaping, so other threads may still check the status */
+        memset( &info, 0, sizeof( siginfo_t ) );
+        
+        if( waitid( P_PID, ( id_t )pid, &info, WEXITED | WNOWAIT ) == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        
+        [ self reap ];
+    }
+}
+
+- ( void )terminate
+{
+    [ self sendSignal: SIGTERM ];
+}
+
+- ( void )sendSignal: ( int )signal
+{
+    if( self.replaying )
+    {
+        /* Replayed processes end as if they were killed by the signal */
+        [ self.replayCondition lock ];
+        
+        if( self.exited == NO && signal > 0 )
+        {
+            self.replaySignal = signal;
+        }
+        
+        [ self.replayCondition broadcast ];
+        [ self.replayCondition unlock ];
+        
+        return;
+    }
+    
+    @synchronized( self )
+    {
+        /* Once the leader is reaped, the ID of its process group may be reused by an unrelated group - Reaping also synchronizes on the process */
+        if( self.processIdentifier != 0 && self.exited == NO && self.createsProcessGroup )
+        {
+            kill( -( self.processIdentifier ), signal );
+        }
+        else if( self.processIdentifier != 0 && self.exited == NO )
+        {
+            kill( self.processIdentifier, signal );
+        }
+    }
+}
+
+- ( void )terminateWithGracePeriod: ( NSTimeInterval )period
+{
+    NSDate * date;
+    BOOL     stopped;
+    
+    [ self terminate ];
+    
+    date    = [ NSDate date ];
+    stopped = NO;
+    
+    while( stopped == NO && -[ date timeIntervalSinceNow ] < period )
+    {
+        stopped = self.isRunning == NO;
+        
+        if( stopped == NO )
+        {
+            usleep( 10000 );
+        }
+    }
+    
+    if( stopped == NO )
+    {
+        [ self sendSignal: SIGKILL ];
+    }
+    
+    [ self waitUntilExit ];
+}
+
+- ( int )spawnWithArguments: ( char * const * )argv environment: ( char * const * )envp descriptors: ( const int * )descriptors processIdentifier: ( pid_t * )pid
+{
+    posix_spawn_file_actions_t actions;
+    posix_spawnattr_t          attributes;
+    sigset_t                   signals;
+    int                        result;
+    short                      flags;
+    
+    posix_spawn_file_actions_init( &actions );
+    posix_spawnattr_init( &attributes );
+    
+    if( descriptors[ STDIN_FILENO ] != -1 )
+    {
+        posix_spawn_file_actions_adddup2( &actions, descriptors[ STDIN_FILENO ], STDIN_FILENO );
+    }
+    
+    if( descriptors[ STDOUT_FILENO ] != -1 )
+    {
+        posix_spawn_file_actions_adddup2( &actions, descriptors[ STDOUT_FILENO ], STDOUT_FILENO );
+    }
+    
+    if( descriptors[ STDERR_FILENO ] != -1 )
+    {
+        posix_spawn_file_actions_adddup2( &actions, descriptors[ STDERR_FILENO ], STDERR_FILENO );
+    }
+    
+    flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+    
+    if( self.createsProcessGroup )
+    {
+        flags |= POSIX_SPAWN_SETPGROUP;
+        
+        posix_spawnattr_setpgroup( &attributes, 0 );
+    }
+
+#if defined( __APPLE__ )
+    
+    flags |= POSIX_SPAWN_CLOEXEC_DEFAULT;
+    
+    if( descriptors[ STDIN_FILENO ] == -1 )
+    {
+        posix_spawn_file_actions_addinherit_np( &actions, STDIN_FILENO );
+    }
+    
+    if( descriptors[ STDOUT_FILENO ] == -1 )
+    {
+        posix_spawn_file_actions_addinherit_np( &actions, STDOUT_FILENO );
+    }
+    
+    if( descriptors[ STDERR_FILENO ] == -1 )
+    {
+        posix_spawn_file_actions_addinherit_np( &actions, STDERR_FILENO );
+    }
+
+#elif SK_SPAWN_CLOSES_DESCRIPTORS
+    
+    posix_spawn_file_actions_addclosefrom_np( &actions, STDERR_FILENO + 1 );
+
+#endif
+    
+    sigemptyset( &signals );
+    posix_spawnattr_setsigmask( &attributes, &signals );
+    sigfillset( &signals );
+    posix_spawnattr_setsigdefault( &attributes, &signals );
+    posix_spawnattr_setflags( &attributes, flags );
+    
+    result = posix_spawn( pid, self.launchPath.fileSystemRepresentation, &actions, &attributes, argv, envp );
+    
+    posix_spawn_file_actions_destroy( &actions );
+    posix_spawnattr_destroy( &attributes );
+    
+    return result;
+}
+
+- ( int )forkWithArguments: ( char * const * )argv environment: ( char * const * )envp descriptors: ( const int * )descriptors processIdentifier: ( pid_t * )pid failedStep: ( SKProcessSetupStep * )step
+{
+    SKProcessAttributes * attributes;
+    struct sigaction      action;
+    struct rlimit         limits[ 3 ];
+    sigset_t              signals;
+    const char          * path;
+    ssize_t               length;
+    pid_t                 child;
+    int                   resources[ 3 ];
+    int                   report[ 2 ];
+    int                   failure[ 2 ];
+    int                   count;
+    int                   nice;
+    int                   maximum;
+    int                   i;
+    BOOL                  setsNice;
+    BOOL                  createsGroup;
+    BOOL                  closed;
+
+#if defined( __linux__ )
+    
+    cpu_set_t             cpus;
+    NSUInteger            cpu;
+    int                   ioPriority;
+    BOOL                  setsAffinity;
+
+#endif
+    
+    attributes   = ( SKProcessAttributes * )( self.attributes );
+    path         = self.launchPath.fileSystemRepresentation;
+    createsGroup = self.createsProcessGroup;
+    setsNice     = attributes.niceValue != nil;
+    nice         = attributes.niceValue.intValue;
+    count        = 0;
+    maximum      = ( sysconf( _SC_OPEN_MAX ) > 0 ) ? ( int )MIN( sysconf( _SC_OPEN_MAX ), 65536 ) : 1024;
+    
+    /* Everything the child needs is prepared beforehand, as it may not allocate memory */
+#if defined( __linux__ )
+    
+    ioPriority   = 0;
+    setsAffinity = NO;
+    
+    CPU_ZERO( &cpus );
+    
+    for( cpu = attributes.cpuAffinity.firstIndex; cpu != NSNotFound && cpu < CPU_SETSIZE; cpu = [ attributes.cpuAffinity indexGreaterThanIndex: cpu ] )
+    {
+        CPU_SET( cpu, &cpus );
+        
+        setsAffinity = YES;
+    }
+    
+    if( attributes.ioPriorityClass != SKIOPriorityClassInherited )
+    {
+        ioPriority = ( ( int )( attributes.ioPriorityClass ) << 13 ) | ( int )MIN( attributes.ioPriorityLevel, ( NSUInteger )7 );
+    }
+
+#endif
+    
+    if( attributes.addressSpaceLimit > 0 )
+    {
+        resources[ count++ ] = RLIMIT_AS;
+    }
+    
+    if( attributes.openFilesLimit > 0 )
+    {
+        resources[ count++ ] = RLIMIT_NOFILE;
+    }
+    
+    if( attributes.cpuTimeLimit > 0 )
+    {
+        resources[ count++ ] = RLIMIT_CPU;
+    }
+    
+    for( i = 0; i < count; i++ )
+    {
+        if( getrlimit( resources[ i ], &limits[ i ] ) != 0 )
+        {
+            return errno;
+        }
+        
+        if( resources[ i ] == RLIMIT_AS )
+        {
+            limits[ i ].rlim_cur = ( rlim_t )( attributes.addressSpaceLimit );
+        }
+        else if( resources[ i ] == RLIMIT_NOFILE )
+        {
+            limits[ i ].rlim_cur = ( rlim_t )( attributes.openFilesLimit );
+        }
+        else
+        {
+            limits[ i ].rlim_cur = ( rlim_t )( attributes.cpuTimeLimit );
+        }
+    }
+    
+    memset( &action, 0, sizeof( struct sigaction ) );
+    
+    action.sa_handler = SIG_DFL;
+    
+    sigemptyset( &signals );
+    
+    /* Setup failures are reported through a pipe, which is closed when the command is executed */
+#if defined( __linux__ )
+    
+    if( pipe2( report, O_CLOEXEC ) != 0 )
+    {
+        return errno;
+    }
+
+#else
+    
+    if( pipe( report ) != 0 )
+    {
+        return errno;
+    }
+    
+    fcntl( report[ 0 ], F_SETFD, FD_CLOEXEC );
+    fcntl( report[ 1 ], F_SETFD, FD_CLOEXEC );
+
+#endif
+    
+    child = fork();
+    
+    if( child == -1 )
+    {
+        i = errno;
+        
+        close( report[ 0 ] );
+        close( report[ 1 ] );
+        
+        return i;
+    }
+    
+    if( child == 0 )
+    {
+        for( i = 0; i < 3; i++ )
+        {
+            if( descriptors[ i ] != -1 )
+            {
+                dup2( descriptors[ i ], i );
+            }
+        }
+        
+        if( createsGroup )
+        {
+            setpgid( 0, 0 );
+        }
+        
+        sigprocmask( SIG_SETMASK, &signals, NULL );
+        
+        for( i = 1; i < NSIG; i++ )
+        {
+            sigaction( i, &action, NULL );
+        }
+
+#if defined( __linux__ )
+        
+        if( setsAffinity && sched_setaffinity( 0, sizeof( cpu_set_t ), &cpus ) != 0 )
+        {
+            SKProcessChildFail( report[ 1 ], SKProcessSetupStepAffinity );
+        }
+        
+        if( ioPriority != 0 && syscall( SYS_ioprio_set, 1, 0, ioPriority ) != 0 )
+        {
+            SKProcessChildFail( report[ 1 ], SKProcessSetupStepIOPriority );
+        }
+
+#endif
+        
+        if( setsNice && setpriority( PRIO_PROCESS, 0, nice ) != 0 )
+        {
+            SKProcessChildFail( report[ 1 ], SKProcessSetupStepNice );
+        }
+        
+        for( i = 0; i < count; i++ )
+        {
+            if( setrlimit( resources[ i ], &limits[ i ] ) != 0 )
+            {
+                SKProcessChildFail( report[ 1 ], SKProcessSetupStepLimits );
+            }
+        }
+        
+        /* File descriptors other than the standard ones are not inherited */
+        closed = NO;
+
+#if defined( SYS_close_range )
+        
+        closed = syscall( SYS_close_range, STDERR_FILENO + 1, ~0U, CLOSE_RANGE_CLOEXEC ) == 0;
+
+#endif
+        
+        for( i = STDERR_FILENO + 1; closed == NO && i < maximum; i++ )
+        {
+            fcntl( i, F_SETFD, FD_CLOEXEC );
+        }
+        
+        execve( path, argv, envp );
+        SKProcessChildFail( report[ 1 ], SKProcessSetupStepExec );
+    }
+    
+    close( report[ 1 ] );
+    
+    do
+    {
+        length = read( report[ 0 ], failure, sizeof( failure ) );
+    }
+    while( length == -1 && errno == EINTR );
+    
+    close( report[ 0 ] );
+    
+    if( length == sizeof( failure ) )
+    {
+        while( waitpid( child, NULL, 0 ) == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        
+        *( step ) = ( SKProcessSetupStep )failure[ 0 ];
+        
+        return failure[ 1 ];
+    }
+    
+    *( pid ) = child;
+    
+    return 0;
+}
+
+- ( void )recordOutputFrom: ( NSFileHandle * )source to: ( nullable NSFileHandle * )destination stream: ( int )stream
+{
+    NSDate                               * date;
+    NSMutableArray< SKRecordedOutput * > * output;
+    
+    date   = ( NSDate * )( self.launchDate );
+    output = ( NSMutableArray< SKRecordedOutput * > * )( self.recordedOutput );
+    
+    dispatch_group_async
+    (
+        ( dispatch_group_t )( self.recorders ),
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            char    buffer[ 4096 ];
+            ssize_t length;
+            int     fd;
+            
+            fd = ( destination != nil ) ? destination.fileDescriptor : stream;
+            
+            while( 1 )
+            {
+                length = read( source.fileDescriptor, buffer, sizeof( buffer ) );
+                
+                if( length == -1 && errno == EINTR )
+                {
+                    continue;
+                }
+                
+                if( length <= 0 )
+                {
+                    break;
+                }
+                
+                @synchronized( output )
+                {
+                    [ output addObject: @{ @"time" : @( -[ date timeIntervalSinceNow ] ), @"stream" : @( stream ), @"data" : [ NSData dataWithBytes: buffer length: ( NSUInteger )length ] } ];
+                }
+                
+                SKProcessWrite( fd, buffer, ( size_t )length );
+            }
+            
+            [ source      closeFile ];
+            [ destination closeFile ];
+        }
+    );
+}
+
+- ( void )endRecording
+{
+    SKRecording                          * recording;
+    NSMutableArray< SKRecordedOutput * > * output;
+    NSArray< NSString * >                * arguments;
+    NSTimeInterval                         duration;
+    int                                    status;
+    
+    recording      = ( SKRecording * )( self.recording );
+    output         = ( NSMutableArray< SKRecordedOutput * > * )( self.recordedOutput );
+    arguments      = self.arguments;
+    duration       = -[ ( NSDate * )( self.launchDate ) timeIntervalSinceNow ];
+    status         = self.terminationStatus;
+    self.recording = nil;
+    
+    /* The run is added once all its output has been read */
+    dispatch_group_notify
+    (
+        ( dispatch_group_t )( self.recorders ),
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            NSArray< SKRecordedOutput * > * chunks;
+            
+            @synchronized( output )
+            {
+                chunks = [ output copy ];
+            }
+            
+            [ recording endRunWithArguments: arguments status: status duration: duration output: chunks ];
+        }
+    );
+}
+
+- ( BOOL )replayFromRecording: ( SKRecording * )recording
+{
+    SKRecordedRun * run;
+    NSFileHandle  * input;
+    NSFileHandle  * output;
+    NSFileHandle  * error;
+    double          scale;
+    
+    run = [ recording nextRunWithArguments: self.arguments ];
+    
+    if( run == nil )
+    {
+        self.error = [ self errorWithDescription: @"No recorded run for command: %@", [ self.arguments componentsJoinedByString: @" " ] ];
+        
+        return NO;
+    }
+    
+    input                = self.standardInput.fileHandleForReading;
+    output               = self.standardOutput.fileHandleForWriting;
+    error                = self.standardError.fileHandleForWriting;
+    scale                = MAX( recording.timeScale, 0 );
+    self.replayCondition = [ NSCondition new ];
+    self.replaying       = YES;
+    
+    /* Standard input is discarded, so writers don't block */
+    if( input != nil )
+    {
+        dispatch_async
+        (
+            dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+            ^( void )
+            {
+                char    buffer[ 4096 ];
+                ssize_t length;
+                
+                do
+                {
+                    length = read( input.fileDescriptor, buffer, sizeof( buffer ) );
+                }
+                while( length > 0 || ( length == -1 && errno == EINTR ) );
+                
+                [ input closeFile ];
+            }
+        );
+    }
+    
+    dispatch_async
+    (
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            [ self replayRun: run output: output error: error timeScale: scale ];
+        }
+    );
+    
+    return YES;
+}
+
+- ( void )replayRun: ( SKRecordedRun * )run output: ( nullable NSFileHandle * )output error: ( nullable NSFileHandle * )error timeScale: ( double )scale
+{
+    SKRecordedOutput * chunk;
+    NSData           * data;
+    NSDate           * start;
+    BOOL               killed;
+    int                fd;
+    
+    start  = [ NSDate date ];
+    killed = NO;
+    
+    for( chunk in run[ @"output" ] )
+    {
+        if( [ self waitForReplayUntilDate: [ start dateByAddingTimeInterval: [ chunk[ @"time" ] doubleValue ] * scale ] ] == NO )
+        {
+            killed = YES;
+            
+            break;
+        }
+        
+        data = chunk[ @"data" ];
+        
+        if( [ chunk[ @"stream" ] intValue ] == STDERR_FILENO )
+        {
+            fd = ( error != nil ) ? error.fileDescriptor : STDERR_FILENO;
+        }
+        else
+        {
+            fd = ( output != nil ) ? output.fileDescriptor : STDOUT_FILENO;
+        }
+        
+        SKProcessWrite( fd, data.bytes, data.length );
+    }
+    
+    if( killed == NO )
+    {
+        killed = [ self waitForReplayUntilDate: [ start dateByAddingTimeInterval: [ run[ @"duration" ] doubleValue ] * scale ] ] == NO;
+    }
+    
+    [ output closeFile ];
+    [ error  closeFile ];
+    [ self.replayCondition lock ];
+    
+    self.terminationStatus = ( killed ) ? self.replaySignal : [ run[ @"status" ] intValue ];
+    self.terminationSignal = ( killed ) ? self.replaySignal : 0;
+    self.exited            = YES;
+    
+    [ self.replayCondition broadcast ];
+    [ self.replayCondition unlock ];
+    [ self notifyTermination ];
+}
+
+- ( BOOL )waitForReplayUntilDate: ( NSDate * )date
+{
+    BOOL signaled;
+    
+    [ self.replayCondition lock ];
+    
+    while( self.replaySignal == 0 && [ self.replayCondition waitUntilDate: date ] )
+    {
+        continue;
+    }
+    
+    signaled = self.replaySignal != 0;
+    
+    [ self.replayCondition unlock ];
+    
+    return signaled == NO;
+}
+
+- ( void )reap
+{
+    pid_t pid;
+    int   status;
+    
+    @synchronized( self )
+    {
+        if( self.processIdentifier == 0 || self.exited )
+        {
+            return;
+        }
+        
+        status = 0;
+        pid    = waitpid( self.processIdentifier, &status, WNOHANG );
+        
+        if( pid == self.processIdentifier )
+        {
+            if( WIFEXITED( status ) )
+            {
+                self.terminationStatus = WEXITSTATUS( status );
+            }
+            else if( WIFSIGNALED( status ) )
+            {
+                self.terminationStatus = WTERMSIG( status );
+                self.terminationSignal = WTERMSIG( status );
+            }
+            else
+            {
+                return;
+            }
+            
+            self.exited = YES;
+        }
+        else if( pid == -1 && errno != EINTR )
+        {
+            /* Reaped elsewhere - The status is lost */
+            self.terminationStatus = EXIT_FAILURE;
+            self.exited            = YES;
+        }
+        
+        if( self.exited && self.recording != nil )
+        {
+            [ self endRecording ];
+        }
+        
+        if( self.exited )
+        {
+            [ self notifyTermination ];
+        }
+    }
+}
+
+- ( void )monitorTermination
+{
+    dispatch_source_t source;
+    dispatch_queue_t  queue;
+
+#if !defined( __APPLE__ ) && defined( SYS_pidfd_open )
+    
+    int               fd;
+
+#endif
+    
+    queue  = [ SKProcess terminationQueue ];
+    source = NULL;
+    
+    @synchronized( self )
+    {
+        if( self.terminationHandler == nil || self.exited )
+        {
+            return;
+        }
+
+#if defined( __APPLE__ )
+        
+        source = dispatch_source_create( DISPATCH_SOURCE_TYPE_PROC, ( uintptr_t )( self.processIdentifier ), DISPATCH_PROC_EXIT, queue );
+
+#elif defined( SYS_pidfd_open )
+        
+        /* A process descriptor becomes readable when the process exits */
+        fd = ( int )syscall( SYS_pidfd_open, self.processIdentifier, 0 );
+        
+        if( fd != -1 )
+        {
+            fcntl( fd, F_SETFD, FD_CLOEXEC );
+            
+            source = dispatch_source_create( DISPATCH_SOURCE_TYPE_READ, ( uintptr_t )fd, 0, queue );
+            
+            if( source == NULL )
+            {
+                close( fd );
+            }
+            else
+            {
+                dispatch_source_set_cancel_handler
+                (
+                    source,
+                    ^( void )
+                    {
+                        close( fd );
+                    }
+                );
+            }
+        }
+
+#endif
+        
+        /* Without process descriptors, the exit is polled */
+        if( source == NULL )
+        {
+            source = dispatch_source_create( DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue );
+            
+            dispatch_source_set_timer( source, dispatch_time( DISPATCH_TIME_NOW, 0 ), 10 * NSEC_PER_MSEC, 5 * NSEC_PER_MSEC );
+        }
+        
+        dispatch_source_set_event_handler
+        (
+            source,
+            ^( void )
+            {
+                [ self reap ];
+            }
+        );
+        
+        self.terminationSource = source;
+        
+        dispatch_resume( source );
+    }
+    
+    /* The process may have exited before the source was set up */
+    dispatch_async
+    (
+        queue,
+        ^( void )
+        {
+            [ self reap ];
+        }
+    );
+}
+
+- ( void )notifyTermination
+{
+    void ( ^ handler )( SKProcess * process );
+    dispatch_source_t          source;
+    
+    @synchronized( self )
+    {
+        handler                 = self.terminationHandler;
+        source                  = self.terminationSource;
+        self.terminationHandler = nil;
+        self.terminationSource  = nil;
+    }
+    
+    if( source != nil )
+    {
+        dispatch_source_cancel( source );
+    }
+    
+    if( handler != nil )
+    {
+        dispatch_async
+        (
+            dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+            ^( void )
+            {
+                handler( self );
+            }
+        );
+    }
+}
+
+@end
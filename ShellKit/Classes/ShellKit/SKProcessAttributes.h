@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKProcessAttributes.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKIOPriorityClass
+ * @abstract    I/O scheduling classes, as used by `ionice`
+ */
+typedef NS_ENUM( NSInteger, SKIOPriorityClass )
+{
+    SKIOPriorityClassInherited,     /*! The I/O priority of the parent is inherited */
+    SKIOPriorityClassRealTime,      /*! Real-time class - Requires privileges */
+    SKIOPriorityClassBestEffort,    /*! Best-effort class, the default for most processes */
+    SKIOPriorityClassIdle           /*! Idle class - I/O is only performed when no other process needs it */
+};
+
+/*!
+ * @class       SKProcessAttributes
+ * @abstract    Scheduling attributes and resource limits of a process
+ * @discussion  Attributes are applied in the child process, before the
+ *              command is executed, so they are inherited by all the
+ *              processes it starts.
+ *              If an attribute can't be applied (for instance, a negative
+ *              nice value without privileges), the process isn't launched.
+ *              CPU affinity and I/O priorities are only supported on
+ *              Linux, and ignored elsewhere.
+ */
+@interface SKProcessAttributes: SKObject < NSCopying >
+
+/*!
+ * @property    cpuAffinity
+ * @abstract    The indexes of the CPUs the process may run on
+ * @discussion  If nil, the affinity of the parent is inherited.
+ * @see         availableCPUs
+ */
+@property( atomic, readwrite, strong, nullable ) NSIndexSet * cpuAffinity;
+
+/*!
+ * @property    niceValue
+ * @abstract    The nice value of the process, from -20 to 19
+ * @discussion  If nil, the nice value of the parent is inherited.
+ */
+@property( atomic, readwrite, strong, nullable ) NSNumber * niceValue;
+
+/*!
+ * @property    ioPriorityClass
+ * @abstract    The I/O scheduling class of the process
+ * @discussion  Defaults to `SKIOPriorityClassInherited`.
+ * @see         SKIOPriorityClass
+ * @see         ioPriorityLevel
+ */
+@property( atomic, readwrite, assign ) SKIOPriorityClass ioPriorityClass;
+
+/*!
+ * @property    ioPriorityLevel
+ * @abstract    The I/O priority within the scheduling class, from 0 (highest) to 7
+ * @discussion  Defaults to 4. Not used by the idle class.
+ * @see         ioPriorityClass
+ */
+@property( atomic, readwrite, assign ) NSUInteger ioPriorityLevel;
+
+/*!
+ * @property    addressSpaceLimit
+ * @abstract    The maximum size of the virtual memory of the process, in bytes
+ * @discussion  Sets the soft `RLIMIT_AS` limit. Zero means inherited.
+ */
+@property( atomic, readwrite, assign ) uint64_t addressSpaceLimit;
+
+/*!
+ * @property    openFilesLimit
+ * @abstract    The maximum number of open files of the process
+ * @discussion  Sets the soft `RLIMIT_NOFILE` limit. Zero means inherited.
+ */
+@property( atomic, readwrite, assign ) uint64_t openFilesLimit;
+
+/*!
+ * @property    cpuTimeLimit
+ * @abstract    The maximum CPU time of the process, in seconds
+ * @discussion  Sets the soft `RLIMIT_CPU` limit - The process receives
+ *              `SIGXCPU` when it is reached. Zero means inherited.
+ */
+@property( atomic, readwrite, assign ) uint64_t cpuTimeLimit;
+
+/*!
+ * @method      availableCPUs
+ * @abstract    Gets the indexes of the CPUs the current process may run on
+ * @result      The CPU indexes
+ */
++ ( NSIndexSet * )availableCPUs;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,106 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKProcessAttributes.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+/* Needed for the CPU affinity functions of glibc */
+#if defined( __linux__ ) && !defined( _GNU_SOURCE )
+#define _GNU_SOURCE
+#endif
+
+#import <ShellKit/ShellKit.h>
+
+#if defined( __linux__ )
+#import <sched.h>
+#endif
+
+@implementation SKProcessAttributes
+
++ ( NSIndexSet * )availableCPUs
+{
+    NSMutableIndexSet * cpus;
+    
+    cpus = [ NSMutableIndexSet new ];
+
+#if defined( __linux__ )
+    
+    {
+        cpu_set_t set;
+        int       i;
+        
+        CPU_ZERO( &set );
+        
+        if( sched_getaffinity( 0, sizeof( cpu_set_t ), &set ) == 0 )
+        {
+            for( i = 0; i < CPU_SETSIZE; i++ )
+            {
+                if( CPU_ISSET( i, &set ) )
+                {
+                    [ cpus addIndex: ( NSUInteger )i ];
+                }
+            }
+        }
+    }
+
+#endif
+    
+    if( cpus.count == 0 )
+    {
+        [ cpus addIndexesInRange: NSMakeRange( 0, MAX( [ NSProcessInfo processInfo ].activeProcessorCount, ( NSUInteger )1 ) ) ];
+    }
+    
+    return cpus;
+}
+
+- ( instancetype )init
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.ioPriorityLevel = 4;
+    }
+    
+    return self;
+}
+
+- ( id )copyWithZone: ( nullable NSZone * )zone
+{
+    SKProcessAttributes * copy;
+    
+    copy = [ [ SKProcessAttributes allocWithZone: zone ] init ];
+    
+    copy.cpuAffinity       = [ self.cpuAffinity copy ];
+    copy.niceValue         = self.niceValue;
+    copy.ioPriorityClass   = self.ioPriorityClass;
+    copy.ioPriorityLevel   = self.ioPriorityLevel;
+    copy.addressSpaceLimit = self.addressSpaceLimit;
+    copy.openFilesLimit    = self.openFilesLimit;
+    copy.cpuTimeLimit      = self.cpuTimeLimit;
+    
+    return copy;
+}
+
+@end
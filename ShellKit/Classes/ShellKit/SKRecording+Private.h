@@ -0,0 +1,82 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKRecording+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private interface of SKRecording, used by SKProcess
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKRecording.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKRecordedOutput
+ * @abstract    A chunk of recorded output
+ * @discussion  Keys are `time` (seconds since the launch of the process),
+ *              `stream` (1 for `stdout`, 2 for `stderr`) and `data`.
+ */
+typedef NSDictionary< NSString *, id > SKRecordedOutput;
+
+/*!
+ * @typedef     SKRecordedRun
+ * @abstract    A recorded run of a process
+ * @discussion  Keys are `arguments`, `status`, `duration` and `output` (an
+ *              array of `SKRecordedOutput` dictionaries).
+ */
+typedef NSDictionary< NSString *, id > SKRecordedRun;
+
+@interface SKRecording()
+
+/*!
+ * @method      beginRun
+ * @abstract    Notifies the recording that a process has been launched
+ * @discussion  Each call must be balanced by a call to
+ *              `endRunWithArguments:status:duration:output:`.
+ */
+- ( void )beginRun;
+
+/*!
+ * @method      endRunWithArguments:status:duration:output:
+ * @abstract    Adds a run to the recording
+ * @param       arguments   The arguments of the process
+ * @param       status      The termination status of the process
+ * @param       duration    The time the process took to run
+ * @param       output      The output chunks of the process
+ */
+- ( void )endRunWithArguments: ( NSArray< NSString * > * )arguments status: ( int )status duration: ( NSTimeInterval )duration output: ( NSArray< SKRecordedOutput * > * )output;
+
+/*!
+ * @method      nextRunWithArguments:
+ * @abstract    Gets the next recorded run of a process
+ * @param       arguments   The arguments of the process
+ * @result      The run, or nil if the process wasn't recorded
+ */
+- ( nullable SKRecordedRun * )nextRunWithArguments: ( NSArray< NSString * > * )arguments;
+
+@end
+
+NS_ASSUME_NONNULL_END
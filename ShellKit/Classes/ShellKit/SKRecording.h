@@ -0,0 +1,148 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKRecording.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKRecordingMode
+ * @abstract    How processes are run while a recording is set
+ */
+typedef NS_ENUM( NSInteger, SKRecordingMode )
+{
+    SKRecordingModeRecord,  /*! Processes are run, and their output, exit status and timing are recorded */
+    SKRecordingModeReplay   /*! Processes are not run - Their recorded output and exit status are replayed */
+};
+
+/*!
+ * @class       SKRecording
+ * @abstract    An execution backend recording or replaying processes
+ * @discussion  When set as the recording of the current shell, all the
+ *              processes started by ShellKit (tasks, services, batches and
+ *              shell commands) go through the recording.
+ *              
+ *              In record mode, processes are run as usual. Their output
+ *              is recorded as it is produced, along with its timing, the
+ *              exit status, and the duration of the process.
+ *              
+ *              In replay mode, no process is spawned. The recorded output
+ *              is written to the process' pipes (or to the terminal) with
+ *              its original timing, and the process exits with its
+ *              recorded status. Tasks and task groups behave as with
+ *              real processes, including delegate callbacks, recovery and
+ *              cancellation. Standard input is read and discarded.
+ *              
+ *              Runs are identified by the arguments of the process, which
+ *              contain the rendered script. A command run several times
+ *              is replayed in order, the last run being reused once the
+ *              recorded ones are exhausted. Launching a command that
+ *              wasn't recorded fails.
+ *              Note that services waiting for a ready path won't get ready
+ *              when replayed, as nothing creates the path.
+ */
+@interface SKRecording: SKObject
+
+/*!
+ * @property    path
+ * @abstract    The path of the recording file
+ */
+@property( atomic, readonly ) NSString * path;
+
+/*!
+ * @property    mode
+ * @abstract    Whether processes are recorded or replayed
+ * @see         SKRecordingMode
+ */
+@property( atomic, readonly ) SKRecordingMode mode;
+
+/*!
+ * @property    timeScale
+ * @abstract    The factor applied to recorded times, when replaying
+ * @discussion  Defaults to 1, meaning processes take as long as when they
+ *              were recorded. 0.1 replays ten times faster, and 0 replays
+ *              without any delay.
+ */
+@property( atomic, readwrite, assign ) double timeScale;
+
+/*!
+ * @property    numberOfRuns
+ * @abstract    The number of recorded runs
+ */
+@property( atomic, readonly ) NSUInteger numberOfRuns;
+
+/*!
+ * @property    error
+ * @abstract    An optional error, set if the recording could not be saved
+ * @see         save
+ */
+@property( atomic, readonly, nullable ) NSError * error;
+
+/*!
+ * @method      recordingToPath:
+ * @abstract    Creates a recording in record mode
+ * @discussion  Runs are written to the file when `save` is called.
+ * @param       path    The path of the recording file
+ * @result      The recording object
+ * @see         save
+ */
++ ( instancetype )recordingToPath: ( NSString * )path;
+
+/*!
+ * @method      recordingFromPath:
+ * @abstract    Creates a recording in replay mode
+ * @param       path    The path of a file written by a recording
+ * @result      The recording object, or nil if the file can't be read
+ */
++ ( nullable instancetype )recordingFromPath: ( NSString * )path;
+
+/*!
+ * @method      initWithPath:mode:
+ * @abstract    Creates a recording
+ * @discussion  In replay mode, the recording file is read.
+ * @param       path    The path of the recording file
+ * @param       mode    The mode of the recording
+ * @result      The recording object, or nil if the file can't be read in replay mode
+ */
+- ( nullable instancetype )initWithPath: ( NSString * )path mode: ( SKRecordingMode )mode NS_DESIGNATED_INITIALIZER;
+
+/*!
+ * @method      save
+ * @abstract    Writes the recorded runs to the recording file
+ * @discussion  Waits for the output of running processes to be recorded.
+ *              Does nothing in replay mode.
+ * @result      YES if the file was written, otherwise NO
+ * @see         error
+ */
+- ( BOOL )save;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,206 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKRecording.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKRecording+Private.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKRecording()
+
+@property( atomic, readwrite, strong           ) NSString                          * path;
+@property( atomic, readwrite, assign           ) SKRecordingMode                     mode;
+@property( atomic, readwrite, strong, nullable ) NSError                           * error;
+@property( atomic, readwrite, strong           ) NSMutableArray< SKRecordedRun * > * runs;
+@property( atomic, readwrite, strong           ) NSMutableDictionary               * runsByArguments;
+@property( atomic, readwrite, strong           ) NSMutableDictionary               * cursors;
+@property( atomic, readwrite, strong           ) dispatch_group_t                    pending;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKRecording
+
++ ( instancetype )recordingToPath: ( NSString * )path
+{
+    return ( SKRecording * )[ [ self alloc ] initWithPath: path mode: SKRecordingModeRecord ];
+}
+
++ ( nullable instancetype )recordingFromPath: ( NSString * )path
+{
+    return [ [ self alloc ] initWithPath: path mode: SKRecordingModeReplay ];
+}
+
+- ( instancetype )init
+{
+    return ( SKRecording * )[ self initWithPath: @"" mode: SKRecordingModeRecord ];
+}
+
+- ( nullable instancetype )initWithPath: ( NSString * )path mode: ( SKRecordingMode )mode
+{
+    NSData           * data;
+    NSDictionary     * recording;
+    NSArray          * runs;
+    SKRecordedRun    * run;
+    SKRecordedOutput * chunk;
+    
+    if( ( self = [ super init ] ) )
+    {
+        self.path            = path;
+        self.mode            = mode;
+        self.timeScale       = 1;
+        self.runs            = [ NSMutableArray new ];
+        self.runsByArguments = [ NSMutableDictionary new ];
+        self.cursors         = [ NSMutableDictionary new ];
+        self.pending         = dispatch_group_create();
+        
+        if( mode == SKRecordingModeRecord )
+        {
+            return self;
+        }
+        
+        data      = [ NSData dataWithContentsOfFile: path ];
+        recording = ( data ) ? [ NSPropertyListSerialization propertyListWithData: ( NSData * )data options: NSPropertyListImmutable format: NULL error: NULL ] : nil;
+        runs      = ( [ recording isKindOfClass: [ NSDictionary class ] ] ) ? recording[ @"runs" ] : nil;
+        
+        if( [ runs isKindOfClass: [ NSArray class ] ] == NO )
+        {
+            return nil;
+        }
+        
+        for( run in runs )
+        {
+            if( [ run isKindOfClass: [ NSDictionary class ] ] == NO || [ run[ @"arguments" ] isKindOfClass: [ NSArray class ] ] == NO || [ run[ @"output" ] isKindOfClass: [ NSArray class ] ] == NO )
+            {
+                return nil;
+            }
+            
+            for( chunk in run[ @"output" ] )
+            {
+                if( [ chunk isKindOfClass: [ NSDictionary class ] ] == NO || [ chunk[ @"data" ] isKindOfClass: [ NSData class ] ] == NO )
+                {
+                    return nil;
+                }
+            }
+            
+            [ self.runs addObject: run ];
+            
+            if( self.runsByArguments[ run[ @"arguments" ] ] == nil )
+            {
+                self.runsByArguments[ run[ @"arguments" ] ] = [ NSMutableArray new ];
+            }
+            
+            [ self.runsByArguments[ run[ @"arguments" ] ] addObject: run ];
+        }
+    }
+    
+    return self;
+}
+
+- ( NSUInteger )numberOfRuns
+{
+    @synchronized( self.runs )
+    {
+        return self.runs.count;
+    }
+}
+
+- ( BOOL )save
+{
+    NSData  * data;
+    NSArray * runs;
+    NSError * error;
+    
+    if( self.mode != SKRecordingModeRecord )
+    {
+        return YES;
+    }
+    
+    /* Runs are added once all their output has been read */
+    dispatch_group_wait( self.pending, DISPATCH_TIME_FOREVER );
+    
+    @synchronized( self.runs )
+    {
+        runs = [ self.runs copy ];
+    }
+    
+    error = nil;
+    data  = [ NSPropertyListSerialization dataWithPropertyList: @{ @"version" : @1, @"runs" : runs } format: NSPropertyListBinaryFormat_v1_0 options: 0 error: &error ];
+    
+    if( data == nil || [ data writeToFile: self.path options: NSDataWritingAtomic error: &error ] == NO )
+    {
+        self.error = ( error ) ? error : [ self errorWithDescription: @"Cannot write recording to %@", self.path ];
+        
+        return NO;
+    }
+    
+    return YES;
+}
+
+#pragma mark - Private
+
+- ( void )beginRun
+{
+    dispatch_group_enter( self.pending );
+}
+
+- ( void )endRunWithArguments: ( NSArray< NSString * > * )arguments status: ( int )status duration: ( NSTimeInterval )duration output: ( NSArray< SKRecordedOutput * > * )output
+{
+    @synchronized( self.runs )
+    {
+        [ self.runs addObject: @{ @"arguments" : [ arguments copy ], @"status" : @( status ), @"duration" : @( duration ), @"output" : [ output copy ] } ];
+    }
+    
+    dispatch_group_leave( self.pending );
+}
+
+- ( nullable SKRecordedRun * )nextRunWithArguments: ( NSArray< NSString * > * )arguments
+{
+    NSArray< SKRecordedRun * > * runs;
+    NSUInteger                   cursor;
+    
+    @synchronized( self.runs )
+    {
+        runs = self.runsByArguments[ arguments ];
+        
+        if( runs.count == 0 )
+        {
+            return nil;
+        }
+        
+        /* Runs of a command are replayed in order, the last one being reused */
+        cursor                    = [ self.cursors[ arguments ] unsignedIntegerValue ];
+        self.cursors[ arguments ] = @( cursor + 1 );
+        
+        return runs[ MIN( cursor, runs.count - 1 ) ];
+    }
+}
+
+@end
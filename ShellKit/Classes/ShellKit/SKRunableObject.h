@@ -28,6 +28,8 @@
  */
 
 #import <Foundation/Foundation.h>
+#import <ShellKit/SKTaskStatus.h>
+#import <ShellKit/SKFuture.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -67,6 +69,36 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables;
 
+@optional
+
+/*!
+ * @method      snapshot
+ * @abstract    Gets the current execution status of the runnable object
+ * @discussion  This method is optional, and may be called from any thread,
+ *              while the object is running.
+ *              Runnable objects not implementing it are reported by task
+ *              groups as pending or running, from their `running`
+ *              property.
+ * @result      An immutable status snapshot
+ * @see         SKTaskStatus
+ */
+- ( SKTaskStatus * )snapshot;
+
+/*!
+ * @method      runAsynchronously:
+ * @abstract    Runs the task with variables (asynchronously)
+ * @discussion  This method is optional. It returns immediately, and the run
+ *              is driven by events (process exit and output), so it doesn't
+ *              need a thread while waiting.
+ *              Use `+[ SKFuture futureByRunning:variables: ]` to run any
+ *              runnable object asynchronously - Objects not implementing
+ *              this method are run on a background thread.
+ * @param       variables   Optional variables
+ * @result      A future, finishing when the runnable object has run
+ * @see         SKFuture
+ */
+- ( SKFuture * )runAsynchronously: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -0,0 +1,123 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKShell+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private SKShell interface, shared with other ShellKit classes
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKShell.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKShell()
+
+/*!
+ * @method      messageBufferForCurrentThread
+ * @abstract    Gets the buffer messages printed from the current thread are
+ *              appended to
+ * @result      The buffer, or nil if messages are printed to `stdout`
+ */
+- ( nullable NSMutableString * )messageBufferForCurrentThread;
+
+/*!
+ * @method      setMessageBufferForCurrentThread:
+ * @abstract    Sets a buffer for messages printed from the current thread
+ * @discussion  Buffered messages are prefixed by the prompt as it is when
+ *              they are appended, as it may have changed when they are
+ *              eventually printed.
+ * @param       buffer  The buffer, or nil to print messages to `stdout`
+ */
+- ( void )setMessageBufferForCurrentThread: ( nullable NSMutableString * )buffer;
+
+/*!
+ * @method      performWithMessageBuffer:block:
+ * @abstract    Runs a block with a message buffer set for the current thread
+ * @discussion  The previous buffer of the thread is restored afterwards.
+ *              Asynchronous runs continue on arbitrary threads, so they
+ *              set their buffer around each step.
+ * @param       buffer  The buffer, or nil to print messages to `stdout`
+ * @param       block   The block to run
+ */
+- ( void )performWithMessageBuffer: ( nullable NSMutableString * )buffer block: ( void ( ^ )( void ) )block;
+
+/*!
+ * @method      promptHierarchyForCurrentThread
+ * @abstract    Gets the prompts messages printed from the current thread use
+ * @discussion  The last prompt is the current one, and each previous one is
+ *              the prompt without the last part. Without a hierarchy of its
+ *              own, the thread uses the shell's prompt parts.
+ * @result      The prompt for each depth of the hierarchy
+ */
+- ( NSArray< NSString * > * )promptHierarchyForCurrentThread;
+
+/*!
+ * @method      setPromptHierarchyForCurrentThread:
+ * @abstract    Gives the current thread a prompt hierarchy of its own
+ * @discussion  Prompt parts added and removed from the thread then only
+ *              change its own hierarchy, so tasks running in parallel
+ *              don't push and pop each other's parts.
+ * @param       hierarchy   The hierarchy, as returned by
+ *                          `promptHierarchyForCurrentThread`, or nil to use
+ *                          the shell's prompt parts
+ */
+- ( void )setPromptHierarchyForCurrentThread: ( nullable NSArray< NSString * > * )hierarchy;
+
+/*!
+ * @method      promptHierarchyForCurrentThreadByAddingPart:
+ * @abstract    Gets the prompt hierarchy of the current thread, with a part
+ *              added
+ * @discussion  Neither the thread's hierarchy nor the shell's prompt parts
+ *              are changed. Asynchronous runs use this to add their name to
+ *              the prompt of the steps they continue on other threads.
+ * @param       part    The prompt part to add
+ * @result      The hierarchy, for `performWithMessageBuffer:promptHierarchy:block:`
+ * @see         addPromptPart:
+ */
+- ( NSArray< NSString * > * )promptHierarchyForCurrentThreadByAddingPart: ( NSString * )part;
+
+/*!
+ * @method      performWithMessageBuffer:promptHierarchy:block:
+ * @abstract    Runs a block with a message buffer and a prompt hierarchy set
+ *              for the current thread
+ * @discussion  The previous buffer and hierarchy of the thread are restored
+ *              afterwards.
+ * @param       buffer      The buffer, or nil to print messages to `stdout`
+ * @param       hierarchy   The hierarchy, or nil to use the shell's prompt parts
+ * @param       block       The block to run
+ */
+- ( void )performWithMessageBuffer: ( nullable NSMutableString * )buffer promptHierarchy: ( nullable NSArray< NSString * > * )hierarchy block: ( void ( ^ )( void ) )block;
+
+/*!
+ * @method      printBufferedMessages:
+ * @abstract    Prints the content of a message buffer to `stdout`
+ * @param       buffer  The buffer
+ */
+- ( void )printBufferedMessages: ( NSMutableString * )buffer;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -29,6 +29,10 @@
 
 #import <Foundation/Foundation.h>
 #import <ShellKit/SKTypes.h>
+#import <ShellKit/SKEnvironment.h>
+#import <ShellKit/SKEventStream.h>
+#import <ShellKit/SKConcurrencyLimiter.h>
+#import <ShellKit/SKRecording.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -50,6 +54,13 @@ typedef void ( ^ SKShellCommandCompletion )( int status, NSString * stdandardOut
 /*!
  * @property    supportsColors
  * @abstract    Set if the current erminal supports color
+ * @discussion  Detected the first time colored output is produced, and not
+ *              when the shell object is created.
+ *              A non-empty `NO_COLOR` environment variable disables colors,
+ *              and `FORCE_COLOR` enables them (unless set to `0`), without
+ *              querying the terminal. Otherwise, colors are only supported
+ *              if `stdout` is a terminal, and if its terminfo entry can be
+ *              loaded.
  */
 @property( atomic, readonly ) BOOL supportsColors;
 
@@ -105,6 +116,58 @@ typedef void ( ^ SKShellCommandCompletion )( int status, NSString * stdandardOut
  */
 @property( atomic, readonly, nullable ) NSString * shell;
 
+/*!
+ * @property    environment
+ * @abstract    The environment of commands run by the shell
+ * @discussion  Defaults to nil, meaning commands inherit the current
+ *              environment of the process, including variables changed
+ *              with `setenv` after the shell was created. Also used by
+ *              tasks that don't have an environment of their own.
+ *              The environment is converted only once for all spawned
+ *              processes, so it should be set once rather than rebuilt for
+ *              each command.
+ * @see         SKEnvironment
+ */
+@property( atomic, readwrite, strong, nullable ) SKEnvironment * environment;
+
+/*!
+ * @property    eventStream
+ * @abstract    An optional stream of machine-readable events
+ * @discussion  When set, task and task group events, as well as warnings
+ *              and errors, are written to the stream as JSON Lines, in
+ *              addition to the messages printed to the terminal.
+ *              While a stream is set, the output of tasks is captured, so
+ *              it can be reported. It is still printed to the terminal.
+ * @see         SKEventStream
+ */
+@property( atomic, readwrite, strong, nullable ) SKEventStream * eventStream;
+
+/*!
+ * @property    concurrencyLimiter
+ * @abstract    An optional limiter for asynchronous commands
+ * @discussion  When set, asynchronous commands wait for a slot of the
+ *              limiter before running, in the order they were submitted,
+ *              so the number of concurrent commands follows the load of
+ *              the host. Otherwise, asynchronous commands run right away.
+ * @see         SKConcurrencyLimiter
+ * @see         runCommandAsynchronously:
+ */
+@property( atomic, readwrite, strong, nullable ) SKConcurrencyLimiter * concurrencyLimiter;
+
+/*!
+ * @property    recording
+ * @abstract    An optional recording, used as execution backend
+ * @discussion  When recording, every process launched by the shell, its
+ *              tasks and task groups is run normally, and its output, exit
+ *              status and timing are added to the recording.
+ *              When replaying, processes aren't spawned: their output and
+ *              exit status are reproduced from the recording, so delegates,
+ *              event streams and task groups behave as they did.
+ *              Tasks are not batched while a recording is set.
+ * @see         SKRecording
+ */
+@property( atomic, readwrite, strong, nullable ) SKRecording * recording;
+
 /*!
  * @method      currentShell
  * @abstract    Gets the instance representing the current shell
@@ -28,28 +28,44 @@
  */
 
 #import <ShellKit/ShellKit.h>
+#import "SKProcess.h"
+#import "SKShell+Private.h"
+#import "SKEventStream+Private.h"
 #import <curses.h>
 #import <term.h>
+#import <stdlib.h>
+#import <string.h>
+#import <unistd.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 @interface SKShell()
 
-@property( atomic, readwrite, assign           ) BOOL                    observingPrompt;
 @property( atomic, readwrite, assign           ) BOOL                    hasPromptParts;
-@property( atomic, readwrite, assign           ) BOOL                    supportsColors;
+@property( atomic, readwrite, assign           ) BOOL                    detectedColors;
+@property( atomic, readwrite, assign           ) BOOL                    terminalSupportsColors;
 @property( atomic, readwrite, strong           ) NSArray< NSString * > * promptStrings;
+@property( atomic, readwrite, strong, nullable ) NSMutableArray        * renderedPrompts;
 @property( atomic, readwrite, strong           ) dispatch_queue_t        dispatchQueue;
+@property( atomic, readwrite, strong           ) dispatch_queue_t        admissionQueue;
 @property( atomic, readwrite, strong, nullable ) NSString              * shell;
 
-- ( void )observerPrompt: ( BOOL )observe;
+- ( BOOL )detectColors;
+- ( nullable NSMutableArray< NSString * > * )threadPromptHierarchy;
+- ( NSString * )prompt: ( NSString * )prompt byAddingPart: ( NSString * )part depth: ( NSUInteger )depth;
 
 @end
 
 NS_ASSUME_NONNULL_END
 
+static NSString * const SKShellMessageBufferKey   = @"SKShellMessageBuffer";
+static NSString * const SKShellPromptHierarchyKey = @"SKShellPromptHierarchy";
+static const SKColor     SKShellPromptColors[]     = { SKColorCyan, SKColorBlue, SKColorPurple };
+
 @implementation SKShell
 
+@synthesize prompt = _prompt;
+
 + ( instancetype )currentShell
 {
     static dispatch_once_t once;
@@ -69,66 +85,87 @@ NS_ASSUME_NONNULL_END
 
 - ( instancetype )init
 {
-    int err;
-    
     if( ( self = [ super init ] ) )
     {
         self.shell                = [ NSProcessInfo processInfo ].environment[ @"SHELL" ];
         self.promptStrings        = @[];
         self.allowPromptHierarchy = YES;
         self.dispatchQueue        = dispatch_queue_create( "com.xs-labs.ShellKit.SKShell", DISPATCH_QUEUE_CONCURRENT );
-        
-        if( setupterm( NULL, 1, &err ) == ERR )
-        {
-            self.supportsColors = NO;
-        }
-        else
-        {
-            self.supportsColors = YES;
-        }
-        
-        self.colorsEnabled      = YES;
-        self.statusIconsEnabled = YES;
-        
-        [ self observerPrompt: YES ];
+        self.admissionQueue       = dispatch_queue_create( "com.xs-labs.ShellKit.SKShell.Admission", DISPATCH_QUEUE_SERIAL );
+        self.colorsEnabled        = YES;
+        self.statusIconsEnabled   = YES;
     }
     
     return self;
 }
 
-- ( void )dealloc
+- ( BOOL )supportsColors
 {
-    [ self observerPrompt: NO ];
+    if( self.detectedColors == NO )
+    {
+        @synchronized( self )
+        {
+            if( self.detectedColors == NO )
+            {
+                self.terminalSupportsColors = [ self detectColors ];
+                self.detectedColors         = YES;
+            }
+        }
+    }
+    
+    return self.terminalSupportsColors;
 }
 
-- ( void )observerPrompt: ( BOOL )observe
+- ( BOOL )detectColors
 {
-    if( observe && self.observingPrompt == NO )
+    const char * env;
+    int          err;
+    
+    /* See https://no-color.org */
+    env = getenv( "NO_COLOR" );
+    
+    if( env != NULL && env[ 0 ] != 0 )
     {
-        [ self addObserver: self forKeyPath: NSStringFromSelector( @selector( prompt ) ) options: NSKeyValueObservingOptionNew context: NULL ];
-        
-        self.observingPrompt = YES;
+        return NO;
     }
-    else if( observe == NO && self.observingPrompt )
+    
+    env = getenv( "FORCE_COLOR" );
+    
+    if( env != NULL )
     {
-        [ self removeObserver: self forKeyPath: NSStringFromSelector( @selector( prompt ) ) ];
-        
-        self.observingPrompt = NO;
+        return strcmp( env, "0" ) != 0 && strcmp( env, "false" ) != 0;
+    }
+    
+    if( isatty( STDOUT_FILENO ) == 0 )
+    {
+        return NO;
     }
+    
+    env = getenv( "TERM" );
+    
+    if( env == NULL || env[ 0 ] == 0 || strcmp( env, "dumb" ) == 0 )
+    {
+        return NO;
+    }
+    
+    return setupterm( NULL, STDOUT_FILENO, &err ) != ERR;
 }
 
-- ( void )observeValueForKeyPath: ( NSString * )keyPath ofObject: ( id )object change: ( NSDictionary * )change context: ( void * )context
+- ( nullable NSString * )prompt
 {
-    if( object == self && [ keyPath isEqualToString: NSStringFromSelector( @selector( prompt ) )  ] )
+    @synchronized( self )
     {
-        @synchronized( self )
-        {
-            self.promptStrings = @[];
-        }
+        return _prompt;
     }
-    else
+}
+
+- ( void )setPrompt: ( nullable NSString * )prompt
+{
+    @synchronized( self )
     {
-        [ super observeValueForKeyPath: keyPath ofObject: object change: change context: context ];
+        _prompt              = [ prompt copy ];
+        self.promptStrings   = @[];
+        self.renderedPrompts = nil;
     }
 }
 
@@ -195,22 +232,27 @@ NS_ASSUME_NONNULL_END
 
 - ( BOOL )runCommand: ( NSString * )command stdandardInput: ( nullable NSString * )input completion: ( nullable  void ( ^ )( int status, NSString * stdandardOutput, NSString * standardError ) )completion
 {
-    NSTask       * task;
-    NSPipe       * stdinPipe;
-    NSPipe       * stdoutPipe;
-    NSPipe       * stderrPipe;
+    SKProcess        * task;
+    NSPipe           * stdinPipe;
+    NSPipe           * stdoutPipe;
+    NSPipe           * stderrPipe;
+    dispatch_group_t   group;
+    __block NSData   * outputData;
+    __block NSData   * errorData;
         
     if( self.shell.length == NO || [ [ NSFileManager defaultManager ] fileExistsAtPath: self.shell ] == NO )
     {
-        @throw [ NSException exceptionWithName: @"com.xs-labs.ShellKit.SKShellException" reason: @"SHELL environment variable is not defined" userInfo: [ NSProcessInfo processInfo ].environment ];
+        @throw [ NSException exceptionWithName: @"com.xs-labs.ShellKit.SKShellException" reason: @"SHELL environment variable is not defined" userInfo: nil ];
     }
     
     stdinPipe           = [ NSPipe pipe ];
     stdoutPipe          = [ NSPipe pipe ];
     stderrPipe          = [ NSPipe pipe ];
-    task                = [ NSTask new ];
-    task.launchPath     = self.shell;
+    group               = dispatch_group_create();
+    task                = [ SKProcess new ];
+    task.launchPath     = ( NSString * )( self.shell );
     task.arguments      = @[ @"-l", @"-c", command ];
+    task.environment    = self.environment;
     task.standardOutput = stdoutPipe;
     task.standardError  = stderrPipe;
     
@@ -219,43 +261,78 @@ NS_ASSUME_NONNULL_END
         task.standardInput = stdinPipe;
     }
     
-    [ task launch ];
-    
-    if( input )
+    if( [ task launch ] == NO )
     {
-        [ stdinPipe.fileHandleForWriting writeData: [ input dataUsingEncoding: NSUTF8StringEncoding ] ];
+        return NO;
     }
     
-    [ task waitUntilExit ];
-    
-    if( completion )
-    {
+    /*
+     * Output is read while the command is running, as the command would
+     * otherwise block once the pipe buffers are full.
+     */
+    dispatch_group_async
+    (
+        group,
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
         {
-            NSString * output;
-            NSString * error;
-            
             @try
             {
-                output = [ [ NSString alloc ] initWithData: [ stdoutPipe.fileHandleForReading readDataToEndOfFile ] encoding: NSUTF8StringEncoding ];
+                outputData = [ stdoutPipe.fileHandleForReading readDataToEndOfFile ];
             }
             @catch( NSException * exception )
             {
                 ( void )exception;
                 
-                output = nil;
+                outputData = nil;
             }
-            
+        }
+    );
+    
+    dispatch_group_async
+    (
+        group,
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
             @try
             {
-                error = [ [ NSString alloc ] initWithData: [ stdoutPipe.fileHandleForReading readDataToEndOfFile ] encoding: NSUTF8StringEncoding ];
+                errorData = [ stderrPipe.fileHandleForReading readDataToEndOfFile ];
             }
             @catch( NSException * exception )
             {
                 ( void )exception;
                 
-                error = nil;
+                errorData = nil;
             }
+        }
+    );
+    
+    if( input )
+    {
+        @try
+        {
+            [ stdinPipe.fileHandleForWriting writeData: ( NSData * )[ input dataUsingEncoding: NSUTF8StringEncoding ] ];
+            [ stdinPipe.fileHandleForWriting closeFile ];
+        }
+        @catch( NSException * exception )
+        {
+            ( void )exception;
+        }
+    }
+    
+    dispatch_group_wait( group, DISPATCH_TIME_FOREVER );
+    
+    [ task waitUntilExit ];
+    
+    if( completion )
+    {
+        {
+            NSString * output;
+            NSString * error;
             
+            output = ( outputData ) ? [ [ NSString alloc ] initWithData: outputData encoding: NSUTF8StringEncoding ] : nil;
+            error  = ( errorData  ) ? [ [ NSString alloc ] initWithData: errorData  encoding: NSUTF8StringEncoding ] : nil;
             output = [ output stringByTrimmingCharactersInSet: [ NSCharacterSet whitespaceAndNewlineCharacterSet ] ];
             error  = [ error  stringByTrimmingCharactersInSet: [ NSCharacterSet whitespaceAndNewlineCharacterSet ] ];            
             
@@ -288,12 +365,41 @@ NS_ASSUME_NONNULL_END
 
 - ( void )runCommandAsynchronously: ( NSString * )command stdandardInput: ( nullable NSString * )input completion: ( nullable void ( ^ )( int status, NSString * stdandardOutput, NSString * standardError ) )completion
 {
+    SKConcurrencyLimiter * limiter;
+    
+    limiter = self.concurrencyLimiter;
+    
+    if( limiter == nil )
+    {
+        dispatch_async
+        (
+            self.dispatchQueue,
+            ^( void )
+            {
+                [ self runCommand: command stdandardInput: input completion: completion ];
+            }
+        );
+        
+        return;
+    }
+    
+    /* Commands wait for a slot on a serial queue, so they're admitted in order, without blocking workers */
     dispatch_async
     (
-        self.dispatchQueue,
+        self.admissionQueue,
         ^( void )
         {
-            [ self runCommand: command stdandardInput: input completion: completion ];
+            [ limiter acquireSlots: 1 ];
+            
+            dispatch_async
+            (
+                self.dispatchQueue,
+                ^( void )
+                {
+                    [ self runCommand: command stdandardInput: input completion: completion ];
+                    [ limiter releaseSlots: 1 ];
+                }
+            );
         }
     );
 }
@@ -311,6 +417,7 @@ NS_ASSUME_NONNULL_END
         message = @"An unknown error occured";
     }
     
+    [ self.eventStream writeError: ( error.localizedDescription.length ) ? ( NSString * )( error.localizedDescription ) : message ];
     [ self printMessage: @"%@" status: SKStatusError color: SKColorRed, message ];
 }
 
@@ -341,6 +448,7 @@ NS_ASSUME_NONNULL_END
     
     va_end( ap );
     
+    [ self.eventStream writeWarning: message ];
     [ self printMessage: @"%@" status: SKStatusWarning color: SKColorYellow, message ];
 }
 
@@ -416,10 +524,11 @@ NS_ASSUME_NONNULL_END
 
 - ( void )printMessage: ( NSString * )format status: ( SKStatus )status color: ( SKColor )color, ...
 {
-    NSString * p;
-    NSString * s;
-    NSString * message;
-    va_list    ap;
+    NSString        * p;
+    NSString        * s;
+    NSString        * message;
+    NSMutableString * buffer;
+    va_list           ap;
     
     @synchronized( self )
     {
@@ -429,14 +538,28 @@ NS_ASSUME_NONNULL_END
         
         va_end( ap );
         
-        p = ( self.prompt ) ? self.prompt : @"";
-        s = [ NSString stringForShellStatus: status ];
+        p      = [ self threadPromptHierarchy ].lastObject;
+        p      = ( p ) ? p : self.prompt;
+        p      = ( p ) ? p : @"";
+        s      = [ NSString stringForShellStatus: status ];
+        buffer = [ self messageBufferForCurrentThread ];
         
         if( s.length > 0 )
         {
             s = [ s stringByAppendingString: @"  " ];
         }
         
+        /* The prompt is captured now, as it may have changed when the buffer is printed */
+        if( buffer != nil )
+        {
+            @synchronized( buffer )
+            {
+                [ buffer appendFormat: @"%@%@%@\n", p, s, [ message stringWithShellColor: color ] ];
+            }
+            
+            return;
+        }
+        
         fprintf
         (
             stdout,
@@ -448,6 +571,121 @@ NS_ASSUME_NONNULL_END
     }
 }
 
+- ( nullable NSMutableString * )messageBufferForCurrentThread
+{
+    return [ NSThread currentThread ].threadDictionary[ SKShellMessageBufferKey ];
+}
+
+- ( void )setMessageBufferForCurrentThread: ( nullable NSMutableString * )buffer
+{
+    if( buffer )
+    {
+        [ NSThread currentThread ].threadDictionary[ SKShellMessageBufferKey ] = buffer;
+    }
+    else
+    {
+        [ [ NSThread currentThread ].threadDictionary removeObjectForKey: SKShellMessageBufferKey ];
+    }
+}
+
+- ( void )performWithMessageBuffer: ( nullable NSMutableString * )buffer block: ( void ( ^ )( void ) )block
+{
+    NSMutableString * previous;
+    
+    previous = [ self messageBufferForCurrentThread ];
+    
+    [ self setMessageBufferForCurrentThread: buffer ];
+    
+    block();
+    
+    [ self setMessageBufferForCurrentThread: previous ];
+}
+
+- ( NSArray< NSString * > * )promptHierarchyForCurrentThread
+{
+    NSArray< NSString * > * hierarchy;
+    
+    hierarchy = [ self threadPromptHierarchy ];
+    
+    if( hierarchy != nil )
+    {
+        return ( NSArray< NSString * > * )( hierarchy.copy );
+    }
+    
+    @synchronized( self )
+    {
+        /* A custom prompt has no parts */
+        if( self.renderedPrompts == nil )
+        {
+            return @[ ( self.prompt ) ? ( NSString * )( self.prompt ) : @"" ];
+        }
+        
+        return ( NSArray< NSString * > * )( self.renderedPrompts.copy );
+    }
+}
+
+- ( void )setPromptHierarchyForCurrentThread: ( nullable NSArray< NSString * > * )hierarchy
+{
+    if( hierarchy.count )
+    {
+        [ NSThread currentThread ].threadDictionary[ SKShellPromptHierarchyKey ] = [ hierarchy mutableCopy ];
+    }
+    else
+    {
+        [ [ NSThread currentThread ].threadDictionary removeObjectForKey: SKShellPromptHierarchyKey ];
+    }
+}
+
+- ( NSArray< NSString * > * )promptHierarchyForCurrentThreadByAddingPart: ( NSString * )part
+{
+    __block NSArray< NSString * > * hierarchy;
+    
+    hierarchy = [ self promptHierarchyForCurrentThread ];
+    
+    /* The part is added to a copy set for the thread, which is restored afterwards */
+    [ self performWithMessageBuffer: [ self messageBufferForCurrentThread ] promptHierarchy: hierarchy block: ^( void )
+        {
+            [ self addPromptPart: part ];
+            
+            hierarchy = [ self promptHierarchyForCurrentThread ];
+        }
+    ];
+    
+    return hierarchy;
+}
+
+- ( void )performWithMessageBuffer: ( nullable NSMutableString * )buffer promptHierarchy: ( nullable NSArray< NSString * > * )hierarchy block: ( void ( ^ )( void ) )block
+{
+    NSArray< NSString * > * previous;
+    
+    previous = [ self threadPromptHierarchy ];
+    
+    [ self setPromptHierarchyForCurrentThread: hierarchy ];
+    [ self performWithMessageBuffer: buffer block: block ];
+    [ self setPromptHierarchyForCurrentThread: previous ];
+}
+
+- ( nullable NSMutableArray< NSString * > * )threadPromptHierarchy
+{
+    return [ NSThread currentThread ].threadDictionary[ SKShellPromptHierarchyKey ];
+}
+
+- ( NSString * )prompt: ( NSString * )prompt byAddingPart: ( NSString * )part depth: ( NSUInteger )depth
+{
+    return [ NSString stringWithFormat: @"%@[ %@ ]> ", prompt, [ part stringWithShellColor: SKShellPromptColors[ depth % ( sizeof( SKShellPromptColors ) / sizeof( SKColor ) ) ] ] ];
+}
+
+- ( void )printBufferedMessages: ( NSMutableString * )buffer
+{
+    @synchronized( self )
+    {
+        @synchronized( buffer )
+        {
+            fprintf( stdout, "%s", buffer.UTF8String );
+        }
+    }
+}
+
 - ( NSArray< NSString * > * )promptParts
 {
     @synchronized( self )
@@ -458,66 +696,111 @@ NS_ASSUME_NONNULL_END
 
 - ( void )setPromptParts: ( NSArray< NSString * > * )parts
 {
-    NSUInteger        i;
-    NSString        * part;
-    NSMutableString * prompt;
-    SKColor           colors[] = { SKColorCyan, SKColorBlue, SKColorPurple };
+    NSString       * part;
+    NSString       * prompt;
+    NSMutableArray * rendered;
     
     @synchronized( self )
     {
-        self.promptStrings = parts.copy;
-        
-        if( parts.count == 0 )
-        {
-            self.prompt = @"";
-        }
-        
-        prompt = [ NSMutableString new ];
-        i      = 0;
+        prompt   = @"";
+        rendered = [ NSMutableArray arrayWithObject: prompt ];
         
+        /* The prompt for each depth is kept, so removing a part doesn't render anything */
         for( part in parts )
         {
-            part = [ part stringWithShellColor: colors[ i % ( sizeof( colors ) / sizeof( SKColor ) ) ] ];
-            
-            [ prompt appendFormat: @"[ %@ ]> ", part ];
+            prompt = [ self prompt: prompt byAddingPart: part depth: rendered.count - 1 ];
             
-            i++;
+            [ rendered addObject: prompt ];
         }
         
-        [ self observerPrompt: NO ];
-        
-        self.prompt = prompt;
-        
-        [ self observerPrompt: YES ];
+        /* Not using setPrompt:, as it clears the prompt parts */
+        _prompt              = prompt;
+        self.promptStrings   = ( parts ) ? ( NSArray< NSString * > * )( parts.copy ) : @[];
+        self.renderedPrompts = rendered;
     }
 }
 
 - ( void )addPromptPart:( NSString * )part
 {
+    NSString                     * prompt;
+    NSMutableArray< NSString * > * hierarchy;
+    
     if( self.allowPromptHierarchy == NO )
     {
         return;
     }
     
-    self.promptParts = [ self.promptParts arrayByAddingObject: part ];
+    hierarchy = [ self threadPromptHierarchy ];
+    
+    /* Threads running in parallel have their own hierarchy, as they would otherwise push and pop each other's parts */
+    if( hierarchy != nil )
+    {
+        [ hierarchy addObject: [ self prompt: ( NSString * )( hierarchy.lastObject ) byAddingPart: part depth: hierarchy.count - 1 ] ];
+        
+        return;
+    }
+    
+    @synchronized( self )
+    {
+        /* A custom prompt may have been set */
+        if( self.renderedPrompts == nil )
+        {
+            self.promptParts = self.promptStrings;
+        }
+        
+        prompt = [ self prompt: ( NSString * )( self.renderedPrompts.lastObject ) byAddingPart: part depth: self.promptStrings.count ];
+        
+        [ self.renderedPrompts addObject: prompt ];
+        
+        _prompt            = prompt;
+        self.promptStrings = [ self.promptStrings arrayByAddingObject: part ];
+    }
 }
 
 - ( void )removeLastPromptPart
 {
-    NSMutableArray * parts;
+    NSMutableArray               * parts;
+    NSMutableArray< NSString * > * hierarchy;
     
     if( self.allowPromptHierarchy == NO )
     {
         return;
     }
     
-    parts = self.promptParts.mutableCopy;
+    hierarchy = [ self threadPromptHierarchy ];
     
-    if( parts.count )
+    if( hierarchy != nil )
     {
-        [ parts removeLastObject ];
+        if( hierarchy.count > 1 )
+        {
+            [ hierarchy removeLastObject ];
+        }
+        
+        return;
+    }
+    
+    @synchronized( self )
+    {
+        if( self.promptStrings.count == 0 )
+        {
+            return;
+        }
+        
+        if( self.renderedPrompts == nil )
+        {
+            parts = self.promptStrings.mutableCopy;
+            
+            [ parts removeLastObject ];
+            
+            self.promptParts = parts;
+            
+            return;
+        }
+        
+        [ self.renderedPrompts removeLastObject ];
         
-        self.promptParts = parts;
+        _prompt            = self.renderedPrompts.lastObject;
+        self.promptStrings = [ self.promptStrings subarrayWithRange: NSMakeRange( 0, self.promptStrings.count - 1 ) ];
     }
 }
 
@@ -0,0 +1,156 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTask+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private SKTask interface, shared with other ShellKit classes
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKTask.h>
+#import "SKProcess.h"
+#import "SKShell+Private.h"
+#import "SKTaskStatus+Private.h"
+#import "SKEventStream+Private.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKTask()
+
+@property( atomic, readwrite, assign           ) BOOL                  running;
+@property( atomic, readwrite, assign           ) BOOL                  cancelled;
+@property( atomic, readwrite, assign           ) BOOL                  runsInOwnProcessGroup;
+@property( atomic, readwrite, strong, nullable ) NSError             * error;
+@property( atomic, readwrite, strong           ) NSString            * script;
+@property( atomic, readwrite, strong, nullable ) NSArray< SKTask * > * recover;
+@property( atomic, readwrite, strong, nullable ) SKProcess           * serviceTask;
+@property( atomic, readwrite, strong, nullable ) NSMutableString     * outputBuffer;
+@property( atomic, readwrite, strong           ) SKTaskStatusRecord  * statusRecord;
+@property( atomic, readwrite, assign           ) uint64_t              eventIdentifier;
+@property( atomic, readwrite, assign           ) int                   exitStatus;
+
+/*!
+ * @method      variableExpression
+ * @abstract    Gets the regular expression matching `%{name}%` variables
+ * @discussion  The first capture group contains the name of the variable.
+ */
++ ( NSRegularExpression * )variableExpression;
+
+/*!
+ * @method      resolvedEnvironment
+ * @abstract    Gets the environment the task's script is run with
+ * @result      The task's environment, or the shell's environment if the
+ *              task doesn't have one, or nil to inherit the process'
+ *              environment
+ */
+- ( nullable SKEnvironment * )resolvedEnvironment;
+
+/*!
+ * @method      canBeBatched
+ * @abstract    Whether the task may be merged with other tasks into a single
+ *              shell invocation
+ */
+- ( BOOL )canBeBatched;
+
+/*!
+ * @method      run:attributes:
+ * @abstract    Runs the task with other process attributes
+ * @discussion  The attributes are only used by this run, and replace the
+ *              task's `processAttributes`, which are left untouched.
+ * @param       variables   Optional variables for the task's script
+ * @param       attributes  The process attributes for this run
+ * @result      YES if the task succeeded, otherwise NO
+ * @see         run:
+ */
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables attributes: ( nullable SKProcessAttributes * )attributes;
+
+/*!
+ * @method      beginRunningScript:
+ * @abstract    Marks the task as running and prints the running message
+ * @param       script  The rendered script
+ */
+- ( void )beginRunningScript: ( NSString * )script;
+
+/*!
+ * @method      cancelWithSignal:
+ * @abstract    Cancels the task, sending a signal to its running processes
+ * @param       signal  The signal to send
+ * @see         cancel
+ */
+- ( void )cancelWithSignal: ( int )signal;
+
+/*!
+ * @method      notifyWillStart
+ * @abstract    Notifies the delegate that the task is about to start
+ */
+- ( void )notifyWillStart;
+
+/*!
+ * @method      handleOutput:forType:
+ * @abstract    Forwards output to the delegate, or to `stdout`/`stderr`
+ * @discussion  A multibyte character truncated at the end of the data is
+ *              kept until the next data of the same type, or until the task
+ *              ends. Invalid UTF-8 sequences are replaced with U+FFFD.
+ * @param       data    The output data
+ * @param       type    The output type
+ */
+- ( void )handleOutput: ( NSData * )data forType: ( SKTaskOutputType )type;
+
+/*!
+ * @method      endWithStatus:startDate:variables:
+ * @abstract    Finishes a run of the task
+ * @discussion  Notifies the delegate, tries the recovery tasks if the status
+ *              is not zero, prints the result and clears the running flag.
+ * @param       status      The exit status of the task's script
+ * @param       date        The date the script was started
+ * @param       variables   The variables the task was run with
+ * @result      YES if the task succeeded or recovered, otherwise NO
+ */
+- ( BOOL )endWithStatus: ( int )status startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      recordEndOfRun:
+ * @abstract    Records the end of a run in the task's status and event stream
+ * @discussion  Failed runs are recorded as cancelled if the task was
+ *              cancelled. Successful runs of services are not recorded, as
+ *              services keep running until stopped.
+ * @param       success     Whether the run succeeded
+ * @see         recordEndWithState:
+ */
+- ( void )recordEndOfRun: ( BOOL )success;
+
+/*!
+ * @method      recordEndWithState:
+ * @abstract    Records the end of the task with a given state
+ * @discussion  The state is set on the task's status record, and a task end
+ *              event is written to the shell's event stream if the start of
+ *              the task was written.
+ * @param       state   The final state of the task
+ */
+- ( void )recordEndWithState: ( SKTaskState )state;
+
+@end
+
+NS_ASSUME_NONNULL_END
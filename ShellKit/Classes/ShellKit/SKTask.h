@@ -30,6 +30,8 @@
 #import <Foundation/Foundation.h>
 #import <ShellKit/SKObject.h>
 #import <ShellKit/SKRunableObject.h>
+#import <ShellKit/SKEnvironment.h>
+#import <ShellKit/SKProcessAttributes.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
@@ -47,6 +49,17 @@ typedef NS_ENUM( NSInteger, SKTaskOutputType )
     SKTaskOutputTypeStandardError   /*! `stderr` output type */
 };
 
+/*!
+ * @typedef     SKTaskRecoveryPolicy
+ * @abstract    Defines how recovery tasks are run when a task fails
+ */
+typedef NS_ENUM( NSInteger, SKTaskRecoveryPolicy )
+{
+    SKTaskRecoveryPolicySequential, /*! Recovery tasks are run one after the other, until one of them succeeds */
+    SKTaskRecoveryPolicyRace,       /*! Recovery tasks are run concurrently - The first one to succeed wins, and the others are cancelled */
+    SKTaskRecoveryPolicyHedge       /*! Like sequential, but the first recovery task is started speculatively if the task is slower than usual */
+};
+
 /*!
  * @protocol    SKTaskDelegate
  * @abstract    Delegate for `SKTask` objects
@@ -95,6 +108,12 @@ typedef NS_ENUM( NSInteger, SKTaskOutputType )
 /*!
  * @class       SKTask
  * @discussion  Represents a shell task
+ *              
+ *              When run with `runAsynchronously:`, the exit and the output
+ *              of the task's process are handled by dispatch sources, and
+ *              recovery tasks are chained, so no thread is needed while
+ *              the task is running. This includes waiting for services to
+ *              be ready, and hedged or racing recovery tasks.
  * @see         SKRunableObject
  */
 @interface SKTask: SKObject < SKRunableObject >
@@ -106,6 +125,116 @@ typedef NS_ENUM( NSInteger, SKTaskOutputType )
  */
 @property( atomic, readwrite, weak ) id< SKTaskDelegate > delegate;
 
+/*!
+ * @property    environment
+ * @abstract    The environment the task's script is run with
+ * @discussion  If nil, the environment of the current shell is used.
+ *              Using an explicit, minimal environment makes the task's
+ *              result independent of the calling process, and spawning
+ *              faster.
+ * @see         SKEnvironment
+ */
+@property( atomic, readwrite, strong, nullable ) SKEnvironment * environment;
+
+/*!
+ * @property    processAttributes
+ * @abstract    Optional scheduling attributes and resource limits
+ * @discussion  Sets the CPU affinity, nice value, I/O priority and
+ *              resource limits of the task's shell, and of all the
+ *              commands it runs. Tasks with attributes are never batched.
+ * @see         SKProcessAttributes
+ */
+@property( atomic, readwrite, copy, nullable ) SKProcessAttributes * processAttributes;
+
+/*!
+ * @property    inputs
+ * @abstract    Glob patterns of the files consumed by the task
+ * @discussion  Patterns follow the `glob(3)` syntax, and are relative to the
+ *              current directory unless absolute. Inputs are used by task
+ *              groups in watch mode, to only rerun the group from the first
+ *              task whose inputs have changed.
+ * @see         SKTaskGroup
+ */
+@property( atomic, readwrite, strong, nullable ) NSArray< NSString * > * inputs;
+
+/*!
+ * @property    weight
+ * @abstract    The number of concurrency slots the task needs
+ * @discussion  Defaults to 1. Heavy tasks (like compiling or linking large
+ *              targets) may use more, so fewer tasks run alongside them
+ *              in parallel task groups.
+ * @see         SKTaskGroup
+ * @see         SKConcurrencyLimiter
+ */
+@property( atomic, readwrite, assign ) NSUInteger weight;
+
+/*!
+ * @property    recoveryPolicy
+ * @abstract    Defines how recovery tasks are run when the task fails
+ * @discussion  Defaults to `SKTaskRecoveryPolicySequential`.
+ *              With `SKTaskRecoveryPolicyHedge`, the first recovery task is
+ *              started while the task is still running, if the task runs
+ *              longer than 95% of its previous successful runs (with the
+ *              same script, in the current process). Whichever succeeds
+ *              first wins, and the other one is cancelled.
+ *              Tasks that may be cancelled by a policy are run in their own
+ *              process group, so all their commands can be terminated.
+ * @see         SKTaskRecoveryPolicy
+ */
+@property( atomic, readwrite, assign ) SKTaskRecoveryPolicy recoveryPolicy;
+
+/*!
+ * @property    cancelled
+ * @abstract    Set if the current or last run of the task was cancelled
+ * @see         cancel
+ */
+@property( atomic, readonly, getter = isCancelled ) BOOL cancelled;
+
+/*!
+ * @property    readyPattern
+ * @abstract    A regular expression marking the task as a background service
+ * @discussion  When set, the task is considered ready as soon as a line of
+ *              its output (`stdout` or `stderr`) matches the pattern.
+ *              The `run:` method then returns, while the task keeps running
+ *              until `stopService` is called, or until the enclosing task
+ *              group finishes.
+ *              Output is matched line by line, as it is produced.
+ * @see         readyPath
+ * @see         stopService
+ */
+@property( atomic, readwrite, strong, nullable ) NSString * readyPattern;
+
+/*!
+ * @property    readyPath
+ * @abstract    A file or socket path marking the task as a background service
+ * @discussion  When set, the task is considered ready as soon as the path
+ *              exists.
+ *              The `run:` method then returns, while the task keeps running
+ *              until `stopService` is called, or until the enclosing task
+ *              group finishes.
+ * @see         readyPattern
+ * @see         stopService
+ */
+@property( atomic, readwrite, strong, nullable ) NSString * readyPath;
+
+/*!
+ * @property    readyTimeout
+ * @abstract    The maximum time to wait for a service task to be ready
+ * @discussion  Defaults to 60 seconds. If the task isn't ready in time, it
+ *              is terminated and fails. Zero means no timeout.
+ */
+@property( atomic, readwrite, assign ) NSTimeInterval readyTimeout;
+
+/*!
+ * @property    service
+ * @abstract    Set if the task is a background service
+ * @discussion  A task is a service if a ready pattern or a ready path has
+ *              been set.
+ * @see         readyPattern
+ * @see         readyPath
+ */
+@property( atomic, readonly, getter = isService ) BOOL service;
+
 /*!
  * @method      taskWithShellScript:
  * @abstract    Creates a task from a shell script
@@ -172,6 +301,42 @@ typedef NS_ENUM( NSInteger, SKTaskOutputType )
  */
 - ( instancetype )initWithShellScript: ( NSString * )script recoverTasks: ( nullable NSArray< SKTask * > * )recover NS_DESIGNATED_INITIALIZER;
 
+/*!
+ * @method      scriptWithVariables:
+ * @abstract    Gets the task's script, with variables substituted
+ * @discussion  Nothing is printed by this method.
+ * @param       variables   Optional variables
+ * @result      The script that would be executed, or nil if the script is
+ *              empty or contains unsubstituted variables
+ */
+- ( nullable NSString * )scriptWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      cancel
+ * @abstract    Cancels the task, if it is running
+ * @discussion  The task's process is sent `SIGTERM`, as well as the running
+ *              recovery tasks, if any. A cancelled task fails, without
+ *              trying its recovery tasks.
+ *              This method may be called from any thread.
+ */
+- ( void )cancel;
+
+/*!
+ * @method      stopService
+ * @abstract    Stops a service task
+ * @discussion  Services run in their own process group. The whole group is
+ *              sent `SIGTERM`, and `SIGKILL` if the service's shell is still
+ *              running after 5 seconds, so processes started by the
+ *              service's script are stopped as well. Processes left once
+ *              the shell has exited can't be reached safely.
+ *              The run is recorded as succeeded if the service was stopped
+ *              by these signals, or exited with a zero status, otherwise
+ *              as failed.
+ *              Does nothing if the task isn't a running service.
+ * @see         service
+ */
+- ( void )stopService;
+
 @end
 
 NS_ASSUME_NONNULL_END
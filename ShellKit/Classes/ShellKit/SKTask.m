@@ -28,311 +28,2183 @@
  */
 
 #import <ShellKit/ShellKit.h>
+#import "SKTask+Private.h"
+#import "SKFuture+Private.h"
+#import "SKUTF8.h"
+#import <errno.h>
+#import <fcntl.h>
+#import <signal.h>
+#import <unistd.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
-@interface SKTask()
+/*!
+ * Matches output line by line, as it is produced.
+ * Each byte is only scanned once, and only the current partial line is kept.
+ */
+@interface SKTaskOutputMatcher: NSObject
 
-@property( atomic, readwrite, assign           ) BOOL                  running;
-@property( atomic, readwrite, strong, nullable ) NSError             * error;
-@property( atomic, readwrite, strong           ) NSString            * script;
-@property( atomic, readwrite, strong, nullable ) NSArray< SKTask * > * recover;
+@property( atomic, readonly ) BOOL matched;
 
-- ( void )dataAvailableForStandardOutput: ( NSNotification * )notification;
-- ( void )dataAvailableForStandardError:  ( NSNotification * )notification;
+- ( instancetype )initWithRegularExpression: ( NSRegularExpression * )regex NS_DESIGNATED_INITIALIZER;
+- ( BOOL )matchData: ( NSData * )data;
 
 @end
 
-NS_ASSUME_NONNULL_END
+@interface SKTaskOutputMatcher()
 
-@implementation SKTask
+@property( atomic, readwrite, assign ) BOOL                  matched;
+@property( atomic, readwrite, strong ) NSRegularExpression * regex;
+@property( atomic, readwrite, strong ) NSMutableData       * line;
 
-+ ( instancetype )taskWithShellScript: ( NSString * )script
-{
-    return [ [ self alloc ] initWithShellScript: script ];
-}
+- ( BOOL )matchLine: ( const char * )bytes length: ( NSUInteger )length;
 
-+ ( instancetype )taskWithShellScript: ( NSString * )script recoverTask: ( nullable SKTask * )recover;
-{
-    return [ [ self alloc ] initWithShellScript: script recoverTask: recover ];
-}
+@end
 
-+ ( instancetype )taskWithShellScript: ( NSString * )script recoverTasks: ( nullable NSArray< SKTask * > * )recover
+/*!
+ * Outcome of a speculative recovery task, started while the task is still
+ * running.
+ */
+typedef NS_ENUM( NSInteger, SKTaskHedge )
 {
-    return [ [ self alloc ] initWithShellScript: script recoverTasks: recover ];
-}
+    SKTaskHedgeNone,
+    SKTaskHedgeSucceeded,
+    SKTaskHedgeFailed
+};
+
+/*!
+ * Speculative run of a recovery task, for asynchronous runs.
+ * Neither the process nor the recovery task is waited for on a thread.
+ */
+@interface SKTaskHedging: NSObject
+
+- ( instancetype )init NS_UNAVAILABLE;
+- ( instancetype )initWithProcess: ( SKProcess * )process recoverTask: ( SKTask * )task NS_DESIGNATED_INITIALIZER;
+- ( void )startAfterDelay: ( NSTimeInterval )delay variables: ( nullable NSDictionary< NSString *, NSString * > * )variables group: ( dispatch_group_t )group;
+- ( void )processDidExit;
+- ( SKTaskHedge )outcome;
+
+@end
+
+@interface SKTaskHedging()
+
+@property( atomic, readwrite, strong           ) SKProcess         * process;
+@property( atomic, readwrite, strong           ) SKTask            * task;
+@property( atomic, readwrite, strong, nullable ) dispatch_source_t   timer;
+@property( atomic, readwrite, assign           ) BOOL                started;
+@property( atomic, readwrite, assign           ) BOOL                exited;
+@property( atomic, readwrite, assign           ) BOOL                exitedFirst;
+@property( atomic, readwrite, assign           ) BOOL                finished;
+@property( atomic, readwrite, assign           ) BOOL                recovered;
+
+- ( void )startWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables group: ( dispatch_group_t )group buffer: ( nullable NSMutableString * )buffer promptHierarchy: ( NSArray< NSString * > * )hierarchy;
+
+@end
+
+@interface SKTask()
+
+@property( atomic, readwrite, strong, nullable ) SKProcess           * process;
+@property( atomic, readwrite, strong, nullable ) NSString            * runningScript;
+@property( atomic, readwrite, strong, nullable ) NSData              * pendingOutput;
+@property( atomic, readwrite, strong, nullable ) NSData              * pendingError;
+@property( atomic, readwrite, assign           ) BOOL                  keepsCancellation;
+@property( atomic, readwrite, strong, nullable ) SKProcessAttributes * runAttributes;
+
++ ( NSMutableDictionary< NSString *, NSMutableArray< NSNumber * > * > * )durations;
++ ( void )recordDuration: ( NSTimeInterval )duration forScript: ( NSString * )script;
++ ( NSTimeInterval )slowDurationForScript: ( NSString * )script;
+
+- ( BOOL )runWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( nullable SKProcessAttributes * )attributesForRun;
+- ( nullable NSString * )beginRunWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( SKProcess * )processWithScript: ( NSString * )script;
+- ( void )startWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( BOOL success ) )completion;
+- ( void )startService: ( NSString * )script variables: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( BOOL success ) )completion;
+- ( void )endWithStatus: ( int )status startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables hedge: ( SKTaskHedge )hedge completion: ( void ( ^ )( BOOL success ) )completion;
+- ( void )recoverFromIndex: ( NSUInteger )index startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( BOOL success ) )completion;
+- ( void )raceRecoveryTasks: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( SKTask * _Nullable winner ) )completion;
+- ( void )watchOutput: ( NSFileHandle * )handle type: ( SKTaskOutputType )type matcher: ( nullable SKTaskOutputMatcher * )matcher handler: ( nullable void ( ^ )( void ) )handler queue: ( dispatch_queue_t )queue group: ( nullable dispatch_group_t )group;
+- ( void )notifyEndWithStatus: ( int )status;
+- ( void )printOutput: ( NSString * )output forType: ( SKTaskOutputType )type;
+- ( void )flushPendingOutput;
+- ( BOOL )finishRecovery: ( BOOL )recovered startDate: ( NSDate * )date;
+- ( BOOL )finishWithStatus: ( int )status startDate: ( NSDate * )date;
+- ( SKTaskHedge )waitUntilExit: ( SKProcess * )process hedgingWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( BOOL )endWithStatus: ( int )status startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables hedge: ( SKTaskHedge )hedge;
+- ( nullable SKTask * )raceRecoveryTasks: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( BOOL )runService: ( NSString * )script variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( nullable NSRegularExpression * )readyExpression;
+- ( BOOL )finishServiceStart: ( SKProcess * )task startDate: ( NSDate * )date;
+- ( void )readOutput: ( NSFileHandle * )handle type: ( SKTaskOutputType )type matcher: ( nullable SKTaskOutputMatcher * )matcher semaphore: ( nullable dispatch_semaphore_t )semaphore group: ( nullable dispatch_group_t )group;
+- ( NSString * )substituteVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( NSArray< NSString * > * )unsubstitutedVariablesInScript: ( NSString * )script;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+/* Lines longer than this are matched as they are, and discarded */
+#define SK_OUTPUT_MATCHER_MAX_LINE  65536
+
+/* Number of durations kept per script, and needed before hedging */
+#define SK_TASK_DURATIONS_MAX       64
+#define SK_TASK_DURATIONS_MIN       5
+
+@implementation SKTaskOutputMatcher
 
 - ( instancetype )init
 {
-    return [ self initWithShellScript: @"" ];
+    return [ self initWithRegularExpression: [ NSRegularExpression regularExpressionWithPattern: @"$^" options: ( NSRegularExpressionOptions )0 error: NULL ] ];
 }
 
-- ( instancetype )initWithShellScript: ( NSString * )script
+- ( instancetype )initWithRegularExpression: ( NSRegularExpression * )regex
 {
-    return [ self initWithShellScript: script recoverTask: nil ];
+    if( ( self = [ super init ] ) )
+    {
+        self.regex = regex;
+        self.line  = [ NSMutableData new ];
+    }
+    
+    return self;
 }
 
-- ( instancetype )initWithShellScript: ( NSString * )script recoverTask: ( nullable SKTask * )recover
+- ( BOOL )matchData: ( NSData * )data
 {
-    return [ self initWithShellScript: script recoverTasks: ( recover ) ? @[ recover ] : nil ];
+    const char * bytes;
+    const char * nl;
+    NSUInteger   length;
+    
+    if( self.matched )
+    {
+        return YES;
+    }
+    
+    bytes  = data.bytes;
+    length = data.length;
+    
+    while( length > 0 && ( nl = memchr( bytes, '\n', length ) ) != NULL )
+    {
+        [ self.line appendBytes: bytes length: ( NSUInteger )( nl - bytes ) ];
+        
+        length -= ( NSUInteger )( nl - bytes ) + 1;
+        bytes   = nl + 1;
+        
+        if( [ self matchLine: self.line.bytes length: self.line.length ] )
+        {
+            return YES;
+        }
+        
+        self.line.length = 0;
+    }
+    
+    [ self.line appendBytes: bytes length: length ];
+    
+    if( self.line.length > SK_OUTPUT_MATCHER_MAX_LINE )
+    {
+        if( [ self matchLine: self.line.bytes length: self.line.length ] )
+        {
+            return YES;
+        }
+        
+        self.line.length = 0;
+    }
+    
+    return NO;
 }
 
-- ( instancetype )initWithShellScript: ( NSString * )script recoverTasks: ( nullable NSArray< SKTask * > * )recover
+- ( BOOL )matchLine: ( const char * )bytes length: ( NSUInteger )length
 {
-    if( ( self = [ super init ] ) )
+    NSString * line;
+    
+    line = [ [ NSString alloc ] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding ];
+    
+    if( line.length && [ self.regex firstMatchInString: line options: ( NSMatchingOptions )0 range: NSMakeRange( 0, line.length ) ] != nil )
     {
-        self.script  = script;
-        self.recover = recover;
+        self.matched = YES;
+        self.line    = [ NSMutableData new ];
     }
     
-    return self;
+    return self.matched;
 }
 
-- ( void )dealloc
-{
-    [ [ NSNotificationCenter defaultCenter ] removeObserver: self ];
-}
+@end
 
-#pragma mark - SKRunableObject
+@implementation SKTaskHedging
 
-- ( BOOL )run
+- ( instancetype )initWithProcess: ( SKProcess * )process recoverTask: ( SKTask * )task
 {
-    return [ self run: nil ];
+    if( ( self = [ super init ] ) )
+    {
+        self.process = process;
+        self.task    = task;
+    }
+    
+    return self;
 }
 
-- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+- ( void )startAfterDelay: ( NSTimeInterval )delay variables: ( nullable NSDictionary< NSString *, NSString * > * )variables group: ( dispatch_group_t )group
 {
-    NSTask               * task;
-    NSString             * key;
-    NSString             * var;
-    NSString             * script;
-    NSRegularExpression  * regex;
-    NSArray              * matches;
-    NSTextCheckingResult * match;
-    NSDate               * date;
-    NSString             * time;
-    id< SKTaskDelegate >   delegate;
-    NSPipe               * standardOutput;
-    NSPipe               * standardError;
+    dispatch_source_t       timer;
+    NSMutableString       * buffer;
+    NSArray< NSString * > * hierarchy;
+    
+    buffer    = [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
     
     @synchronized( self )
     {
-        if( self.script.length == 0 )
-        {
-            self.error = [ self errorWithDescription: @"No script defined" ];
-            
-            [ [ SKShell currentShell ] printError: self.error ];
-            
-            return NO;
-        }
-        
-        script = self.script.copy;
-        
-        for( key in variables )
+        if( self.exited )
         {
-            var    = [ NSString stringWithFormat: @"%%{%@}%%", key ];
-            script = [ script stringByReplacingOccurrencesOfString: var withString: variables[ key ] ];
+            return;
         }
         
-        self.running = YES;
-        
-        [ [ SKShell currentShell ] printMessage: @"Running task: %@" status: SKStatusExecute color: SKColorNone, [ script stringWithShellColor: SKColorCyan ] ];
+        timer = dispatch_source_create( DISPATCH_SOURCE_TYPE_TIMER, 0, 0, dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ) );
         
-        regex   = [ NSRegularExpression regularExpressionWithPattern: @"%\\{([A-Za-z0-9]+)\\}%" options: NSRegularExpressionCaseInsensitive error: NULL ];
-        matches = [ regex matchesInString: script options: ( NSMatchingOptions )0 range: NSMakeRange( 0, script.length ) ];
+        /* The group is left once the timer fires, or is cancelled by the exit of the process */
+        dispatch_group_enter( group );
+        dispatch_source_set_timer( timer, dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( delay * NSEC_PER_SEC ) ), DISPATCH_TIME_FOREVER, 10 * NSEC_PER_MSEC );
         
-        if( matches.count != 0 )
-        {
-            for( match in matches )
+        dispatch_source_set_event_handler
+        (
+            timer,
+            ^( void )
             {
-                [ [ SKShell currentShell ] printWarningMessage: @"No value provided value for variable: %@", [ script substringWithRange: [ match rangeAtIndex: 1 ] ] ];
+                dispatch_source_cancel( timer );
+                
+                [ self startWithVariables: variables group: group buffer: buffer promptHierarchy: hierarchy ];
             }
-            
-            self.error = [ self errorWithDescription: @"Script contains unsubstituted variables" ];
-            
-            [ [ SKShell currentShell ] printError: self.error ];
-            
-            return NO;
-        }
-        
-        delegate        = self.delegate;
-        task            = [ NSTask new ];
-        task.launchPath = ( [ SKShell currentShell ].shell != nil ) ? [ SKShell currentShell ].shell : @"/bin/sh";
-        task.arguments  =
-        @[
-            @"-l",
-            @"-c",
-            script
-        ];
-        
-        if( [ delegate respondsToSelector: @selector( task:didProduceOutput:forType: ) ] )
-        {
-            standardOutput = [ NSPipe pipe ];
-            standardError  = [ NSPipe pipe ];
-            
-            task.standardOutput = standardOutput;
-            task.standardError  = standardError;
-            
-            [ [ NSNotificationCenter defaultCenter ] addObserver: self selector: @selector( dataAvailableForStandardOutput: ) name: NSFileHandleDataAvailableNotification object: standardOutput.fileHandleForReading ];
-            [ [ NSNotificationCenter defaultCenter ] addObserver: self selector: @selector( dataAvailableForStandardError:  ) name: NSFileHandleDataAvailableNotification object: standardError.fileHandleForReading ];
-            
-            [ standardOutput.fileHandleForReading waitForDataInBackgroundAndNotify ];
-            [ standardError.fileHandleForReading  waitForDataInBackgroundAndNotify ];
-        }
-        else
-        {
-            standardOutput = nil;
-            standardError  = nil;
-        }
-        
-        if( [ delegate respondsToSelector: @selector( taskWillStart: ) ] )
-        {
-            [ delegate taskWillStart: self ];
-        }
-        
-        date = [ NSDate date ];
-        
-        [ task launch ];
-        [ task waitUntilExit ];
+        );
         
-        time = date.elapsedTimeStringSinceNow;
+        dispatch_source_set_cancel_handler
+        (
+            timer,
+            ^( void )
+            {
+                dispatch_group_leave( group );
+            }
+        );
         
-        if( [ delegate respondsToSelector: @selector( task:didEndWithStatus: ) ] )
-        {
-            [ delegate task: self didEndWithStatus: task.terminationStatus ];
-        }
+        self.timer = timer;
         
-        if( standardOutput )
+        dispatch_resume( timer );
+    }
+}
+
+- ( void )startWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables group: ( dispatch_group_t )group buffer: ( nullable NSMutableString * )buffer promptHierarchy: ( NSArray< NSString * > * )hierarchy
+{
+    SKTask           * task;
+    BOOL               grouped;
+    __block SKFuture * future;
+    
+    @synchronized( self )
+    {
+        if( self.exited )
         {
-            [ [ NSNotificationCenter defaultCenter ] removeObserver: self name: NSFileHandleDataAvailableNotification object: standardOutput.fileHandleForReading ];
+            return;
         }
         
-        if( standardError )
+        self.started = YES;
+    }
+    
+    /* The recovery task may be used elsewhere, so it is only run in its own process group while hedging */
+    task                       = self.task;
+    grouped                    = task.runsInOwnProcessGroup;
+    task.runsInOwnProcessGroup = YES;
+    
+    dispatch_group_enter( group );
+    
+    [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
         {
-            [ [ NSNotificationCenter defaultCenter ] removeObserver: self name: NSFileHandleDataAvailableNotification object: standardError.fileHandleForReading ];
+            [ [ SKShell currentShell ] printWarningMessage: @"Task is slower than usual - Starting recovery task speculatively" ];
+            
+            future = [ task runAsynchronously: variables ];
         }
-        
-        if( task.terminationStatus != 0 )
+    ];
+    
+    [ future whenFinished: ^( SKFuture * finished )
         {
-            if( self.recover.count )
-            {
-                {
-                    SKTask * recover;
-                    BOOL     ret;
-                    
-                    for( recover in self.recover )
-                    {
-                        [ [ SKShell currentShell ] printWarningMessage: @"Task failed - Trying to recover" ];
-                        
-                        ret          = [ recover run: variables ];
-                        self.error   = recover.error;
-                        
-                        if( ret )
-                        {
-                            time = date.elapsedTimeStringSinceNow;
-                            
-                            if( time )
-                            {
-                                time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
-                                
-                                [ [ SKShell currentShell ] printSuccessMessage: @"Task recovered successfully %@", time ];    
-                            }
-                            else
-                            {
-                                [ [ SKShell currentShell ] printSuccessMessage: @"Task recovered successfully" ];    
-                            }
-                            
-                            self.running = NO;
-                            
-                            return YES;
-                        }
-                    }
-                    
-                    [ [ SKShell currentShell ] printErrorMessage: @"Task failed to recover" ];
-                    
-                    self.running = NO;
-                    
-                    return NO;
-                }
-            }
+            BOOL terminate;
             
-            self.error = [ self errorWithDescription: @"Task exited with status %li", ( long )( task.terminationStatus ) ];
+            task.runsInOwnProcessGroup = grouped;
             
-            [ [ SKShell currentShell ] printError: self.error ];
+            @synchronized( self )
+            {
+                self.finished  = YES;
+                self.recovered = finished.state == SKFutureStateSucceeded;
+                terminate      = self.recovered && self.exited == NO;
+            }
             
-            self.running = NO;
+            /* The recovery task finished first */
+            if( terminate )
+            {
+                [ self.process terminate ];
+            }
             
-            return NO;
+            dispatch_group_leave( group );
         }
-        
-        if( time )
+    ];
+}
+
+- ( void )processDidExit
+{
+    dispatch_source_t timer;
+    BOOL              cancel;
+    
+    @synchronized( self )
+    {
+        self.exited      = YES;
+        self.exitedFirst = self.finished == NO;
+        timer            = self.timer;
+        cancel           = self.started && self.finished == NO && self.process.terminationStatus == 0;
+    }
+    
+    if( timer != nil )
+    {
+        dispatch_source_cancel( timer );
+    }
+    
+    /* The process finished first, and succeeded */
+    if( cancel )
+    {
+        [ self.task cancel ];
+    }
+}
+
+- ( SKTaskHedge )outcome
+{
+    @synchronized( self )
+    {
+        if( self.started == NO || ( self.exitedFirst && self.process.terminationStatus == 0 ) )
         {
-            time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
-            
-            [ [ SKShell currentShell ] printSuccessMessage: @"Task completed successfully %@", time ];
+            return SKTaskHedgeNone;
         }
-        else
-        {
-            [ [ SKShell currentShell ] printSuccessMessage: @"Task completed successfully" ];
-        }    
-        
-        self.running = NO;
         
-        return YES;
+        return ( self.recovered ) ? SKTaskHedgeSucceeded : SKTaskHedgeFailed;
     }
 }
 
-- ( void )dataAvailableForStandardOutput: ( NSNotification * )notification
+@end
+
+@implementation SKTask
+
++ ( instancetype )taskWithShellScript: ( NSString * )script
+{
+    return [ [ self alloc ] initWithShellScript: script ];
+}
+
++ ( instancetype )taskWithShellScript: ( NSString * )script recoverTask: ( nullable SKTask * )recover;
+{
+    return [ [ self alloc ] initWithShellScript: script recoverTask: recover ];
+}
+
++ ( instancetype )taskWithShellScript: ( NSString * )script recoverTasks: ( nullable NSArray< SKTask * > * )recover
 {
-    NSFileHandle        * handle;
-    NSData              * data;
-    NSString            * output;
-    id < SKTaskDelegate > delegate;
-    
-    handle   = notification.object;
-    data     = handle.availableData;
-    output   = [ [ NSString alloc ] initWithData: data encoding: NSUTF8StringEncoding ];
-    delegate = self.delegate;
+    return [ [ self alloc ] initWithShellScript: script recoverTasks: recover ];
+}
+
++ ( NSRegularExpression * )variableExpression
+{
+    static dispatch_once_t       once;
+    static NSRegularExpression * regex;
     
-    if( data.length )
-    {
-        if( [ delegate respondsToSelector: @selector( task:didProduceOutput:forType: ) ] )
+    dispatch_once
+    (
+        &once,
+        ^( void )
         {
-            [ delegate task: self didProduceOutput: output forType: SKTaskOutputTypeStandardOutput ];
+            regex = [ NSRegularExpression regularExpressionWithPattern: @"%\\{([A-Za-z0-9]+)\\}%" options: NSRegularExpressionCaseInsensitive error: NULL ];
         }
-        else
+    );
+    
+    return regex;
+}
+
++ ( NSMutableDictionary< NSString *, NSMutableArray< NSNumber * > * > * )durations
+{
+    static dispatch_once_t                                                     once;
+    static NSMutableDictionary< NSString *, NSMutableArray< NSNumber * > * > * durations;
+    
+    dispatch_once
+    (
+        &once,
+        ^( void )
         {
-            fprintf( stdout, "%s", output.UTF8String );
+            durations = [ NSMutableDictionary new ];
         }
-        
-        [ handle waitForDataInBackgroundAndNotify ];
-    }
+    );
+    
+    return durations;
 }
 
-- ( void )dataAvailableForStandardError:  ( NSNotification * )notification
++ ( void )recordDuration: ( NSTimeInterval )duration forScript: ( NSString * )script
 {
-    NSFileHandle        * handle;
-    NSData              * data;
-    NSString            * output;
-    id < SKTaskDelegate > delegate;
+    NSMutableDictionary< NSString *, NSMutableArray< NSNumber * > * > * durations;
+    NSMutableArray< NSNumber * >                                      * samples;
     
-    handle   = notification.object;
-    data     = handle.availableData;
-    output   = [ [ NSString alloc ] initWithData: data encoding: NSUTF8StringEncoding ];
-    delegate = self.delegate;
+    durations = [ self durations ];
     
-    if( data.length )
+    @synchronized( durations )
     {
-        if( [ delegate respondsToSelector: @selector( task:didProduceOutput:forType: ) ] )
+        samples = durations[ script ];
+        
+        if( samples == nil )
         {
-            [ delegate task: self didProduceOutput: output forType: SKTaskOutputTypeStandardError ];
+            samples             = [ NSMutableArray new ];
+            durations[ script ] = samples;
         }
-        else
+        
+        if( samples.count == SK_TASK_DURATIONS_MAX )
         {
-            fprintf( stderr, "%s", output.UTF8String );
+            [ samples removeObjectAtIndex: 0 ];
         }
         
-        [ handle waitForDataInBackgroundAndNotify ];
+        [ samples addObject: @( duration ) ];
+    }
+}
+
++ ( NSTimeInterval )slowDurationForScript: ( NSString * )script
+{
+    NSMutableDictionary< NSString *, NSMutableArray< NSNumber * > * > * durations;
+    NSArray< NSNumber * >                                             * samples;
+    
+    durations = [ self durations ];
+    
+    @synchronized( durations )
+    {
+        samples = [ durations[ script ] copy ];
+    }
+    
+    if( samples.count < SK_TASK_DURATIONS_MIN )
+    {
+        return 0;
+    }
+    
+    samples = [ samples sortedArrayUsingSelector: @selector( compare: ) ];
+    
+    return samples[ ( NSUInteger )( ( double )( samples.count - 1 ) * 0.95 + 0.5 ) ].doubleValue;
+}
+
+- ( instancetype )init
+{
+    return [ self initWithShellScript: @"" ];
+}
+
+- ( instancetype )initWithShellScript: ( NSString * )script
+{
+    return [ self initWithShellScript: script recoverTask: nil ];
+}
+
+- ( instancetype )initWithShellScript: ( NSString * )script recoverTask: ( nullable SKTask * )recover
+{
+    return [ self initWithShellScript: script recoverTasks: ( recover ) ? @[ recover ] : nil ];
+}
+
+- ( instancetype )initWithShellScript: ( NSString * )script recoverTasks: ( nullable NSArray< SKTask * > * )recover
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.script       = script;
+        self.recover      = recover;
+        self.readyTimeout = 60;
+        self.weight       = 1;
+        self.statusRecord = [ SKTaskStatusRecord new ];
+    }
+    
+    return self;
+}
+
+- ( void )dealloc
+{
+    [ [ NSNotificationCenter defaultCenter ] removeObserver: self ];
+    
+    if( self.serviceTask.isRunning )
+    {
+        [ self.serviceTask terminate ];
+    }
+}
+
+- ( BOOL )isService
+{
+    return self.readyPattern.length > 0 || self.readyPath.length > 0;
+}
+
+- ( nullable NSString * )scriptWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSString * script;
+    
+    if( self.script.length == 0 )
+    {
+        return nil;
+    }
+    
+    script = [ self substituteVariables: variables ];
+    
+    if( [ self unsubstitutedVariablesInScript: script ].count != 0 )
+    {
+        return nil;
+    }
+    
+    return script;
+}
+
+- ( NSString * )substituteVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSString        * script;
+    NSString        * key;
+    NSString        * name;
+    NSMutableString * rendered;
+    NSRange           range;
+    NSUInteger        location;
+    NSUInteger        end;
+    
+    script = self.script.copy;
+    range  = [ script rangeOfString: @"%{" options: NSLiteralSearch ];
+    
+    if( variables.count == 0 || range.location == NSNotFound )
+    {
+        return script;
+    }
+    
+    /* Single pass - Values are never substituted themselves */
+    rendered = [ NSMutableString stringWithCapacity: script.length ];
+    location = 0;
+    
+    while( range.location != NSNotFound )
+    {
+        /* Any provided name is substituted, the longest one winning if several match */
+        name = nil;
+        
+        for( key in variables )
+        {
+            end = range.location + key.length + 2;
+            
+            if( ( name != nil && key.length <= name.length ) || end + 2 > script.length )
+            {
+                continue;
+            }
+            
+            if( [ script compare: key options: NSLiteralSearch range: NSMakeRange( range.location + 2, key.length ) ] == NSOrderedSame && [ script compare: @"}%" options: NSLiteralSearch range: NSMakeRange( end, 2 ) ] == NSOrderedSame )
+            {
+                name = key;
+            }
+        }
+        
+        if( name == nil )
+        {
+            range = [ script rangeOfString: @"%{" options: NSLiteralSearch range: NSMakeRange( range.location + 1, script.length - range.location - 1 ) ];
+            
+            continue;
+        }
+        
+        [ rendered appendString: [ script substringWithRange: NSMakeRange( location, range.location - location ) ] ];
+        [ rendered appendString: ( NSString * )( variables[ ( NSString * )name ] ) ];
+        
+        location = range.location + name.length + 4;
+        range    = [ script rangeOfString: @"%{" options: NSLiteralSearch range: NSMakeRange( location, script.length - location ) ];
+    }
+    
+    [ rendered appendString: [ script substringFromIndex: location ] ];
+    
+    return rendered;
+}
+
+- ( NSArray< NSString * > * )unsubstitutedVariablesInScript: ( NSString * )script
+{
+    NSArray                      * matches;
+    NSTextCheckingResult         * match;
+    NSMutableArray< NSString * > * names;
+    
+    if( [ script rangeOfString: @"%{" ].location == NSNotFound )
+    {
+        return @[];
+    }
+    
+    matches = [ [ SKTask variableExpression ] matchesInString: script options: ( NSMatchingOptions )0 range: NSMakeRange( 0, script.length ) ];
+    names   = [ NSMutableArray new ];
+    
+    for( match in matches )
+    {
+        [ names addObject: [ script substringWithRange: [ match rangeAtIndex: 1 ] ] ];
+    }
+    
+    return names;
+}
+
+#pragma mark - SKRunableObject
+
+- ( BOOL )run
+{
+    return [ self run: nil ];
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSMutableString * buffer;
+    NSMutableString * previous;
+    SKTask          * recover;
+    BOOL              success;
+    
+    buffer   = self.outputBuffer;
+    previous = [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+    
+    /* Tasks run from a buffered thread (in parallel task groups) are buffered as well */
+    if( buffer == nil && previous != nil )
+    {
+        self.outputBuffer = previous;
+        success           = [ self run: variables ];
+        self.outputBuffer = nil;
+        
+        for( recover in self.recover )
+        {
+            recover.outputBuffer = nil;
+        }
+        
+        return success;
+    }
+    
+    if( buffer == nil )
+    {
+        success = [ self runWithVariables: variables ];
+        
+        [ self recordEndOfRun: success ];
+        
+        return success;
+    }
+    
+    /* Messages and output of buffered tasks are kept apart from the main stream */
+    [ [ SKShell currentShell ] setMessageBufferForCurrentThread: buffer ];
+    
+    for( recover in self.recover )
+    {
+        recover.outputBuffer = buffer;
+    }
+    
+    success = [ self runWithVariables: variables ];
+    
+    [ [ SKShell currentShell ] setMessageBufferForCurrentThread: previous ];
+    [ self recordEndOfRun: success ];
+    
+    return success;
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables attributes: ( nullable SKProcessAttributes * )attributes
+{
+    BOOL success;
+    
+    self.runAttributes = attributes;
+    success            = [ self run: variables ];
+    self.runAttributes = nil;
+    
+    return success;
+}
+
+- ( BOOL )runWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    SKProcess            * task;
+    NSString             * script;
+    NSDate               * date;
+    id< SKTaskDelegate >   delegate;
+    NSPipe               * standardOutput;
+    NSPipe               * standardError;
+    dispatch_group_t       readers;
+    SKTaskHedge            hedge;
+    
+    @synchronized( self )
+    {
+        /* Racing recovery tasks may be cancelled by the winner before being started */
+        if( self.keepsCancellation == NO )
+        {
+            self.cancelled = NO;
+        }
+        
+        script = [ self beginRunWithVariables: variables ];
+        
+        if( script == nil )
+        {
+            return NO;
+        }
+        
+        if( self.isService )
+        {
+            return [ self runService: ( NSString * )script variables: variables ];
+        }
+        
+        delegate = self.delegate;
+        task     = [ self processWithScript: ( NSString * )script ];
+        hedge    = SKTaskHedgeNone;
+        
+        if( [ delegate respondsToSelector: @selector( task:didProduceOutput:forType: ) ] || [ SKShell currentShell ].eventStream != nil || self.outputBuffer != nil )
+        {
+            /* Output is captured to be passed to the delegate, reported as events, or buffered */
+            standardOutput      = [ NSPipe pipe ];
+            standardError       = [ NSPipe pipe ];
+            readers             = dispatch_group_create();
+            task.standardOutput = standardOutput;
+            task.standardError  = standardError;
+        }
+        else
+        {
+            standardOutput = nil;
+            standardError  = nil;
+            readers        = nil;
+        }
+        
+        [ self notifyWillStart ];
+        
+        date = [ NSDate date ];
+        
+        if( self.runsInOwnProcessGroup || ( self.recoveryPolicy == SKTaskRecoveryPolicyHedge && self.recover.count ) )
+        {
+            task.createsProcessGroup = YES;
+        }
+        
+        self.process = task;
+        
+        if( [ task launch ] )
+        {
+            [ self.statusRecord setProcessIdentifier: task.processIdentifier ];
+            
+            if( readers != nil )
+            {
+                [ self readOutput: standardOutput.fileHandleForReading type: SKTaskOutputTypeStandardOutput matcher: nil semaphore: nil group: readers ];
+                [ self readOutput: standardError.fileHandleForReading  type: SKTaskOutputTypeStandardError  matcher: nil semaphore: nil group: readers ];
+            }
+            
+            /* The task may have been cancelled before being launched */
+            if( self.cancelled )
+            {
+                [ task terminate ];
+            }
+            
+            if( self.recoveryPolicy == SKTaskRecoveryPolicyHedge && self.recover.count )
+            {
+                hedge = [ self waitUntilExit: task hedgingWithVariables: variables ];
+            }
+            else
+            {
+                [ task waitUntilExit ];
+            }
+            
+            if( readers != nil )
+            {
+                dispatch_group_wait( readers, DISPATCH_TIME_FOREVER );
+            }
+        }
+        
+        self.process = nil;
+        
+        if( task.error )
+        {
+            self.error = task.error;
+            
+            [ [ SKShell currentShell ] printError: self.error ];
+            
+            self.running = NO;
+            
+            return NO;
+        }
+        
+        return [ self endWithStatus: task.terminationStatus startDate: date variables: variables hedge: hedge ];
+    }
+}
+
+- ( SKFuture * )runAsynchronously: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    SKFuture        * future;
+    NSMutableString * buffer;
+    SKTask          * recover;
+    BOOL              inherited;
+    void ( ^ completion )( BOOL success );
+    
+    @synchronized( self )
+    {
+        if( self.running )
+        {
+            return [ SKFuture futureWithError: [ self errorWithDescription: @"Task is already running" ] ];
+        }
+        
+        buffer    = self.outputBuffer;
+        inherited = buffer == nil && [ [ SKShell currentShell ] messageBufferForCurrentThread ] != nil;
+        future    = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+            {
+                [ self cancel ];
+            }
+        ];
+        
+        /* Tasks started from a buffered thread are buffered as well, as with run: */
+        if( inherited )
+        {
+            buffer            = [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+            self.outputBuffer = buffer;
+        }
+        
+        if( buffer != nil )
+        {
+            for( recover in self.recover )
+            {
+                recover.outputBuffer = buffer;
+            }
+        }
+        
+        completion = ^( BOOL success )
+        {
+            SKTask * task;
+            
+            [ self recordEndOfRun: success ];
+            
+            if( inherited )
+            {
+                self.outputBuffer = nil;
+                
+                for( task in self.recover )
+                {
+                    task.outputBuffer = nil;
+                }
+            }
+            
+            [ future finishWithSuccess: success error: ( success ) ? nil : self.error ];
+        };
+        
+        /* The task is marked as running before the lock is released */
+        [ [ SKShell currentShell ] performWithMessageBuffer: buffer block: ^( void )
+            {
+                [ self startWithVariables: variables completion: completion ];
+            }
+        ];
+        
+        return future;
+    }
+}
+
+- ( void )cancel
+{
+    [ self cancelWithSignal: SIGTERM ];
+}
+
+- ( void )stopService
+{
+    SKProcess          * task;
+    id< SKTaskDelegate > delegate;
+    BOOL                 stopped;
+    BOOL                 success;
+    
+    @synchronized( self )
+    {
+        task             = self.serviceTask;
+        self.serviceTask = nil;
+        
+        if( task == nil )
+        {
+            return;
+        }
+        
+        stopped = task.isRunning;
+        
+        if( stopped )
+        {
+            [ [ SKShell currentShell ] printInfoMessage: @"Stopping service: %@", [ self.script stringWithShellColor: SKColorCyan ] ];
+        }
+        
+        /* Processes started by the service are stopped as well */
+        [ task terminateWithGracePeriod: 5 ];
+        
+        /* Being killed by the signals sent to stop the service isn't a failure, but crashing or failing before is */
+        success = task.terminationSignal == 0 && task.terminationStatus == 0;
+        success = success || ( stopped && ( task.terminationSignal == SIGTERM || task.terminationSignal == SIGKILL ) );
+        
+        delegate = self.delegate;
+        
+        if( [ delegate respondsToSelector: @selector( task:didEndWithStatus: ) ] )
+        {
+            [ delegate task: self didEndWithStatus: task.terminationStatus ];
+        }
+        
+        self.exitStatus = task.terminationStatus;
+        
+        if( success == NO )
+        {
+            [ [ SKShell currentShell ] printWarningMessage: @"Service exited with status %i: %@", task.terminationStatus, [ self.script stringWithShellColor: SKColorCyan ] ];
+        }
+        
+        [ self recordEndWithState: ( success ) ? SKTaskStateSucceeded : SKTaskStateFailed ];
+        
+        self.running = NO;
+    }
+}
+
+- ( SKTaskStatus * )snapshot
+{
+    NSMutableArray< SKTaskStatus * > * children;
+    SKTaskStatus                     * status;
+    SKTask                           * recover;
+    
+    children = [ NSMutableArray new ];
+    
+    for( recover in self.recover )
+    {
+        status = [ recover snapshot ];
+        
+        if( status.state != SKTaskStatePending )
+        {
+            [ children addObject: status ];
+        }
+    }
+    
+    return [ self.statusRecord snapshotWithDefaultName: self.script children: children ];
+}
+
+#pragma mark - Private
+
+- ( nullable SKProcessAttributes * )attributesForRun
+{
+    SKProcessAttributes * attributes;
+    
+    attributes = self.runAttributes;
+    
+    return ( attributes != nil ) ? attributes : self.processAttributes;
+}
+
+- ( nullable NSString * )beginRunWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSString              * script;
+    NSString              * name;
+    NSArray< NSString * > * unsubstituted;
+    
+    if( self.script.length == 0 )
+    {
+        self.error = [ self errorWithDescription: @"No script defined" ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        return nil;
+    }
+    
+    script = [ self substituteVariables: variables ];
+    
+    [ self beginRunningScript: script ];
+    
+    unsubstituted = [ self unsubstitutedVariablesInScript: script ];
+    
+    if( unsubstituted.count != 0 )
+    {
+        for( name in unsubstituted )
+        {
+            [ [ SKShell currentShell ] printWarningMessage: @"No value provided value for variable: %@", name ];
+        }
+        
+        self.error = [ self errorWithDescription: @"Script contains unsubstituted variables" ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        self.running = NO;
+        
+        return nil;
+    }
+    
+    return script;
+}
+
+- ( SKProcess * )processWithScript: ( NSString * )script
+{
+    SKProcess * task;
+    
+    task             = [ SKProcess new ];
+    task.launchPath  = ( [ SKShell currentShell ].shell != nil ) ? ( NSString * )( [ SKShell currentShell ].shell ) : @"/bin/sh";
+    task.environment = self.resolvedEnvironment;
+    task.attributes  = [ self attributesForRun ];
+    task.arguments   =
+    @[
+        @"-l",
+        @"-c",
+        script
+    ];
+    
+    return task;
+}
+
+- ( void )startWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( BOOL success ) )completion
+{
+    SKProcess             * task;
+    NSString              * script;
+    NSDate                * date;
+    NSMutableString       * buffer;
+    NSArray< NSString * > * hierarchy;
+    id< SKTaskDelegate >    delegate;
+    NSPipe                * standardOutput;
+    NSPipe                * standardError;
+    SKTaskHedging         * hedging;
+    NSTimeInterval          slow;
+    dispatch_queue_t        queue;
+    dispatch_group_t        group;
+    
+    @synchronized( self )
+    {
+        /* Racing recovery tasks may be cancelled by the winner before being started */
+        if( self.keepsCancellation == NO )
+        {
+            self.cancelled = NO;
+        }
+        
+        script = [ self beginRunWithVariables: variables ];
+        
+        if( script == nil )
+        {
+            completion( NO );
+            
+            return;
+        }
+        
+        if( self.isService )
+        {
+            [ self startService: ( NSString * )script variables: variables completion: completion ];
+            
+            return;
+        }
+        
+        delegate  = self.delegate;
+        buffer    = self.outputBuffer;
+        hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+        task      = [ self processWithScript: ( NSString * )script ];
+        queue     = dispatch_queue_create( "com.xs-labs.ShellKit.SKTask", DISPATCH_QUEUE_SERIAL );
+        group     = dispatch_group_create();
+        slow      = ( self.recoveryPolicy == SKTaskRecoveryPolicyHedge && self.recover.count ) ? [ SKTask slowDurationForScript: ( NSString * )script ] : 0;
+        hedging   = ( slow > 0 ) ? [ [ SKTaskHedging alloc ] initWithProcess: task recoverTask: ( SKTask * )( self.recover.firstObject ) ] : nil;
+        
+        /* Output is read by dispatch sources, so no thread waits on the pipes */
+        if( [ delegate respondsToSelector: @selector( task:didProduceOutput:forType: ) ] || [ SKShell currentShell ].eventStream != nil || buffer != nil )
+        {
+            standardOutput      = [ NSPipe pipe ];
+            standardError       = [ NSPipe pipe ];
+            task.standardOutput = standardOutput;
+            task.standardError  = standardError;
+        }
+        else
+        {
+            standardOutput = nil;
+            standardError  = nil;
+        }
+        
+        [ self notifyWillStart ];
+        
+        date                     = [ NSDate date ];
+        task.createsProcessGroup = self.runsInOwnProcessGroup || ( self.recoveryPolicy == SKTaskRecoveryPolicyHedge && self.recover.count );
+        self.process             = task;
+        
+        dispatch_group_enter( group );
+        
+        task.terminationHandler = ^( SKProcess * process )
+        {
+            ( void )process;
+            
+            [ hedging processDidExit ];
+            
+            dispatch_group_leave( group );
+        };
+        
+        if( [ task launch ] == NO )
+        {
+            dispatch_group_leave( group );
+            
+            self.process = nil;
+            self.error   = task.error;
+            
+            [ [ SKShell currentShell ] printError: self.error ];
+            
+            self.running = NO;
+            
+            completion( NO );
+            
+            return;
+        }
+        
+        [ self.statusRecord setProcessIdentifier: task.processIdentifier ];
+        
+        if( standardOutput != nil && standardError != nil )
+        {
+            [ self watchOutput: standardOutput.fileHandleForReading type: SKTaskOutputTypeStandardOutput matcher: nil handler: nil queue: queue group: group ];
+            [ self watchOutput: standardError.fileHandleForReading  type: SKTaskOutputTypeStandardError  matcher: nil handler: nil queue: queue group: group ];
+        }
+        
+        /* The first recovery task is started if the process is slower than usual */
+        [ hedging startAfterDelay: slow variables: variables group: group ];
+        
+        /* The task may have been cancelled before being launched */
+        if( self.cancelled )
+        {
+            [ task terminate ];
+        }
+        
+        /* The run ends once the process has exited, all its output has been read, and the hedged recovery task has finished */
+        dispatch_group_notify
+        (
+            group,
+            queue,
+            ^( void )
+            {
+                [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                    {
+                        self.process = nil;
+                        
+                        [ self endWithStatus: task.terminationStatus startDate: date variables: variables hedge: ( hedging != nil ) ? [ hedging outcome ] : SKTaskHedgeNone completion: completion ];
+                    }
+                ];
+            }
+        );
+    }
+}
+
+- ( void )startService: ( NSString * )script variables: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( BOOL success ) )completion
+{
+    SKProcess             * task;
+    NSPipe                * standardOutput;
+    NSPipe                * standardError;
+    NSRegularExpression   * regex;
+    SKTaskOutputMatcher   * outputMatcher;
+    SKTaskOutputMatcher   * errorMatcher;
+    NSDate                * date;
+    NSMutableString       * buffer;
+    NSArray< NSString * > * hierarchy;
+    dispatch_queue_t        queue;
+    dispatch_source_t       timer;
+    __block BOOL            ended;
+    __block BOOL            stopping;
+    void ( ^ check )( void );
+    
+    regex = [ self readyExpression ];
+    
+    /* Invalid patterns have already been reported */
+    if( regex == nil && self.readyPattern.length )
+    {
+        completion( NO );
+        
+        return;
+    }
+    
+    buffer                   = self.outputBuffer;
+    hierarchy                = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    queue                    = dispatch_queue_create( "com.xs-labs.ShellKit.SKTask", DISPATCH_QUEUE_SERIAL );
+    timer                    = dispatch_source_create( DISPATCH_SOURCE_TYPE_TIMER, 0, 0, queue );
+    outputMatcher            = ( regex ) ? [ [ SKTaskOutputMatcher alloc ] initWithRegularExpression: ( NSRegularExpression * )regex ] : nil;
+    errorMatcher             = ( regex ) ? [ [ SKTaskOutputMatcher alloc ] initWithRegularExpression: ( NSRegularExpression * )regex ] : nil;
+    standardOutput           = [ NSPipe pipe ];
+    standardError            = [ NSPipe pipe ];
+    task                     = [ self processWithScript: script ];
+    task.standardOutput      = standardOutput;
+    task.standardError       = standardError;
+    task.createsProcessGroup = YES;
+    ended                    = NO;
+    stopping                 = NO;
+    date                     = [ NSDate date ];
+    
+    /* Readiness is checked on the queue, when output matches, when the process exits, and periodically for the ready path and timeout */
+    check = ^( void )
+    {
+        if( ended )
+        {
+            return;
+        }
+        
+        if( stopping == NO && ( outputMatcher.matched || errorMatcher.matched || ( self.readyPath.length && [ [ NSFileManager defaultManager ] fileExistsAtPath: ( NSString * )( self.readyPath ) ] ) ) )
+        {
+            ended = YES;
+            
+            dispatch_source_cancel( timer );
+            
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    completion( [ self finishServiceStart: task startDate: date ] );
+                }
+            ];
+        }
+        else if( task.isRunning == NO )
+        {
+            ended = YES;
+            
+            dispatch_source_cancel( timer );
+            
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    if( stopping == NO )
+                    {
+                        [ [ SKShell currentShell ] printWarningMessage: @"Service exited before being ready" ];
+                    }
+                    
+                    [ self endWithStatus: ( stopping == NO && task.terminationStatus != 0 ) ? task.terminationStatus : EXIT_FAILURE startDate: date variables: variables hedge: SKTaskHedgeNone completion: completion ];
+                }
+            ];
+        }
+        else if( stopping == NO && self.readyTimeout > 0 && -[ date timeIntervalSinceNow ] > self.readyTimeout )
+        {
+            stopping = YES;
+            
+            [ task terminate ];
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    [ [ SKShell currentShell ] printWarningMessage: @"Service not ready after %.0f seconds", self.readyTimeout ];
+                }
+            ];
+            
+            /* The run ends once the service has exited - Processes still running after the grace period are killed */
+            dispatch_after
+            (
+                dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 5 * NSEC_PER_SEC ) ),
+                queue,
+                ^( void )
+                {
+                    if( task.isRunning )
+                    {
+                        [ task sendSignal: SIGKILL ];
+                    }
+                }
+            );
+        }
+    };
+    
+    task.terminationHandler = ^( SKProcess * process )
+    {
+        ( void )process;
+        
+        dispatch_async( queue, check );
+    };
+    
+    dispatch_source_set_timer( timer, dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 50 * NSEC_PER_MSEC ) ), 50 * NSEC_PER_MSEC, 10 * NSEC_PER_MSEC );
+    dispatch_source_set_event_handler( timer, check );
+    
+    [ self notifyWillStart ];
+    
+    if( [ task launch ] == NO )
+    {
+        /* Sources must be resumed before being released */
+        dispatch_source_cancel( timer );
+        dispatch_resume( timer );
+        
+        self.error = task.error;
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        self.running = NO;
+        
+        completion( NO );
+        
+        return;
+    }
+    
+    [ self.statusRecord setProcessIdentifier: task.processIdentifier ];
+    [ self watchOutput: standardOutput.fileHandleForReading type: SKTaskOutputTypeStandardOutput matcher: outputMatcher handler: check queue: queue group: nil ];
+    [ self watchOutput: standardError.fileHandleForReading  type: SKTaskOutputTypeStandardError  matcher: errorMatcher  handler: check queue: queue group: nil ];
+    
+    dispatch_resume( timer );
+}
+
+- ( void )endWithStatus: ( int )status startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables hedge: ( SKTaskHedge )hedge completion: ( void ( ^ )( BOOL success ) )completion
+{
+    [ self notifyEndWithStatus: status ];
+    
+    if( hedge == SKTaskHedgeSucceeded )
+    {
+        completion( [ self finishRecovery: YES startDate: date ] );
+        
+        return;
+    }
+    
+    if( status == 0 || self.cancelled || self.recover.count == 0 )
+    {
+        completion( [ self finishWithStatus: status startDate: date ] );
+        
+        return;
+    }
+    
+    if( self.recoveryPolicy == SKTaskRecoveryPolicyRace )
+    {
+        [ self raceRecoveryTasks: variables completion: ^( SKTask * _Nullable winner )
+            {
+                self.error = ( winner ) ? winner.error : self.recover.lastObject.error;
+                
+                /* A task cancelled while recovering fails as cancelled */
+                if( winner != nil || self.cancelled == NO )
+                {
+                    completion( [ self finishRecovery: winner != nil startDate: date ] );
+                }
+                else
+                {
+                    completion( [ self finishWithStatus: status startDate: date ] );
+                }
+            }
+        ];
+        
+        return;
+    }
+    
+    /* The first recovery task has already been tried if hedged */
+    if( hedge == SKTaskHedgeFailed )
+    {
+        self.error = self.recover.firstObject.error;
+    }
+    
+    [ self recoverFromIndex: ( hedge == SKTaskHedgeFailed ) ? 1 : 0 startDate: date variables: variables completion: completion ];
+}
+
+- ( void )recoverFromIndex: ( NSUInteger )index startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( BOOL success ) )completion
+{
+    NSMutableString       * buffer;
+    NSArray< NSString * > * hierarchy;
+    SKTask                * recover;
+    
+    if( self.cancelled )
+    {
+        completion( [ self finishWithStatus: self.exitStatus startDate: date ] );
+        
+        return;
+    }
+    
+    if( index >= self.recover.count )
+    {
+        completion( [ self finishRecovery: NO startDate: date ] );
+        
+        return;
+    }
+    
+    buffer    = self.outputBuffer;
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    recover   = self.recover[ index ];
+    
+    [ [ SKShell currentShell ] printWarningMessage: @"Task failed - Trying to recover" ];
+    
+    /* Recovery tasks are chained, without waiting on a thread */
+    [ [ recover runAsynchronously: variables ] whenFinished: ^( SKFuture * future )
+        {
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    self.error = recover.error;
+                    
+                    if( future.state == SKFutureStateSucceeded )
+                    {
+                        completion( [ self finishRecovery: YES startDate: date ] );
+                    }
+                    else
+                    {
+                        [ self recoverFromIndex: index + 1 startDate: date variables: variables completion: completion ];
+                    }
+                }
+            ];
+        }
+    ];
+}
+
+- ( void )watchOutput: ( NSFileHandle * )handle type: ( SKTaskOutputType )type matcher: ( nullable SKTaskOutputMatcher * )matcher handler: ( nullable void ( ^ )( void ) )handler queue: ( dispatch_queue_t )queue group: ( nullable dispatch_group_t )group
+{
+    dispatch_source_t source;
+    int               fd;
+    
+    fd     = handle.fileDescriptor;
+    source = dispatch_source_create( DISPATCH_SOURCE_TYPE_READ, ( uintptr_t )fd, 0, queue );
+    
+    fcntl( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+    
+    if( group != nil )
+    {
+        dispatch_group_enter( ( dispatch_group_t )group );
+    }
+    
+    dispatch_source_set_event_handler
+    (
+        source,
+        ^( void )
+        {
+            char     buffer[ 16384 ];
+            ssize_t  length;
+            NSData * data;
+            
+            while( 1 )
+            {
+                length = read( fd, buffer, sizeof( buffer ) );
+                
+                if( length > 0 )
+                {
+                    data = [ NSData dataWithBytes: buffer length: ( NSUInteger )length ];
+                    
+                    [ self handleOutput: data forType: type ];
+                    
+                    /* The handler is called on the queue, once the output has matched */
+                    if( handler != nil && matcher != nil && matcher.matched == NO && [ matcher matchData: data ] )
+                    {
+                        handler();
+                    }
+                    
+                    continue;
+                }
+                
+                if( length == -1 && errno == EINTR )
+                {
+                    continue;
+                }
+                
+                /* End of file, or an error other than having read everything available */
+                if( length == 0 || errno != EAGAIN )
+                {
+                    dispatch_source_cancel( source );
+                }
+                
+                break;
+            }
+        }
+    );
+    
+    dispatch_source_set_cancel_handler
+    (
+        source,
+        ^( void )
+        {
+            [ handle closeFile ];
+            
+            if( group != nil )
+            {
+                dispatch_group_leave( ( dispatch_group_t )group );
+            }
+        }
+    );
+    
+    dispatch_resume( source );
+}
+
+- ( SKTaskHedge )waitUntilExit: ( SKProcess * )process hedgingWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSTimeInterval         slow;
+    SKTask               * hedge;
+    dispatch_semaphore_t   exited;
+    dispatch_semaphore_t   hedged;
+    dispatch_semaphore_t   finished;
+    BOOL                   grouped;
+    __block BOOL           recovered;
+    
+    slow = ( self.runningScript ) ? [ SKTask slowDurationForScript: ( NSString * )( self.runningScript ) ] : 0;
+    
+    if( slow <= 0 )
+    {
+        [ process waitUntilExit ];
+        
+        return SKTaskHedgeNone;
+    }
+    
+    /* Each side signals its own semaphore, and both signal the finished one */
+    exited    = dispatch_semaphore_create( 0 );
+    hedged    = dispatch_semaphore_create( 0 );
+    finished  = dispatch_semaphore_create( 0 );
+    recovered = NO;
+    
+    dispatch_async
+    (
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            [ process waitUntilExit ];
+            
+            dispatch_semaphore_signal( exited );
+            dispatch_semaphore_signal( finished );
+        }
+    );
+    
+    if( dispatch_semaphore_wait( exited, dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( slow * NSEC_PER_SEC ) ) ) == 0 )
+    {
+        return SKTaskHedgeNone;
+    }
+    
+    /* The recovery task may be used elsewhere, so it is only run in its own process group while hedging */
+    hedge                       = ( SKTask * )( self.recover.firstObject );
+    grouped                     = hedge.runsInOwnProcessGroup;
+    hedge.runsInOwnProcessGroup = YES;
+    
+    [ [ SKShell currentShell ] printWarningMessage: @"Task is slower than usual - Starting recovery task speculatively" ];
+    
+    dispatch_async
+    (
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            recovered = [ hedge run: variables ];
+            
+            dispatch_semaphore_signal( hedged );
+            dispatch_semaphore_signal( finished );
+        }
+    );
+    
+    dispatch_semaphore_wait( finished, DISPATCH_TIME_FOREVER );
+    
+    /* The recovery task finished first */
+    if( dispatch_semaphore_wait( exited, DISPATCH_TIME_NOW ) != 0 )
+    {
+        dispatch_semaphore_wait( hedged, DISPATCH_TIME_FOREVER );
+        
+        if( recovered )
+        {
+            [ process terminate ];
+        }
+        
+        dispatch_semaphore_wait( exited, DISPATCH_TIME_FOREVER );
+        
+        hedge.runsInOwnProcessGroup = grouped;
+        
+        return ( recovered ) ? SKTaskHedgeSucceeded : SKTaskHedgeFailed;
+    }
+    
+    if( process.terminationStatus == 0 )
+    {
+        [ hedge cancel ];
+    }
+    
+    dispatch_semaphore_wait( hedged, DISPATCH_TIME_FOREVER );
+    
+    hedge.runsInOwnProcessGroup = grouped;
+    
+    if( process.terminationStatus == 0 )
+    {
+        return SKTaskHedgeNone;
+    }
+    
+    return ( recovered ) ? SKTaskHedgeSucceeded : SKTaskHedgeFailed;
+}
+
+- ( nullable SKTask * )raceRecoveryTasks: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    dispatch_semaphore_t   semaphore;
+    __block SKTask       * winner;
+    
+    semaphore = dispatch_semaphore_create( 0 );
+    winner    = nil;
+    
+    [ self raceRecoveryTasks: variables completion: ^( SKTask * _Nullable task )
+        {
+            winner = task;
+            
+            dispatch_semaphore_signal( semaphore );
+        }
+    ];
+    
+    dispatch_semaphore_wait( semaphore, DISPATCH_TIME_FOREVER );
+    
+    return winner;
+}
+
+- ( void )raceRecoveryTasks: ( nullable NSDictionary< NSString *, NSString * > * )variables completion: ( void ( ^ )( SKTask * _Nullable winner ) )completion
+{
+    SKTask                * recover;
+    NSObject              * lock;
+    NSMutableArray        * grouped;
+    NSMutableArray        * finished;
+    NSMutableString       * buffer;
+    NSMutableString       * racer;
+    NSMutableString       * previous;
+    NSArray< NSString * > * hierarchy;
+    SKFuture              * future;
+    dispatch_group_t        group;
+    BOOL                    stop;
+    __block SKTask        * winner;
+    
+    lock      = [ NSObject new ];
+    grouped   = [ NSMutableArray new ];
+    finished  = [ NSMutableArray new ];
+    buffer    = [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    group     = dispatch_group_create();
+    winner    = nil;
+    
+    [ [ SKShell currentShell ] printWarningMessage: @"Task failed - Racing %lu recovery tasks", ( unsigned long )( self.recover.count ) ];
+    
+    /* Recovery tasks may be used elsewhere, so their settings are restored after the race */
+    for( recover in self.recover )
+    {
+        [ grouped addObject: @( recover.runsInOwnProcessGroup ) ];
+        
+        recover.runsInOwnProcessGroup = YES;
+        recover.keepsCancellation     = YES;
+        recover.cancelled             = NO;
+    }
+    
+    for( recover in self.recover )
+    {
+        @synchronized( lock )
+        {
+            stop = winner != nil;
+        }
+        
+        if( stop )
+        {
+            break;
+        }
+        
+        /* Messages of racing tasks are buffered, so they don't interleave */
+        racer                = [ NSMutableString new ];
+        previous             = recover.outputBuffer;
+        recover.outputBuffer = racer;
+        future               = [ recover runAsynchronously: variables ];
+        
+        dispatch_group_enter( group );
+        
+        [ future whenFinished: ^( SKFuture * result )
+            {
+                SKTask * loser;
+                
+                recover.outputBuffer = previous;
+                
+                if( previous != nil )
+                {
+                    @synchronized( previous )
+                    {
+                        [ previous appendString: racer ];
+                    }
+                }
+                else
+                {
+                    [ [ SKShell currentShell ] printBufferedMessages: racer ];
+                }
+                
+                /* The losers are cancelled as soon as the winner is known - A loser that hasn't launched its process yet keeps the cancellation */
+                @synchronized( lock )
+                {
+                    [ finished addObject: recover ];
+                    
+                    if( result.state == SKFutureStateSucceeded && winner == nil )
+                    {
+                        winner = recover;
+                        
+                        for( loser in self.recover )
+                        {
+                            if( [ finished indexOfObjectIdenticalTo: loser ] == NSNotFound )
+                            {
+                                [ loser cancel ];
+                            }
+                        }
+                    }
+                }
+                
+                dispatch_group_leave( group );
+            }
+        ];
+    }
+    
+    dispatch_group_notify
+    (
+        group,
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            NSUInteger i;
+            
+            for( i = 0; i < self.recover.count; i++ )
+            {
+                self.recover[ i ].runsInOwnProcessGroup = [ grouped[ i ] boolValue ];
+                self.recover[ i ].keepsCancellation     = NO;
+            }
+            
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    completion( winner );
+                }
+            ];
+        }
+    );
+}
+
+- ( BOOL )runService: ( NSString * )script variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    SKProcess           * task;
+    NSPipe              * standardOutput;
+    NSPipe              * standardError;
+    NSRegularExpression * regex;
+    NSDate              * date;
+    dispatch_semaphore_t  semaphore;
+    BOOL                  ready;
+    
+    regex = [ self readyExpression ];
+    
+    /* Invalid patterns have already been reported */
+    if( regex == nil && self.readyPattern.length )
+    {
+        return NO;
+    }
+    
+    semaphore           = dispatch_semaphore_create( 0 );
+    standardOutput      = [ NSPipe pipe ];
+    standardError       = [ NSPipe pipe ];
+    task                = [ self processWithScript: script ];
+    task.standardOutput = standardOutput;
+    task.standardError  = standardError;
+    
+    /* Services are stopped with all the processes they started */
+    task.createsProcessGroup = YES;
+    
+    [ self notifyWillStart ];
+    
+    date = [ NSDate date ];
+    
+    if( [ task launch ] == NO )
+    {
+        self.error = task.error;
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        self.running = NO;
+        
+        return NO;
+    }
+    
+    [ self.statusRecord setProcessIdentifier: task.processIdentifier ];
+    [ self readOutput: standardOutput.fileHandleForReading type: SKTaskOutputTypeStandardOutput matcher: ( regex ) ? [ [ SKTaskOutputMatcher alloc ] initWithRegularExpression: regex ] : nil semaphore: semaphore group: nil ];
+    [ self readOutput: standardError.fileHandleForReading  type: SKTaskOutputTypeStandardError  matcher: ( regex ) ? [ [ SKTaskOutputMatcher alloc ] initWithRegularExpression: regex ] : nil semaphore: semaphore group: nil ];
+    
+    ready = NO;
+    
+    while( ready == NO )
+    {
+        if( dispatch_semaphore_wait( semaphore, dispatch_time( DISPATCH_TIME_NOW, ( int64_t )( 50 * NSEC_PER_MSEC ) ) ) == 0 )
+        {
+            ready = YES;
+        }
+        else if( self.readyPath.length && [ [ NSFileManager defaultManager ] fileExistsAtPath: ( NSString * )( self.readyPath ) ] )
+        {
+            ready = YES;
+        }
+        else if( task.isRunning == NO )
+        {
+            /* Processes started by the shell may still be running */
+            [ task terminateWithGracePeriod: 5 ];
+            [ [ SKShell currentShell ] printWarningMessage: @"Service exited before being ready" ];
+            
+            return [ self endWithStatus: ( task.terminationStatus != 0 ) ? task.terminationStatus : EXIT_FAILURE startDate: date variables: variables ];
+        }
+        else if( self.readyTimeout > 0 && -[ date timeIntervalSinceNow ] > self.readyTimeout )
+        {
+            [ task terminateWithGracePeriod: 5 ];
+            [ [ SKShell currentShell ] printWarningMessage: @"Service not ready after %.0f seconds", self.readyTimeout ];
+            
+            return [ self endWithStatus: EXIT_FAILURE startDate: date variables: variables ];
+        }
+    }
+    
+    return [ self finishServiceStart: task startDate: date ];
+}
+
+- ( nullable NSRegularExpression * )readyExpression
+{
+    NSRegularExpression * regex;
+    NSError             * error;
+    
+    if( self.readyPattern.length == 0 )
+    {
+        return nil;
+    }
+    
+    error = nil;
+    regex = [ NSRegularExpression regularExpressionWithPattern: ( NSString * )( self.readyPattern ) options: ( NSRegularExpressionOptions )0 error: &error ];
+    
+    if( regex == nil )
+    {
+        self.error = [ self errorWithDescription: @"Invalid ready pattern: %@", error.localizedDescription ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        self.running = NO;
+    }
+    
+    return regex;
+}
+
+- ( BOOL )finishServiceStart: ( SKProcess * )task startDate: ( NSDate * )date
+{
+    NSString * time;
+    
+    self.serviceTask = task;
+    time             = date.elapsedTimeStringSinceNow;
+    
+    if( time )
+    {
+        time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
+        
+        [ [ SKShell currentShell ] printSuccessMessage: @"Service is ready %@", time ];
+    }
+    else
+    {
+        [ [ SKShell currentShell ] printSuccessMessage: @"Service is ready" ];
+    }
+    
+    return YES;
+}
+
+- ( void )readOutput: ( NSFileHandle * )handle type: ( SKTaskOutputType )type matcher: ( nullable SKTaskOutputMatcher * )matcher semaphore: ( nullable dispatch_semaphore_t )semaphore group: ( nullable dispatch_group_t )group
+{
+    if( group != nil )
+    {
+        dispatch_group_enter( ( dispatch_group_t )group );
+    }
+    
+    dispatch_async
+    (
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            NSData * data;
+            
+            for( ; ; )
+            {
+                /* Long-running services may produce output for hours */
+                @autoreleasepool
+                {
+                    @try
+                    {
+                        data = handle.availableData;
+                    }
+                    @catch( NSException * exception )
+                    {
+                        ( void )exception;
+                        
+                        data = nil;
+                    }
+                    
+                    if( data.length == 0 )
+                    {
+                        break;
+                    }
+                    
+                    [ self handleOutput: ( NSData * )data forType: type ];
+                    
+                    if( semaphore != nil && matcher.matched == NO && [ matcher matchData: ( NSData * )data ] )
+                    {
+                        dispatch_semaphore_signal( ( dispatch_semaphore_t )semaphore );
+                    }
+                }
+            }
+            
+            if( group != nil )
+            {
+                dispatch_group_leave( ( dispatch_group_t )group );
+            }
+        }
+    );
+}
+
+- ( nullable SKEnvironment * )resolvedEnvironment
+{
+    SKEnvironment * environment;
+    
+    environment = self.environment;
+    
+    return ( environment ) ? environment : [ SKShell currentShell ].environment;
+}
+
+- ( BOOL )canBeBatched
+{
+    /* Batch scripts use random markers, so they can't be recorded */
+    return [ self isMemberOfClass: [ SKTask class ] ] && self.isService == NO && self.recoveryPolicy == SKTaskRecoveryPolicySequential && self.processAttributes == nil && [ SKShell currentShell ].recording == nil;
+}
+
+- ( void )beginRunningScript: ( NSString * )script
+{
+    self.running         = YES;
+    self.runningScript   = script;
+    self.pendingOutput   = nil;
+    self.pendingError    = nil;
+    self.eventIdentifier = [ SKEventStream nextIdentifier ];
+    self.exitStatus      = -1;
+    
+    [ self.statusRecord beginWithName: script ];
+    [ [ SKShell currentShell ].eventStream writeTaskStart: self.eventIdentifier script: script ];
+    
+    [ [ SKShell currentShell ] printMessage: @"Running task: %@" status: SKStatusExecute color: SKColorNone, [ script stringWithShellColor: SKColorCyan ] ];
+}
+
+- ( void )cancelWithSignal: ( int )signal
+{
+    SKTask * recover;
+    
+    self.cancelled = YES;
+    
+    [ self.process sendSignal: signal ];
+    
+    for( recover in self.recover )
+    {
+        if( recover.running )
+        {
+            [ recover cancelWithSignal: signal ];
+        }
+    }
+}
+
+- ( void )notifyWillStart
+{
+    id< SKTaskDelegate > delegate;
+    
+    delegate = self.delegate;
+    
+    if( [ delegate respondsToSelector: @selector( taskWillStart: ) ] )
+    {
+        [ delegate taskWillStart: self ];
+    }
+}
+
+- ( void )handleOutput: ( NSData * )data forType: ( SKTaskOutputType )type
+{
+    NSData        * pending;
+    NSMutableData * bytes;
+    NSUInteger      length;
+    
+    if( data.length == 0 )
+    {
+        return;
+    }
+    
+    [ self.statusRecord addOutputBytes: data.length ];
+    [ [ SKShell currentShell ].eventStream writeTaskOutput: self.eventIdentifier data: data type: type ];
+    
+    /* A multibyte character may be split across chunks of output */
+    pending = ( type == SKTaskOutputTypeStandardError ) ? self.pendingError : self.pendingOutput;
+    
+    if( pending.length )
+    {
+        bytes = [ pending mutableCopy ];
+        
+        [ bytes appendData: data ];
+        
+        data = bytes;
+    }
+    
+    length  = SKUTF8CompleteLength( data.bytes, data.length );
+    pending = ( length < data.length ) ? [ data subdataWithRange: NSMakeRange( length, data.length - length ) ] : nil;
+    
+    if( type == SKTaskOutputTypeStandardError )
+    {
+        self.pendingError = pending;
+    }
+    else
+    {
+        self.pendingOutput = pending;
+    }
+    
+    if( length > 0 )
+    {
+        [ self printOutput: SKUTF8StringWithBytes( data.bytes, length ) forType: type ];
+    }
+}
+
+- ( void )printOutput: ( NSString * )output forType: ( SKTaskOutputType )type
+{
+    NSMutableString     * buffer;
+    id < SKTaskDelegate > delegate;
+    
+    delegate = self.delegate;
+    buffer   = self.outputBuffer;
+    
+    if( [ delegate respondsToSelector: @selector( task:didProduceOutput:forType: ) ] )
+    {
+        [ delegate task: self didProduceOutput: output forType: type ];
+    }
+    else if( buffer != nil )
+    {
+        @synchronized( buffer )
+        {
+            [ buffer appendString: output ];
+        }
+    }
+    else
+    {
+        fprintf( ( type == SKTaskOutputTypeStandardError ) ? stderr : stdout, "%s", output.UTF8String );
+    }
+}
+
+- ( void )flushPendingOutput
+{
+    NSData * output;
+    NSData * error;
+    
+    output             = self.pendingOutput;
+    error              = self.pendingError;
+    self.pendingOutput = nil;
+    self.pendingError  = nil;
+    
+    /* Output ended within a multibyte character */
+    if( output.length )
+    {
+        [ self printOutput: SKUTF8StringWithBytes( output.bytes, output.length ) forType: SKTaskOutputTypeStandardOutput ];
+    }
+    
+    if( error.length )
+    {
+        [ self printOutput: SKUTF8StringWithBytes( error.bytes, error.length ) forType: SKTaskOutputTypeStandardError ];
+    }
+}
+
+- ( BOOL )endWithStatus: ( int )status startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    return [ self endWithStatus: status startDate: date variables: variables hedge: SKTaskHedgeNone ];
+}
+
+- ( BOOL )endWithStatus: ( int )status startDate: ( NSDate * )date variables: ( nullable NSDictionary< NSString *, NSString * > * )variables hedge: ( SKTaskHedge )hedge
+{
+    SKTask     * recover;
+    NSUInteger   i;
+    BOOL         recovered;
+    
+    [ self notifyEndWithStatus: status ];
+    
+    if( hedge == SKTaskHedgeSucceeded || ( status != 0 && self.cancelled == NO && self.recover.count ) )
+    {
+        recovered = ( hedge == SKTaskHedgeSucceeded );
+        
+        if( recovered == NO && self.recoveryPolicy == SKTaskRecoveryPolicyRace )
+        {
+            recover    = [ self raceRecoveryTasks: variables ];
+            recovered  = recover != nil;
+            self.error = ( recover ) ? recover.error : self.recover.lastObject.error;
+        }
+        else if( recovered == NO )
+        {
+            /* The first recovery task has already been tried if hedged */
+            if( hedge == SKTaskHedgeFailed )
+            {
+                self.error = self.recover.firstObject.error;
+            }
+            
+            for( i = ( hedge == SKTaskHedgeFailed ) ? 1 : 0; i < self.recover.count && recovered == NO && self.cancelled == NO; i++ )
+            {
+                [ [ SKShell currentShell ] printWarningMessage: @"Task failed - Trying to recover" ];
+                
+                recovered  = [ self.recover[ i ] run: variables ];
+                self.error = self.recover[ i ].error;
+            }
+        }
+        
+        /* A task cancelled while recovering fails as cancelled */
+        if( recovered || self.cancelled == NO )
+        {
+            return [ self finishRecovery: recovered startDate: date ];
+        }
+    }
+    
+    return [ self finishWithStatus: status startDate: date ];
+}
+
+- ( void )notifyEndWithStatus: ( int )status
+{
+    id< SKTaskDelegate > delegate;
+    
+    delegate        = self.delegate;
+    self.exitStatus = status;
+    
+    [ self flushPendingOutput ];
+    
+    if( [ delegate respondsToSelector: @selector( task:didEndWithStatus: ) ] )
+    {
+        [ delegate task: self didEndWithStatus: status ];
+    }
+}
+
+- ( BOOL )finishRecovery: ( BOOL )recovered startDate: ( NSDate * )date
+{
+    NSString * time;
+    
+    if( recovered == NO )
+    {
+        [ [ SKShell currentShell ] printErrorMessage: @"Task failed to recover" ];
+        
+        self.running = NO;
+        
+        return NO;
+    }
+    
+    time = date.elapsedTimeStringSinceNow;
+    
+    if( time )
+    {
+        time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
+        
+        [ [ SKShell currentShell ] printSuccessMessage: @"Task recovered successfully %@", time ];    
+    }
+    else
+    {
+        [ [ SKShell currentShell ] printSuccessMessage: @"Task recovered successfully" ];    
+    }
+    
+    self.running = NO;
+    
+    return YES;
+}
+
+- ( BOOL )finishWithStatus: ( int )status startDate: ( NSDate * )date
+{
+    NSString * time;
+    
+    if( status != 0 && self.cancelled )
+    {
+        self.error = [ self errorWithDescription: @"Task was cancelled" ];
+        
+        [ [ SKShell currentShell ] printWarningMessage: @"Task was cancelled" ];
+        
+        self.running = NO;
+        
+        return NO;
+    }
+    
+    if( status != 0 )
+    {
+        self.error = [ self errorWithDescription: @"Task exited with status %li", ( long )status ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        self.running = NO;
+        
+        return NO;
+    }
+    
+    if( self.runningScript )
+    {
+        [ SKTask recordDuration: -[ date timeIntervalSinceNow ] forScript: ( NSString * )( self.runningScript ) ];
+    }
+    
+    time = date.elapsedTimeStringSinceNow;
+    
+    if( time )
+    {
+        time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
+        
+        [ [ SKShell currentShell ] printSuccessMessage: @"Task completed successfully %@", time ];
+    }
+    else
+    {
+        [ [ SKShell currentShell ] printSuccessMessage: @"Task completed successfully" ];
+    }    
+    
+    self.running = NO;
+    
+    return YES;
+}
+
+- ( void )recordEndOfRun: ( BOOL )success
+{
+    /* Services keep running until stopped */
+    if( success && self.serviceTask != nil )
+    {
+        return;
+    }
+    
+    if( success )
+    {
+        [ self recordEndWithState: SKTaskStateSucceeded ];
+    }
+    else
+    {
+        [ self recordEndWithState: ( self.cancelled ) ? SKTaskStateCancelled : SKTaskStateFailed ];
+    }
+}
+
+- ( void )recordEndWithState: ( SKTaskState )state
+{
+    [ self.statusRecord endWithState: state ];
+    
+    /* Runs failing before having started have no start event */
+    if( self.eventIdentifier != 0 )
+    {
+        [ [ SKShell currentShell ].eventStream writeTaskEnd: self.eventIdentifier state: state status: self.exitStatus duration: self.statusRecord.elapsedTime ];
+        
+        self.eventIdentifier = 0;
     }
 }
 
@@ -0,0 +1,52 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTaskBarrier+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private interface of SKTaskBarrier, used by SKTaskGroup
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKTaskBarrier.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@class SKOptionalTask;
+
+@interface SKTaskBarrier()
+
+/*!
+ * @method      barrierJoiningTasks:
+ * @abstract    Creates a barrier joining only some detached tasks
+ * @discussion  Used by task groups, so a barrier only joins the tasks
+ *              detached by the same run of the group.
+ * @param       tasks   The detached tasks to join
+ * @result      The barrier object
+ */
++ ( instancetype )barrierJoiningTasks: ( NSArray< SKOptionalTask * > * )tasks;
+
+@end
+
+NS_ASSUME_NONNULL_END
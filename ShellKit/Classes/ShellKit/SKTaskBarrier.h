@@ -0,0 +1,61 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTaskBarrier.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+#import <ShellKit/SKRunableObject.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @class       SKTaskBarrier
+ * @abstract    Joins the optional tasks running in the background
+ * @discussion  When run, typically as part of a task group, a barrier waits
+ *              for detached optional tasks to finish (each wait being
+ *              bounded by the task's join timeout), and prints their
+ *              output.
+ *              In a task group, only the tasks detached by the same run of
+ *              the group are joined. Run on its own, a barrier joins all
+ *              the detached tasks of the process.
+ *              As optional tasks never fail, a barrier always succeeds.
+ * @see         SKOptionalTask
+ * @see         SKRunableObject
+ */
+@interface SKTaskBarrier: SKObject < SKRunableObject >
+
+/*!
+ * @method      barrier
+ * @abstract    Creates a barrier
+ * @result      The barrier object
+ */
++ ( instancetype )barrier;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,104 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKTaskBarrier.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKTaskBarrier+Private.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKTaskBarrier()
+
+@property( atomic, readwrite, assign           ) BOOL                          running;
+@property( atomic, readwrite, strong, nullable ) NSError                     * error;
+@property( atomic, readwrite, strong, nullable ) NSArray< SKOptionalTask * > * tasks;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKTaskBarrier
+
++ ( instancetype )barrier
+{
+    return [ self new ];
+}
+
++ ( instancetype )barrierJoiningTasks: ( NSArray< SKOptionalTask * > * )tasks
+{
+    SKTaskBarrier * barrier;
+    
+    barrier       = [ self new ];
+    barrier.tasks = [ tasks copy ];
+    
+    return barrier;
+}
+
+#pragma mark - SKRunableObject
+
+- ( BOOL )run
+{
+    return [ self run: nil ];
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSArray< SKOptionalTask * > * tasks;
+    SKOptionalTask              * task;
+    BOOL                          joined;
+    
+    ( void )variables;
+    
+    self.running = YES;
+    tasks        = self.tasks;
+    
+    if( tasks == nil )
+    {
+        joined = [ SKOptionalTask joinBackgroundTasks ];
+    }
+    else
+    {
+        joined = YES;
+        
+        for( task in tasks )
+        {
+            joined = [ task join ] && joined;
+        }
+    }
+    
+    if( joined == NO )
+    {
+        [ [ SKShell currentShell ] printSuccessMessage: @"Tasks are marked as optional - Not failing" ];
+    }
+    
+    self.running = NO;
+    
+    return YES;
+}
+
+@end
@@ -0,0 +1,128 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTaskBatch.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+#import <ShellKit/SKTask.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKTaskBatchHandler
+ * @abstract    Handler called as a batched task starts or ends
+ * @param       task    The task
+ * @param       index   The index of the task in the batch
+ */
+typedef void ( ^ SKTaskBatchHandler )( SKTask * task, NSUInteger index );
+
+/*!
+ * @class       SKTaskBatch
+ * @abstract    Runs adjacent tasks in a single shell invocation
+ * @discussion  The tasks' scripts are merged into one shell script, each of
+ *              them running in its own subshell, and delimited by sentinel
+ *              markers on both `stdout` and `stderr`.
+ *              The markers are used to attribute the output to the correct
+ *              task and to retrieve the exit status of each task, so
+ *              delegate callbacks and recovery tasks behave as if each task
+ *              was run on its own.
+ *              If a task fails, the script stops. If the task then recovers,
+ *              the remaining tasks are run in a new shell invocation.
+ */
+@interface SKTaskBatch: SKObject
+
+/*!
+ * @property    tasks
+ * @abstract    The tasks contained in the batch
+ */
+@property( atomic, readonly ) NSArray< SKTask * > * tasks;
+
+/*!
+ * @property    failedTask
+ * @abstract    The task that made the batch fail, if any
+ */
+@property( atomic, readonly, nullable ) SKTask * failedTask;
+
+/*!
+ * @property    error
+ * @abstract    An optional error, possibly set after the batch has run
+ */
+@property( atomic, readonly, nullable ) NSError * error;
+
+/*!
+ * @property    runsInOwnProcessGroup
+ * @abstract    Runs the shell in its own process group
+ * @discussion  Needed for all the commands of the running task to be
+ *              terminated when the batch is cancelled.
+ */
+@property( atomic, readwrite, assign ) BOOL runsInOwnProcessGroup;
+
+/*!
+ * @property    willStartTask
+ * @abstract    Optional handler called before each task starts
+ */
+@property( atomic, readwrite, copy, nullable ) SKTaskBatchHandler willStartTask;
+
+/*!
+ * @property    didEndTask
+ * @abstract    Optional handler called after each task has ended
+ */
+@property( atomic, readwrite, copy, nullable ) SKTaskBatchHandler didEndTask;
+
+/*!
+ * @method      batchWithTasks:variables:
+ * @abstract    Creates a batch from the leading tasks of an array
+ * @discussion  Tasks are taken from the start of the array, as long as they
+ *              can be batched, their scripts can be rendered with the
+ *              passed variables, and they share the same environment.
+ * @param       tasks       The candidate tasks
+ * @param       variables   Optional variables
+ * @result      The batch object, or nil if less than two tasks can be batched
+ */
++ ( nullable instancetype )batchWithTasks: ( NSArray< id< SKRunableObject > > * )tasks variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      run
+ * @abstract    Runs the batched tasks (synchronously)
+ * @result      YES if all tasks have run successfully, otherwise NO
+ */
+- ( BOOL )run;
+
+/*!
+ * @method      cancel
+ * @abstract    Cancels the batch, if it is running
+ * @discussion  The shell running the batched tasks is terminated. The
+ *              current task is marked as cancelled, and fails without
+ *              trying its recovery tasks.
+ *              This method may be called from any thread.
+ */
+- ( void )cancel;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,583 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKTaskBatch.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKTask+Private.h"
+#import "SKTaskBatch.h"
+
+NS_ASSUME_NONNULL_BEGIN
+
+typedef NS_ENUM( NSInteger, SKTaskBatchEventKind )
+{
+    SKTaskBatchEventKindBegin,
+    SKTaskBatchEventKindOutput,
+    SKTaskBatchEventKindEnd,
+    SKTaskBatchEventKindExit
+};
+
+@interface SKTaskBatchEvent: NSObject
+
+@property( atomic, readwrite, assign           ) SKTaskBatchEventKind kind;
+@property( atomic, readwrite, assign           ) NSUInteger           index;
+@property( atomic, readwrite, assign           ) SKTaskOutputType     type;
+@property( atomic, readwrite, assign           ) int                  status;
+@property( atomic, readwrite, strong, nullable ) NSData             * data;
+
+@end
+
+@interface SKTaskBatchReader: NSObject
+
+@property( atomic, readwrite, assign ) SKTaskOutputType type;
+@property( atomic, readwrite, assign ) NSInteger        index;
+@property( atomic, readwrite, strong ) NSMutableData  * buffer;
+
+@end
+
+@interface SKTaskBatch()
+
+@property( atomic, readwrite, strong           ) NSArray< SKTask * >                     * tasks;
+@property( atomic, readwrite, strong           ) NSArray< NSString * >                   * scripts;
+@property( atomic, readwrite, strong, nullable ) NSDictionary< NSString *, NSString * >  * variables;
+@property( atomic, readwrite, strong, nullable ) SKTask                                  * failedTask;
+@property( atomic, readwrite, strong, nullable ) NSError                                 * error;
+@property( atomic, readwrite, strong           ) NSString                                * marker;
+@property( atomic, readwrite, strong           ) NSData                                  * markerPrefix;
+@property( atomic, readwrite, strong           ) NSMutableArray< SKTaskBatchEvent * >    * events;
+@property( atomic, readwrite, strong           ) dispatch_semaphore_t                      semaphore;
+@property( atomic, readwrite, strong, nullable ) SKProcess                               * process;
+@property( atomic, readwrite, assign           ) BOOL                                      cancelled;
+
+- ( instancetype )initWithTasks: ( NSArray< SKTask * > * )tasks scripts: ( NSArray< NSString * > * )scripts variables: ( nullable NSDictionary< NSString *, NSString * > * )variables NS_DESIGNATED_INITIALIZER;
+- ( BOOL )runFromIndex: ( NSUInteger )start next: ( NSUInteger * )next;
+- ( BOOL )endTaskAtIndex: ( NSUInteger )index status: ( int )status date: ( NSDate * )date;
+- ( NSString * )scriptFromIndex: ( NSUInteger )start;
+- ( void )read: ( NSFileHandle * )handle type: ( SKTaskOutputType )type group: ( dispatch_group_t )group;
+- ( void )parse: ( SKTaskBatchReader * )reader final: ( BOOL )final;
+- ( NSUInteger )partialMarkerLengthInBuffer: ( NSData * )buffer;
+- ( void )emit: ( NSData * )data reader: ( SKTaskBatchReader * )reader;
+- ( void )postEvent: ( SKTaskBatchEvent * )event;
+- ( SKTaskBatchEvent * )nextEvent;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKTaskBatchEvent
+
+@end
+
+@implementation SKTaskBatchReader
+
+@end
+
+@implementation SKTaskBatch
+
++ ( nullable instancetype )batchWithTasks: ( NSArray< id< SKRunableObject > > * )tasks variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    id< SKRunableObject >          object;
+    NSString                     * script;
+    NSMutableArray< SKTask * >   * batched;
+    NSMutableArray< NSString * > * scripts;
+    SKEnvironment                * environment;
+    
+    batched     = [ NSMutableArray new ];
+    scripts     = [ NSMutableArray new ];
+    environment = nil;
+    
+    for( object in tasks )
+    {
+        if( [ object isKindOfClass: [ SKTask class ] ] == NO || [ ( SKTask * )object canBeBatched ] == NO )
+        {
+            break;
+        }
+        
+        /* All tasks of a batch share the same shell, and thus environment */
+        if( batched.count && [ ( SKTask * )object resolvedEnvironment ] != environment && [ [ ( SKTask * )object resolvedEnvironment ] isEqual: environment ] == NO )
+        {
+            break;
+        }
+        
+        environment = [ ( SKTask * )object resolvedEnvironment ];
+        
+        script = [ ( SKTask * )object scriptWithVariables: variables ];
+        
+        if( script == nil )
+        {
+            break;
+        }
+        
+        [ batched addObject: ( SKTask * )object ];
+        [ scripts addObject: script ];
+    }
+    
+    if( batched.count < 2 )
+    {
+        return nil;
+    }
+    
+    return [ [ self alloc ] initWithTasks: batched scripts: scripts variables: variables ];
+}
+
+- ( instancetype )init
+{
+    return [ self initWithTasks: @[] scripts: @[] variables: nil ];
+}
+
+- ( instancetype )initWithTasks: ( NSArray< SKTask * > * )tasks scripts: ( NSArray< NSString * > * )scripts variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.tasks        = tasks;
+        self.scripts      = scripts;
+        self.variables    = variables;
+        self.marker       = [ NSString stringWithFormat: @"__SK_BATCH_%@__", [ [ NSUUID UUID ].UUIDString stringByReplacingOccurrencesOfString: @"-" withString: @"" ] ];
+        self.markerPrefix = [ [ NSString stringWithFormat: @"\n%@:", self.marker ] dataUsingEncoding: NSUTF8StringEncoding ];
+        self.events       = [ NSMutableArray new ];
+        self.semaphore    = dispatch_semaphore_create( 0 );
+    }
+    
+    return self;
+}
+
+- ( BOOL )run
+{
+    NSUInteger index;
+    
+    index          = 0;
+    self.cancelled = NO;
+    
+    while( index < self.tasks.count && self.cancelled == NO )
+    {
+        if( [ self runFromIndex: index next: &index ] == NO )
+        {
+            return NO;
+        }
+    }
+    
+    return self.cancelled == NO;
+}
+
+- ( void )cancel
+{
+    self.cancelled = YES;
+    
+    [ self.process terminate ];
+}
+
+- ( BOOL )runFromIndex: ( NSUInteger )start next: ( NSUInteger * )next
+{
+    SKProcess          * task;
+    NSPipe             * standardOutput;
+    NSPipe             * standardError;
+    dispatch_group_t     readers;
+    SKTaskBatchEvent   * event;
+    SKTaskBatchHandler   handler;
+    NSDate             * date;
+    NSInteger            current;
+    NSInteger            last;
+    NSUInteger           ends;
+    int                  status;
+    BOOL                 success;
+    
+    standardOutput      = [ NSPipe pipe ];
+    standardError       = [ NSPipe pipe ];
+    readers             = dispatch_group_create();
+    task                = [ SKProcess new ];
+    task.launchPath     = ( [ SKShell currentShell ].shell != nil ) ? ( NSString * )( [ SKShell currentShell ].shell ) : @"/bin/sh";
+    task.arguments      = @[ @"-l", @"-c", [ self scriptFromIndex: start ] ];
+    task.environment    = [ self.tasks[ start ] resolvedEnvironment ];
+    task.standardOutput = standardOutput;
+    task.standardError  = standardError;
+    
+    task.createsProcessGroup = self.runsInOwnProcessGroup;
+    
+    if( [ task launch ] == NO )
+    {
+        self.failedTask = self.tasks[ start ];
+        self.error      = task.error;
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        return NO;
+    }
+    
+    self.process = task;
+    
+    /* The batch may have been cancelled before being launched */
+    if( self.cancelled )
+    {
+        [ task terminate ];
+    }
+    
+    [ self read: standardOutput.fileHandleForReading type: SKTaskOutputTypeStandardOutput group: readers ];
+    [ self read: standardError.fileHandleForReading  type: SKTaskOutputTypeStandardError  group: readers ];
+    
+    dispatch_async
+    (
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            SKTaskBatchEvent * exit;
+            
+            dispatch_group_wait( readers, DISPATCH_TIME_FOREVER );
+            
+            [ task waitUntilExit ];
+            
+            exit        = [ SKTaskBatchEvent new ];
+            exit.kind   = SKTaskBatchEventKindExit;
+            exit.status = task.terminationStatus;
+            
+            [ self postEvent: exit ];
+        }
+    );
+    
+    current = -1;
+    last    = ( NSInteger )start - 1;
+    ends    = 0;
+    status  = 0;
+    date    = [ NSDate date ];
+    success = YES;
+    
+    while( ( event = [ self nextEvent ] ).kind != SKTaskBatchEventKindExit )
+    {
+        /* Events are processed for each task of the batch, and may be numerous */
+        @autoreleasepool
+        {
+            if( event.index >= self.tasks.count )
+            {
+                continue;
+            }
+            
+            if( event.kind == SKTaskBatchEventKindBegin && ( NSInteger )( event.index ) > last && success )
+            {
+                /* Output from the previous task may still be pending on stderr */
+                if( current >= 0 )
+                {
+                    success = [ self endTaskAtIndex: ( NSUInteger )current status: status date: date ];
+                    current = -1;
+                    
+                    if( success == NO )
+                    {
+                        continue;
+                    }
+                }
+                
+                current = ( NSInteger )( event.index );
+                last    = current;
+                ends    = 0;
+                status  = 0;
+                date    = [ NSDate date ];
+                handler = self.willStartTask;
+                
+                if( handler )
+                {
+                    handler( self.tasks[ event.index ], event.index );
+                }
+                
+                [ self.tasks[ event.index ] beginRunningScript: self.scripts[ event.index ] ];
+                [ self.tasks[ event.index ].statusRecord setProcessIdentifier: task.processIdentifier ];
+                [ self.tasks[ event.index ] notifyWillStart ];
+            }
+            else if( event.kind == SKTaskBatchEventKindOutput && ( NSInteger )( event.index ) <= last && event.data != nil )
+            {
+                [ self.tasks[ event.index ] handleOutput: ( NSData * )( event.data ) forType: event.type ];
+            }
+            else if( event.kind == SKTaskBatchEventKindEnd && ( NSInteger )( event.index ) == current )
+            {
+                status = event.status;
+                
+                if( ++ends == 2 )
+                {
+                    success = [ self endTaskAtIndex: ( NSUInteger )current status: status date: date ];
+                    current = -1;
+                }
+            }
+        }
+    }
+    
+    if( current >= 0 )
+    {
+        if( ends == 0 )
+        {
+            status = ( event.status != 0 ) ? event.status : EXIT_FAILURE;
+        }
+        
+        success = [ self endTaskAtIndex: ( NSUInteger )current status: status date: date ];
+    }
+    
+    if( last < ( NSInteger )start )
+    {
+        self.failedTask = self.tasks[ start ];
+        self.error      = [ self errorWithDescription: @"Batched tasks exited with status %li before running", ( long )( event.status ) ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        return NO;
+    }
+    
+    *( next ) = ( NSUInteger )( last + 1 );
+    
+    return success;
+}
+
+- ( BOOL )endTaskAtIndex: ( NSUInteger )index status: ( int )status date: ( NSDate * )date
+{
+    SKTask             * task;
+    SKTaskBatchHandler   handler;
+    BOOL                 success;
+    
+    task           = self.tasks[ index ];
+    task.cancelled = self.cancelled;
+    success        = [ task endWithStatus: status startDate: date variables: self.variables ];
+    handler        = self.didEndTask;
+    
+    [ task recordEndOfRun: success ];
+    
+    if( handler )
+    {
+        handler( task, index );
+    }
+    
+    if( success == NO )
+    {
+        self.failedTask = task;
+        self.error      = task.error;
+    }
+    
+    return success;
+}
+
+- ( NSString * )scriptFromIndex: ( NSUInteger )start
+{
+    NSMutableString * script;
+    NSUInteger        i;
+    
+    script = [ NSMutableString new ];
+    
+    for( i = start; i < self.scripts.count; i++ )
+    {
+        [ script appendFormat: @"printf '\\n%%s:B:%lu\\n' '%@'\n",                     ( unsigned long )i, self.marker ];
+        [ script appendFormat: @"printf '\\n%%s:B:%lu\\n' '%@' 1>&2\n",                ( unsigned long )i, self.marker ];
+        [ script appendFormat: @"(\n%@\n)\n",                                          self.scripts[ i ] ];
+        [ script appendString: @"__sk_status=$?\n" ];
+        [ script appendFormat: @"printf '\\n%%s:E:%lu:%%d\\n' '%@' $__sk_status 1>&2\n", ( unsigned long )i, self.marker ];
+        [ script appendFormat: @"printf '\\n%%s:E:%lu:%%d\\n' '%@' $__sk_status\n",      ( unsigned long )i, self.marker ];
+        [ script appendString: @"[ $__sk_status -eq 0 ] || exit $__sk_status\n" ];
+    }
+    
+    return script;
+}
+
+- ( void )read: ( NSFileHandle * )handle type: ( SKTaskOutputType )type group: ( dispatch_group_t )group
+{
+    SKTaskBatchReader * reader;
+    
+    reader        = [ SKTaskBatchReader new ];
+    reader.type   = type;
+    reader.index  = -1;
+    reader.buffer = [ NSMutableData new ];
+    
+    dispatch_group_async
+    (
+        group,
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            NSData * data;
+            
+            for( ; ; )
+            {
+                @autoreleasepool
+                {
+                    @try
+                    {
+                        data = handle.availableData;
+                    }
+                    @catch( NSException * exception )
+                    {
+                        ( void )exception;
+                        
+                        data = nil;
+                    }
+                    
+                    if( data.length == 0 )
+                    {
+                        break;
+                    }
+                    
+                    [ reader.buffer appendData: ( NSData * )data ];
+                    [ self parse: reader final: NO ];
+                }
+            }
+            
+            [ self parse: reader final: YES ];
+        }
+    );
+}
+
+- ( void )parse: ( SKTaskBatchReader * )reader final: ( BOOL )final
+{
+    NSMutableData    * buffer;
+    NSData           * newline;
+    NSRange            range;
+    NSRange            end;
+    NSUInteger         keep;
+    NSString         * line;
+    NSArray          * fields;
+    SKTaskBatchEvent * event;
+    
+    buffer  = reader.buffer;
+    newline = [ NSData dataWithBytes: "\n" length: 1 ];
+    
+    while( buffer.length )
+    {
+        range = [ buffer rangeOfData: self.markerPrefix options: ( NSDataSearchOptions )0 range: NSMakeRange( 0, buffer.length ) ];
+        
+        if( range.location == NSNotFound )
+        {
+            keep = ( final ) ? 0 : [ self partialMarkerLengthInBuffer: buffer ];
+            
+            [ self emit: [ buffer subdataWithRange: NSMakeRange( 0, buffer.length - keep ) ] reader: reader ];
+            [ buffer replaceBytesInRange: NSMakeRange( 0, buffer.length - keep ) withBytes: NULL length: 0 ];
+            
+            break;
+        }
+        
+        end = [ buffer rangeOfData: newline options: ( NSDataSearchOptions )0 range: NSMakeRange( NSMaxRange( range ), buffer.length - NSMaxRange( range ) ) ];
+        
+        if( end.location == NSNotFound )
+        {
+            /* Incomplete marker - Wait for more data */
+            keep = ( final ) ? 0 : buffer.length - range.location;
+            
+            [ self emit: [ buffer subdataWithRange: NSMakeRange( 0, buffer.length - keep ) ] reader: reader ];
+            [ buffer replaceBytesInRange: NSMakeRange( 0, buffer.length - keep ) withBytes: NULL length: 0 ];
+            
+            break;
+        }
+        
+        [ self emit: [ buffer subdataWithRange: NSMakeRange( 0, range.location ) ] reader: reader ];
+        
+        line   = [ [ NSString alloc ] initWithData: [ buffer subdataWithRange: NSMakeRange( NSMaxRange( range ), end.location - NSMaxRange( range ) ) ] encoding: NSUTF8StringEncoding ];
+        fields = [ line componentsSeparatedByString: @":" ];
+        
+        [ buffer replaceBytesInRange: NSMakeRange( 0, NSMaxRange( end ) ) withBytes: NULL length: 0 ];
+        
+        if( fields.count == 2 && [ fields[ 0 ] isEqualToString: @"B" ] )
+        {
+            event        = [ SKTaskBatchEvent new ];
+            event.kind   = SKTaskBatchEventKindBegin;
+            event.index  = ( NSUInteger )[ fields[ 1 ] integerValue ];
+            reader.index = ( NSInteger )( event.index );
+            
+            [ self postEvent: event ];
+        }
+        else if( fields.count == 3 && [ fields[ 0 ] isEqualToString: @"E" ] )
+        {
+            event        = [ SKTaskBatchEvent new ];
+            event.kind   = SKTaskBatchEventKindEnd;
+            event.index  = ( NSUInteger )[ fields[ 1 ] integerValue ];
+            event.status = [ fields[ 2 ] intValue ];
+            reader.index = -1;
+            
+            [ self postEvent: event ];
+        }
+    }
+}
+
+- ( NSUInteger )partialMarkerLengthInBuffer: ( NSData * )buffer
+{
+    NSUInteger      n;
+    const uint8_t * bytes;
+    
+    bytes = buffer.bytes;
+    
+    for( n = MIN( buffer.length, self.markerPrefix.length - 1 ); n > 0; n-- )
+    {
+        if( memcmp( bytes + buffer.length - n, self.markerPrefix.bytes, n ) == 0 )
+        {
+            return n;
+        }
+    }
+    
+    return 0;
+}
+
+- ( void )emit: ( NSData * )data reader: ( SKTaskBatchReader * )reader
+{
+    SKTaskBatchEvent * event;
+    
+    if( data.length == 0 )
+    {
+        return;
+    }
+    
+    if( reader.index < 0 )
+    {
+        fwrite( data.bytes, 1, data.length, ( reader.type == SKTaskOutputTypeStandardError ) ? stderr : stdout );
+        
+        return;
+    }
+    
+    event       = [ SKTaskBatchEvent new ];
+    event.kind  = SKTaskBatchEventKindOutput;
+    event.index = ( NSUInteger )( reader.index );
+    event.type  = reader.type;
+    event.data  = data;
+    
+    [ self postEvent: event ];
+}
+
+- ( void )postEvent: ( SKTaskBatchEvent * )event
+{
+    @synchronized( self.events )
+    {
+        [ self.events addObject: event ];
+    }
+    
+    dispatch_semaphore_signal( self.semaphore );
+}
+
+- ( SKTaskBatchEvent * )nextEvent
+{
+    SKTaskBatchEvent * event;
+    
+    dispatch_semaphore_wait( self.semaphore, DISPATCH_TIME_FOREVER );
+    
+    @synchronized( self.events )
+    {
+        event = self.events.firstObject;
+        
+        [ self.events removeObjectAtIndex: 0 ];
+    }
+    
+    return event;
+}
+
+@end
@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTaskGraph.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+#import <ShellKit/SKRunableObject.h>
+#import <ShellKit/SKTaskGroup.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @class       SKTaskGraph
+ * @abstract    Tasks and task groups loaded from a file
+ * @discussion  The file is read line by line, in a single pass. Each line
+ *              starts with a keyword:
+ *              `var NAME [= VALUE]` declares a variable, with an optional
+ *              default value. Scripts may only use variables declared
+ *              before them.
+ *              `task SCRIPT` and `optional SCRIPT` add a task or an
+ *              optional task to the current group, and `recover SCRIPT`
+ *              adds a recovery task to the last one.
+ *              `group NAME` starts a group, ended by `end`, and `barrier`
+ *              adds a task barrier.
+ *              Other keywords are options of the last task or group:
+ *              `id`, `after`, `weight`, `inputs`, `policy`,
+ *              `ready-pattern`, `ready-path`, `ready-timeout`, `nice`,
+ *              `detached` and `join-timeout` for tasks, and `id`, `after`,
+ *              `parallel`, `batch` and `cpus` for groups.
+ *              `after` lists the identifiers of tasks or groups of the same
+ *              group that must be run first. Sequential groups are
+ *              reordered accordingly, and parallel groups are run in
+ *              stages. Barriers can't be used in groups with dependencies.
+ *              Lines starting with `#` are comments, and lines ending with
+ *              a backslash continue on the next line.
+ *              Once loaded, the graph is written to a precompiled cache,
+ *              which is used instead of the file as long as the file is
+ *              unchanged.
+ * @see         SKTaskGroup
+ * @see         SKRunableObject
+ */
+@interface SKTaskGraph: SKObject < SKRunableObject >
+
+/*!
+ * @property    path
+ * @abstract    The path of the task graph file
+ */
+@property( atomic, readonly ) NSString * path;
+
+/*!
+ * @property    taskGroup
+ * @abstract    The top-level task group
+ * @discussion  The group is named after the file, and contains the tasks
+ *              and groups declared outside of any group.
+ */
+@property( atomic, readonly ) SKTaskGroup * taskGroup;
+
+/*!
+ * @property    variables
+ * @abstract    The default values of the variables declared in the file
+ * @discussion  Variables passed to `run:` take precedence over these.
+ */
+@property( atomic, readonly ) NSDictionary< NSString *, NSString * > * variables;
+
+/*!
+ * @property    requiredVariables
+ * @abstract    The variables declared without a default value
+ * @discussion  These must be passed to `run:`.
+ */
+@property( atomic, readonly ) NSArray< NSString * > * requiredVariables;
+
+/*!
+ * @property    loadedFromCache
+ * @abstract    Set if the graph was loaded from its precompiled cache
+ */
+@property( atomic, readonly ) BOOL loadedFromCache;
+
+/*!
+ * @method      taskGraphWithContentsOfFile:error:
+ * @abstract    Loads a task graph
+ * @discussion  The precompiled cache is stored next to the file, with an
+ *              additional `.cache` extension.
+ * @param       path    The path of the task graph file
+ * @param       error   On failure, set to an error describing the failing line
+ * @result      The task graph object, or nil if the file can't be loaded
+ */
++ ( nullable instancetype )taskGraphWithContentsOfFile: ( NSString * )path error: ( NSError * _Nullable * _Nullable )error;
+
+/*!
+ * @method      initWithContentsOfFile:cachePath:error:
+ * @abstract    Loads a task graph
+ * @discussion  If the cache can't be written, the graph is still loaded.
+ * @param       path        The path of the task graph file
+ * @param       cachePath   The path of the precompiled cache, or nil not to use a cache
+ * @param       error       On failure, set to an error describing the failing line
+ * @result      The task graph object, or nil if the file can't be loaded
+ */
+- ( nullable instancetype )initWithContentsOfFile: ( NSString * )path cachePath: ( nullable NSString * )cachePath error: ( NSError * _Nullable * _Nullable )error NS_DESIGNATED_INITIALIZER;
+
+- ( instancetype )init NS_UNAVAILABLE;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,1017 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKTaskGraph.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKTask+Private.h"
+#import <sys/stat.h>
+
+#define SK_TASK_GRAPH_CACHE_VERSION 1
+
+/* Nodes are property lists, so parsed graphs can be cached as they are */
+typedef NSMutableDictionary< NSString *, id > SKTaskGraphNode;
+
+NS_ASSUME_NONNULL_BEGIN
+
+static NSDictionary * SKTaskGraphSourceKey( const struct stat * info );
+
+@interface SKTaskGraph()
+
+@property( atomic, readwrite, strong           ) NSString                               * path;
+@property( atomic, readwrite, strong           ) SKTaskGroup                            * taskGroup;
+@property( atomic, readwrite, strong           ) NSDictionary< NSString *, NSString * > * variables;
+@property( atomic, readwrite, strong           ) NSArray< NSString * >                  * requiredVariables;
+@property( atomic, readwrite, assign           ) BOOL                                     loadedFromCache;
+@property( atomic, readwrite, assign           ) BOOL                                     running;
+@property( atomic, readwrite, strong, nullable ) NSError                                * error;
+
+- ( BOOL )loadFile: ( NSString * )path cachePath: ( nullable NSString * )cachePath;
+- ( BOOL )loadCache: ( NSString * )path source: ( NSDictionary * )source;
+- ( void )saveCache: ( NSString * )path source: ( NSDictionary * )source root: ( SKTaskGraphNode * )root;
+- ( nullable SKTaskGraphNode * )parseFile: ( FILE * )fp;
+- ( BOOL )parseVariable: ( NSString * )declaration line: ( NSUInteger )line;
+- ( BOOL )parseOption: ( NSString * )option value: ( NSString * )value node: ( nullable SKTaskGraphNode * )node line: ( NSUInteger )line;
+- ( BOOL )validateScript: ( NSString * )script line: ( NSUInteger )line;
+- ( BOOL )resolveDependenciesOfGroup: ( SKTaskGraphNode * )group;
+- ( BOOL )isValidNode: ( id )node;
+- ( BOOL )isArray: ( id )array ofClass: ( Class )cls;
+- ( id< SKRunableObject > )objectWithNode: ( NSDictionary< NSString *, id > * )node;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+static NSDictionary * SKTaskGraphSourceKey( const struct stat * info )
+{
+
+#if defined( __APPLE__ )
+    
+    struct timespec modified = info->st_mtimespec;
+
+#else
+    
+    struct timespec modified = info->st_mtim;
+
+#endif
+    
+    return @{ @"device" : @( info->st_dev ), @"inode" : @( info->st_ino ), @"size" : @( info->st_size ), @"seconds" : @( modified.tv_sec ), @"nanoseconds" : @( modified.tv_nsec ) };
+}
+
+@implementation SKTaskGraph
+
++ ( nullable instancetype )taskGraphWithContentsOfFile: ( NSString * )path error: ( NSError * _Nullable * _Nullable )error
+{
+    return [ [ self alloc ] initWithContentsOfFile: path cachePath: [ path stringByAppendingPathExtension: @"cache" ] error: error ];
+}
+
+- ( nullable instancetype )initWithContentsOfFile: ( NSString * )path cachePath: ( nullable NSString * )cachePath error: ( NSError * _Nullable * _Nullable )error
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.path              = path;
+        self.variables         = @{};
+        self.requiredVariables = @[];
+        
+        if( [ self loadFile: path cachePath: cachePath ] == NO )
+        {
+            if( error != NULL )
+            {
+                *( error ) = self.error;
+            }
+            
+            return nil;
+        }
+    }
+    
+    return self;
+}
+
+#pragma mark - SKRunableObject
+
+- ( BOOL )run
+{
+    return [ self run: nil ];
+}
+
+- ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSMutableDictionary< NSString *, NSString * > * values;
+    NSString                                      * name;
+    BOOL                                            success;
+    
+    values = [ self.variables mutableCopy ];
+    
+    if( variables != nil )
+    {
+        [ values addEntriesFromDictionary: ( NSDictionary * )variables ];
+    }
+    
+    for( name in self.requiredVariables )
+    {
+        if( values[ name ] == nil )
+        {
+            self.error = [ self errorWithDescription: @"Missing variable %@ for task graph %@", name, self.path ];
+            
+            [ [ SKShell currentShell ] printError: self.error ];
+            
+            return NO;
+        }
+    }
+    
+    self.error   = nil;
+    self.running = YES;
+    success      = [ self.taskGroup run: values ];
+    self.error   = self.taskGroup.error;
+    self.running = NO;
+    
+    return success;
+}
+
+- ( SKTaskStatus * )snapshot
+{
+    return [ self.taskGroup snapshot ];
+}
+
+#pragma mark - Private
+
+- ( BOOL )loadFile: ( NSString * )path cachePath: ( nullable NSString * )cachePath
+{
+    FILE            * fp;
+    struct stat       info;
+    NSDictionary    * source;
+    SKTaskGraphNode * root;
+    
+    fp = fopen( path.fileSystemRepresentation, "r" );
+    
+    if( fp == NULL || fstat( fileno( fp ), &info ) != 0 )
+    {
+        self.error = [ self errorWithDescription: @"Cannot read task graph %@: %s", path, strerror( errno ) ];
+        
+        if( fp != NULL )
+        {
+            fclose( fp );
+        }
+        
+        return NO;
+    }
+    
+    source = SKTaskGraphSourceKey( &info );
+    
+    if( cachePath != nil && [ self loadCache: ( NSString * )cachePath source: source ] )
+    {
+        fclose( fp );
+        
+        return YES;
+    }
+    
+    root = [ self parseFile: fp ];
+    
+    fclose( fp );
+    
+    if( root == nil )
+    {
+        return NO;
+    }
+    
+    self.taskGroup = ( SKTaskGroup * )[ self objectWithNode: ( SKTaskGraphNode * )root ];
+    
+    if( cachePath != nil )
+    {
+        [ self saveCache: ( NSString * )cachePath source: source root: ( SKTaskGraphNode * )root ];
+    }
+    
+    return YES;
+}
+
+- ( BOOL )loadCache: ( NSString * )path source: ( NSDictionary * )source
+{
+    NSData       * data;
+    NSDictionary * cache;
+    
+    data  = [ NSData dataWithContentsOfFile: path ];
+    cache = ( data ) ? [ NSPropertyListSerialization propertyListWithData: ( NSData * )data options: NSPropertyListImmutable format: NULL error: NULL ] : nil;
+    
+    if( [ cache isKindOfClass: [ NSDictionary class ] ] == NO || [ cache[ @"version" ] isEqual: @SK_TASK_GRAPH_CACHE_VERSION ] == NO || [ cache[ @"source" ] isEqual: source ] == NO )
+    {
+        return NO;
+    }
+    
+    /* Damaged caches are ignored, and the file is parsed again */
+    if( [ cache[ @"variables" ] isKindOfClass: [ NSDictionary class ] ] == NO || [ self isArray: cache[ @"required" ] ofClass: [ NSString class ] ] == NO || [ self isValidNode: cache[ @"root" ] ] == NO )
+    {
+        return NO;
+    }
+    
+    if( [ self isArray: [ cache[ @"variables" ] allKeys ] ofClass: [ NSString class ] ] == NO || [ self isArray: [ cache[ @"variables" ] allValues ] ofClass: [ NSString class ] ] == NO )
+    {
+        return NO;
+    }
+    
+    self.variables         = cache[ @"variables" ];
+    self.requiredVariables = cache[ @"required" ];
+    self.taskGroup         = ( SKTaskGroup * )[ self objectWithNode: cache[ @"root" ] ];
+    self.loadedFromCache   = YES;
+    
+    return YES;
+}
+
+- ( void )saveCache: ( NSString * )path source: ( NSDictionary * )source root: ( SKTaskGraphNode * )root
+{
+    NSData * data;
+    
+    data = [ NSPropertyListSerialization dataWithPropertyList: @{ @"version" : @SK_TASK_GRAPH_CACHE_VERSION, @"source" : source, @"variables" : self.variables, @"required" : self.requiredVariables, @"root" : root } format: NSPropertyListBinaryFormat_v1_0 options: 0 error: NULL ];
+    
+    /* The cache is only an optimization - The graph is usable without it */
+    [ data writeToFile: path options: NSDataWritingAtomic error: NULL ];
+}
+
+- ( nullable SKTaskGraphNode * )parseFile: ( FILE * )fp
+{
+    NSMutableArray< SKTaskGraphNode * > * stack;
+    SKTaskGraphNode                     * root;
+    SKTaskGraphNode                     * node;
+    SKTaskGraphNode                     * last;
+    SKTaskGraphNode                     * task;
+    NSMutableString                     * continued;
+    NSCharacterSet                      * whitespace;
+    NSString                            * line;
+    NSString                            * keyword;
+    NSString                            * value;
+    NSRange                               range;
+    NSUInteger                            number;
+    NSUInteger                            start;
+    char                                * buffer;
+    size_t                                capacity;
+    ssize_t                               length;
+    
+    root       = [ @{ @"type" : @"group", @"name" : self.path.lastPathComponent.stringByDeletingPathExtension, @"tasks" : [ NSMutableArray new ], @"line" : @0 } mutableCopy ];
+    stack      = [ NSMutableArray arrayWithObject: root ];
+    whitespace = [ NSCharacterSet whitespaceCharacterSet ];
+    last       = nil;
+    task       = nil;
+    continued  = nil;
+    number     = 0;
+    start      = 0;
+    buffer     = NULL;
+    capacity   = 0;
+    self.error = nil;
+    
+    /* Declarations are added as they are parsed, so scripts may only use variables declared before them */
+    self.variables         = [ NSMutableDictionary new ];
+    self.requiredVariables = [ NSMutableArray new ];
+    
+    while( self.error == nil && ( length = getline( &buffer, &capacity, fp ) ) != -1 )
+    {
+        number++;
+        
+        while( length > 0 && ( buffer[ length - 1 ] == '\n' || buffer[ length - 1 ] == '\r' ) )
+        {
+            length--;
+        }
+        
+        line = [ [ NSString alloc ] initWithBytes: buffer length: ( NSUInteger )length encoding: NSUTF8StringEncoding ];
+        
+        if( line == nil )
+        {
+            self.error = [ self errorWithDescription: @"Invalid UTF-8 text at line %lu of %@", ( unsigned long )number, self.path ];
+            
+            break;
+        }
+        
+        if( continued == nil )
+        {
+            start = number;
+        }
+        
+        if( [ line hasSuffix: @"\\" ] )
+        {
+            continued = ( continued ) ? continued : [ NSMutableString new ];
+            
+            [ continued appendFormat: @"%@\n", line ];
+            
+            continue;
+        }
+        
+        if( continued != nil )
+        {
+            [ continued appendString: line ];
+            
+            line      = [ continued copy ];
+            continued = nil;
+        }
+        
+        line = [ line stringByTrimmingCharactersInSet: whitespace ];
+        
+        if( line.length == 0 || [ line hasPrefix: @"#" ] )
+        {
+            continue;
+        }
+        
+        range   = [ line rangeOfCharacterFromSet: whitespace ];
+        keyword = ( range.location == NSNotFound ) ? line : [ line substringToIndex: range.location ];
+        value   = ( range.location == NSNotFound ) ? @"" : [ [ line substringFromIndex: range.location ] stringByTrimmingCharactersInSet: whitespace ];
+        
+        if( [ keyword isEqualToString: @"var" ] )
+        {
+            last = nil;
+            task = nil;
+            
+            [ self parseVariable: value line: start ];
+        }
+        else if( [ keyword isEqualToString: @"task" ] || [ keyword isEqualToString: @"optional" ] || [ keyword isEqualToString: @"recover" ] )
+        {
+            if( [ self validateScript: value line: start ] == NO )
+            {
+                break;
+            }
+            
+            node = [ @{ @"type" : ( [ keyword isEqualToString: @"optional" ] ) ? @"optional" : @"task", @"script" : value, @"recover" : [ NSMutableArray new ], @"line" : @( start ) } mutableCopy ];
+            
+            if( [ keyword isEqualToString: @"recover" ] )
+            {
+                if( task == nil )
+                {
+                    self.error = [ self errorWithDescription: @"Recovery task without a task at line %lu of %@", ( unsigned long )start, self.path ];
+                    
+                    break;
+                }
+                
+                node[ @"recovery" ] = @YES;
+                
+                [ task[ @"recover" ] addObject: node ];
+            }
+            else
+            {
+                task = node;
+                
+                [ stack.lastObject[ @"tasks" ] addObject: node ];
+            }
+            
+            last = node;
+        }
+        else if( [ keyword isEqualToString: @"group" ] )
+        {
+            if( value.length == 0 )
+            {
+                self.error = [ self errorWithDescription: @"Missing group name at line %lu of %@", ( unsigned long )start, self.path ];
+                
+                break;
+            }
+            
+            node = [ @{ @"type" : @"group", @"name" : value, @"tasks" : [ NSMutableArray new ], @"line" : @( start ) } mutableCopy ];
+            last = node;
+            task = nil;
+            
+            [ stack.lastObject[ @"tasks" ] addObject: node ];
+            [ stack addObject: node ];
+        }
+        else if( [ keyword isEqualToString: @"end" ] || [ keyword isEqualToString: @"barrier" ] )
+        {
+            if( value.length > 0 )
+            {
+                self.error = [ self errorWithDescription: @"Unexpected text after %@ at line %lu of %@", keyword, ( unsigned long )start, self.path ];
+                
+                break;
+            }
+            
+            task = nil;
+            
+            if( [ keyword isEqualToString: @"barrier" ] )
+            {
+                last = [ @{ @"type" : @"barrier", @"line" : @( start ) } mutableCopy ];
+                
+                [ stack.lastObject[ @"tasks" ] addObject: last ];
+            }
+            else if( stack.count == 1 )
+            {
+                self.error = [ self errorWithDescription: @"Unexpected end at line %lu of %@", ( unsigned long )start, self.path ];
+            }
+            else if( [ self resolveDependenciesOfGroup: stack.lastObject ] )
+            {
+                last = stack.lastObject;
+                
+                [ stack removeLastObject ];
+            }
+        }
+        else
+        {
+            [ self parseOption: keyword value: value node: last line: start ];
+        }
+    }
+    
+    free( buffer );
+    
+    if( self.error == nil && ferror( fp ) )
+    {
+        self.error = [ self errorWithDescription: @"Cannot read task graph %@", self.path ];
+    }
+    else if( self.error == nil && stack.count > 1 )
+    {
+        self.error = [ self errorWithDescription: @"Missing end for group %@ at line %lu of %@", stack.lastObject[ @"name" ], [ stack.lastObject[ @"line" ] unsignedLongValue ], self.path ];
+    }
+    
+    if( self.error != nil || [ self resolveDependenciesOfGroup: root ] == NO )
+    {
+        return nil;
+    }
+    
+    self.variables         = [ self.variables copy ];
+    self.requiredVariables = [ self.requiredVariables copy ];
+    
+    return root;
+}
+
+- ( BOOL )parseVariable: ( NSString * )declaration line: ( NSUInteger )line
+{
+    NSMutableDictionary< NSString *, NSString * > * variables;
+    NSMutableArray< NSString * >                  * required;
+    NSCharacterSet                                * invalid;
+    NSString                                      * name;
+    NSRange                                         range;
+    
+    variables = ( NSMutableDictionary * )( self.variables );
+    required  = ( NSMutableArray * )( self.requiredVariables );
+    invalid   = [ NSCharacterSet characterSetWithCharactersInString: @"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789" ].invertedSet;
+    range     = [ declaration rangeOfString: @"=" ];
+    name      = ( range.location == NSNotFound ) ? declaration : [ [ declaration substringToIndex: range.location ] stringByTrimmingCharactersInSet: [ NSCharacterSet whitespaceCharacterSet ] ];
+    
+    /* Names follow the syntax of %{name}% references */
+    if( name.length == 0 || [ name rangeOfCharacterFromSet: invalid ].location != NSNotFound )
+    {
+        self.error = [ self errorWithDescription: @"Invalid variable name '%@' at line %lu of %@", name, ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    if( variables[ name ] != nil || [ required containsObject: name ] )
+    {
+        self.error = [ self errorWithDescription: @"Variable %@ is already declared at line %lu of %@", name, ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    if( range.location == NSNotFound )
+    {
+        [ required addObject: name ];
+    }
+    else
+    {
+        variables[ name ] = [ [ declaration substringFromIndex: NSMaxRange( range ) ] stringByTrimmingCharactersInSet: [ NSCharacterSet whitespaceCharacterSet ] ];
+    }
+    
+    return YES;
+}
+
+- ( BOOL )parseOption: ( NSString * )option value: ( NSString * )value node: ( nullable SKTaskGraphNode * )node line: ( NSUInteger )line
+{
+    NSScanner                    * scanner;
+    NSString                     * type;
+    NSString                     * word;
+    NSArray< NSString * >        * options;
+    NSMutableArray< NSString * > * words;
+    NSInteger                      integer;
+    double                         number;
+    BOOL                           valid;
+    
+    type    = node[ @"type" ];
+    scanner = [ NSScanner scannerWithString: value ];
+    words   = [ NSMutableArray new ];
+    integer = 0;
+    number  = 0;
+    
+    for( word in [ value componentsSeparatedByCharactersInSet: [ NSCharacterSet whitespaceCharacterSet ] ] )
+    {
+        if( word.length > 0 )
+        {
+            [ words addObject: word ];
+        }
+    }
+    
+    if( [ @[ @"id", @"after", @"weight", @"inputs", @"policy", @"ready-pattern", @"ready-path", @"ready-timeout", @"nice", @"detached", @"join-timeout", @"parallel", @"batch", @"cpus" ] containsObject: option ] == NO )
+    {
+        self.error = [ self errorWithDescription: @"Unknown keyword %@ at line %lu of %@", option, ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    if( node == nil )
+    {
+        self.error = [ self errorWithDescription: @"Option %@ without a task or group at line %lu of %@", option, ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    if( [ type isEqualToString: @"group" ] )
+    {
+        options = @[ @"id", @"after", @"parallel", @"batch", @"cpus" ];
+    }
+    else if( [ node[ @"recovery" ] boolValue ] )
+    {
+        options = @[ @"weight", @"inputs", @"ready-timeout", @"nice" ];
+    }
+    else if( [ type isEqualToString: @"optional" ] )
+    {
+        options = @[ @"id", @"after", @"weight", @"inputs", @"policy", @"ready-pattern", @"ready-path", @"ready-timeout", @"nice", @"detached", @"join-timeout" ];
+    }
+    else if( [ type isEqualToString: @"task" ] )
+    {
+        options = @[ @"id", @"after", @"weight", @"inputs", @"policy", @"ready-pattern", @"ready-path", @"ready-timeout", @"nice" ];
+    }
+    else
+    {
+        options = @[];
+    }
+    
+    if( [ options containsObject: option ] == NO )
+    {
+        self.error = [ self errorWithDescription: @"Option %@ cannot be used here, at line %lu of %@", option, ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    if( [ @[ @"detached", @"parallel", @"batch", @"cpus" ] containsObject: option ] )
+    {
+        valid          = value.length == 0;
+        node[ option ] = @YES;
+    }
+    else if( [ option isEqualToString: @"id" ] )
+    {
+        valid          = words.count == 1;
+        node[ option ] = value;
+    }
+    else if( [ option isEqualToString: @"after" ] || [ option isEqualToString: @"inputs" ] )
+    {
+        valid = words.count > 0;
+        
+        if( node[ option ] != nil )
+        {
+            [ words insertObjects: node[ option ] atIndexes: [ NSIndexSet indexSetWithIndexesInRange: NSMakeRange( 0, [ node[ option ] count ] ) ] ];
+        }
+        
+        node[ option ] = [ words copy ];
+    }
+    else if( [ option isEqualToString: @"weight" ] || [ option isEqualToString: @"nice" ] )
+    {
+        valid          = [ scanner scanInteger: &integer ] && scanner.isAtEnd && ( integer >= 0 || [ option isEqualToString: @"nice" ] );
+        node[ option ] = @( integer );
+    }
+    else if( [ option isEqualToString: @"ready-timeout" ] || [ option isEqualToString: @"join-timeout" ] )
+    {
+        valid          = [ scanner scanDouble: &number ] && scanner.isAtEnd && number >= 0;
+        node[ option ] = @( number );
+    }
+    else if( [ option isEqualToString: @"policy" ] )
+    {
+        valid          = [ @[ @"sequential", @"race", @"hedge" ] containsObject: value ];
+        node[ option ] = @( ( NSInteger )[ @[ @"sequential", @"race", @"hedge" ] indexOfObject: value ] );
+    }
+    else if( [ option isEqualToString: @"ready-pattern" ] )
+    {
+        valid          = value.length > 0 && [ NSRegularExpression regularExpressionWithPattern: value options: ( NSRegularExpressionOptions )0 error: NULL ] != nil;
+        node[ option ] = value;
+    }
+    else
+    {
+        valid          = value.length > 0;
+        node[ option ] = value;
+    }
+    
+    if( valid == NO )
+    {
+        self.error = [ self errorWithDescription: @"Invalid value for %@ at line %lu of %@", option, ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    return YES;
+}
+
+- ( BOOL )validateScript: ( NSString * )script line: ( NSUInteger )line
+{
+    NSTextCheckingResult * match;
+    NSString             * name;
+    
+    if( script.length == 0 )
+    {
+        self.error = [ self errorWithDescription: @"Missing script at line %lu of %@", ( unsigned long )line, self.path ];
+        
+        return NO;
+    }
+    
+    if( [ script rangeOfString: @"%{" ].location == NSNotFound )
+    {
+        return YES;
+    }
+    
+    for( match in [ [ SKTask variableExpression ] matchesInString: script options: ( NSMatchingOptions )0 range: NSMakeRange( 0, script.length ) ] )
+    {
+        name = [ script substringWithRange: [ match rangeAtIndex: 1 ] ];
+        
+        if( self.variables[ name ] == nil && [ self.requiredVariables containsObject: name ] == NO )
+        {
+            self.error = [ self errorWithDescription: @"Undeclared variable %@ at line %lu of %@", name, ( unsigned long )line, self.path ];
+            
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+- ( BOOL )resolveDependenciesOfGroup: ( SKTaskGraphNode * )group
+{
+    NSMutableArray< SKTaskGraphNode * >                     * tasks;
+    NSMutableArray< SKTaskGraphNode * >                     * ordered;
+    NSMutableArray< NSMutableArray< SKTaskGraphNode * > * > * stages;
+    NSMutableArray< NSMutableIndexSet * >                   * dependents;
+    NSMutableDictionary< NSString *, NSNumber * >           * identifiers;
+    NSMutableIndexSet                                       * dependencies;
+    NSMutableIndexSet                                       * ready;
+    SKTaskGraphNode                                         * stage;
+    NSString                                                * name;
+    NSUInteger                                              * missing;
+    NSUInteger                                              * levels;
+    NSUInteger                                                count;
+    NSUInteger                                                i;
+    NSUInteger                                                j;
+    
+    tasks       = group[ @"tasks" ];
+    count       = tasks.count;
+    identifiers = [ NSMutableDictionary new ];
+    dependents  = nil;
+    
+    for( i = 0; i < count; i++ )
+    {
+        name = tasks[ i ][ @"id" ];
+        
+        if( name != nil && identifiers[ name ] != nil )
+        {
+            self.error = [ self errorWithDescription: @"Duplicate identifier %@ at line %lu of %@", name, [ tasks[ i ][ @"line" ] unsignedLongValue ], self.path ];
+            
+            return NO;
+        }
+        
+        if( name != nil )
+        {
+            identifiers[ name ] = @( i );
+        }
+        
+        if( tasks[ i ][ @"after" ] != nil && dependents == nil )
+        {
+            dependents = [ NSMutableArray new ];
+        }
+    }
+    
+    if( dependents == nil )
+    {
+        return YES;
+    }
+    
+    /* Tasks are reordered by their dependencies, so a barrier would no longer separate the tasks around it */
+    for( i = 0; i < count; i++ )
+    {
+        if( [ tasks[ i ][ @"type" ] isEqualToString: @"barrier" ] )
+        {
+            self.error = [ self errorWithDescription: @"Barrier at line %lu of %@ cannot be used in a group with dependencies - Use after instead", [ tasks[ i ][ @"line" ] unsignedLongValue ], self.path ];
+            
+            return NO;
+        }
+    }
+    
+    missing = calloc( count, sizeof( NSUInteger ) );
+    levels  = calloc( count, sizeof( NSUInteger ) );
+    ready   = [ NSMutableIndexSet new ];
+    
+    if( missing == NULL || levels == NULL )
+    {
+        free( missing );
+        free( levels );
+        
+        self.error = [ self errorWithDescription: @"Cannot allocate memory for task graph %@", self.path ];
+        
+        return NO;
+    }
+    
+    for( i = 0; i < count; i++ )
+    {
+        [ dependents addObject: [ NSMutableIndexSet new ] ];
+    }
+    
+    for( i = 0; i < count && self.error == nil; i++ )
+    {
+        dependencies = [ NSMutableIndexSet new ];
+        
+        for( name in tasks[ i ][ @"after" ] )
+        {
+            if( identifiers[ name ] == nil )
+            {
+                self.error = [ self errorWithDescription: @"Unknown dependency %@ at line %lu of %@ - Dependencies must be in the same group", name, [ tasks[ i ][ @"line" ] unsignedLongValue ], self.path ];
+                
+                break;
+            }
+            
+            [ dependencies addIndex: identifiers[ name ].unsignedIntegerValue ];
+        }
+        
+        for( j = dependencies.firstIndex; j != NSNotFound; j = [ dependencies indexGreaterThanIndex: j ] )
+        {
+            [ dependents[ j ] addIndex: i ];
+        }
+        
+        missing[ i ] = dependencies.count;
+        
+        if( missing[ i ] == 0 )
+        {
+            [ ready addIndex: i ];
+        }
+    }
+    
+    ordered = [ NSMutableArray new ];
+    stages  = [ NSMutableArray new ];
+    
+    /* Ready tasks are placed in the order of the file, after all their dependencies */
+    while( self.error == nil && ready.count > 0 )
+    {
+        i = ready.firstIndex;
+        
+        [ ready removeIndex: i ];
+        [ ordered addObject: tasks[ i ] ];
+        
+        if( levels[ i ] == stages.count )
+        {
+            [ stages addObject: [ NSMutableArray new ] ];
+        }
+        
+        [ stages[ levels[ i ] ] addObject: tasks[ i ] ];
+        
+        for( j = dependents[ i ].firstIndex; j != NSNotFound; j = [ dependents[ i ] indexGreaterThanIndex: j ] )
+        {
+            levels[ j ] = MAX( levels[ j ], levels[ i ] + 1 );
+            
+            if( --missing[ j ] == 0 )
+            {
+                [ ready addIndex: j ];
+            }
+        }
+    }
+    
+    free( missing );
+    free( levels );
+    
+    if( self.error != nil )
+    {
+        return NO;
+    }
+    
+    if( ordered.count < count )
+    {
+        self.error = [ self errorWithDescription: @"Circular dependencies in group %@ at line %lu of %@", group[ @"name" ], [ group[ @"line" ] unsignedLongValue ], self.path ];
+        
+        return NO;
+    }
+    
+    if( [ group[ @"parallel" ] boolValue ] == NO || stages.count == 1 )
+    {
+        group[ @"tasks" ] = ordered;
+        
+        return YES;
+    }
+    
+    /* Parallel groups are run in stages, each one waiting for the previous ones */
+    group[ @"tasks" ] = [ NSMutableArray new ];
+    
+    for( i = 0; i < stages.count; i++ )
+    {
+        stage = [ @{ @"type" : @"group", @"name" : [ NSString stringWithFormat: @"%@ (stage %lu)", group[ @"name" ], ( unsigned long )( i + 1 ) ], @"tasks" : stages[ i ], @"line" : group[ @"line" ], @"parallel" : @YES } mutableCopy ];
+        
+        if( group[ @"cpus" ] != nil )
+        {
+            stage[ @"cpus" ] = group[ @"cpus" ];
+        }
+        
+        [ group[ @"tasks" ] addObject: stage ];
+    }
+    
+    [ group removeObjectForKey: @"parallel" ];
+    [ group removeObjectForKey: @"cpus" ];
+    
+    return YES;
+}
+
+- ( BOOL )isValidNode: ( id )node
+{
+    NSString * type;
+    Class      cls;
+    id         key;
+    id         child;
+    
+    if( [ node isKindOfClass: [ NSDictionary class ] ] == NO || [ node[ @"type" ] isKindOfClass: [ NSString class ] ] == NO )
+    {
+        return NO;
+    }
+    
+    /* Only keys written by the parser are allowed, with the type it uses */
+    for( key in node )
+    {
+        if( [ @[ @"type", @"name", @"script", @"id", @"ready-pattern", @"ready-path" ] containsObject: key ] )
+        {
+            cls = [ NSString class ];
+        }
+        else if( [ @[ @"tasks", @"recover", @"after", @"inputs" ] containsObject: key ] )
+        {
+            cls = [ NSArray class ];
+        }
+        else if( [ @[ @"line", @"parallel", @"batch", @"cpus", @"detached", @"weight", @"nice", @"policy", @"ready-timeout", @"join-timeout" ] containsObject: key ] )
+        {
+            cls = [ NSNumber class ];
+        }
+        else
+        {
+            return NO;
+        }
+        
+        if( [ node[ key ] isKindOfClass: cls ] == NO )
+        {
+            return NO;
+        }
+    }
+    
+    if( ( node[ @"inputs" ] != nil && [ self isArray: node[ @"inputs" ] ofClass: [ NSString class ] ] == NO ) || ( node[ @"after" ] != nil && [ self isArray: node[ @"after" ] ofClass: [ NSString class ] ] == NO ) )
+    {
+        return NO;
+    }
+    
+    type = node[ @"type" ];
+    
+    if( [ type isEqualToString: @"barrier" ] )
+    {
+        return YES;
+    }
+    
+    if( [ type isEqualToString: @"group" ] )
+    {
+        if( node[ @"name" ] == nil || node[ @"tasks" ] == nil )
+        {
+            return NO;
+        }
+        
+        for( child in node[ @"tasks" ] )
+        {
+            if( [ self isValidNode: child ] == NO )
+            {
+                return NO;
+            }
+        }
+        
+        return YES;
+    }
+    
+    if( ( [ type isEqualToString: @"task" ] == NO && [ type isEqualToString: @"optional" ] == NO ) || node[ @"script" ] == nil )
+    {
+        return NO;
+    }
+    
+    for( child in node[ @"recover" ] )
+    {
+        if( [ self isValidNode: child ] == NO || [ child[ @"type" ] isEqualToString: @"task" ] == NO )
+        {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+- ( BOOL )isArray: ( id )array ofClass: ( Class )cls
+{
+    id object;
+    
+    if( [ array isKindOfClass: [ NSArray class ] ] == NO )
+    {
+        return NO;
+    }
+    
+    for( object in array )
+    {
+        if( [ object isKindOfClass: cls ] == NO )
+        {
+            return NO;
+        }
+    }
+    
+    return YES;
+}
+
+- ( id< SKRunableObject > )objectWithNode: ( NSDictionary< NSString *, id > * )node
+{
+    NSMutableArray< id< SKRunableObject > > * tasks;
+    NSMutableArray< SKTask * >              * recover;
+    NSDictionary< NSString *, id >          * child;
+    SKTaskGroup                             * group;
+    SKTask                                  * task;
+    SKProcessAttributes                     * attributes;
+    
+    if( [ node[ @"type" ] isEqualToString: @"barrier" ] )
+    {
+        return [ SKTaskBarrier barrier ];
+    }
+    
+    if( [ node[ @"type" ] isEqualToString: @"group" ] )
+    {
+        tasks = [ NSMutableArray new ];
+        
+        for( child in node[ @"tasks" ] )
+        {
+            [ tasks addObject: [ self objectWithNode: child ] ];
+        }
+        
+        group              = [ SKTaskGroup taskGroupWithName: node[ @"name" ] tasks: tasks ];
+        group.batchesTasks = [ node[ @"batch" ] boolValue ];
+        group.assignsCPUs  = [ node[ @"cpus" ] boolValue ];
+        
+        if( [ node[ @"parallel" ] boolValue ] )
+        {
+            group.concurrencyLimiter = [ SKConcurrencyLimiter sharedLimiter ];
+        }
+        
+        return group;
+    }
+    
+    recover = [ NSMutableArray new ];
+    
+    for( child in node[ @"recover" ] )
+    {
+        [ recover addObject: ( SKTask * )[ self objectWithNode: child ] ];
+    }
+    
+    if( [ node[ @"type" ] isEqualToString: @"optional" ] )
+    {
+        task = [ SKOptionalTask taskWithShellScript: node[ @"script" ] recoverTasks: ( recover.count ) ? recover : nil ];
+        
+        ( ( SKOptionalTask * )task ).detached = [ node[ @"detached" ] boolValue ];
+        
+        if( node[ @"join-timeout" ] != nil )
+        {
+            ( ( SKOptionalTask * )task ).joinTimeout = [ node[ @"join-timeout" ] doubleValue ];
+        }
+    }
+    else
+    {
+        task = [ SKTask taskWithShellScript: node[ @"script" ] recoverTasks: ( recover.count ) ? recover : nil ];
+    }
+    
+    task.inputs       = node[ @"inputs" ];
+    task.readyPattern = node[ @"ready-pattern" ];
+    task.readyPath    = node[ @"ready-path" ];
+    
+    if( node[ @"weight" ] != nil )
+    {
+        task.weight = [ node[ @"weight" ] unsignedIntegerValue ];
+    }
+    
+    if( node[ @"policy" ] != nil )
+    {
+        task.recoveryPolicy = ( SKTaskRecoveryPolicy )[ node[ @"policy" ] integerValue ];
+    }
+    
+    if( node[ @"ready-timeout" ] != nil )
+    {
+        task.readyTimeout = [ node[ @"ready-timeout" ] doubleValue ];
+    }
+    
+    if( node[ @"nice" ] != nil )
+    {
+        attributes             = [ SKProcessAttributes new ];
+        attributes.niceValue   = node[ @"nice" ];
+        task.processAttributes = attributes;
+    }
+    
+    return task;
+}
+
+@end
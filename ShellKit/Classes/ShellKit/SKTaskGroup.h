@@ -30,12 +30,21 @@
 #import <Foundation/Foundation.h>
 #import <ShellKit/SKObject.h>
 #import <ShellKit/SKRunableObject.h>
+#import <ShellKit/SKConcurrencyLimiter.h>
 
 NS_ASSUME_NONNULL_BEGIN
 
 /*!
  * @class       SKTaskGroup
  * @abstract    Represents a group of tasks that may be run
+ * @discussion  When run with `runAsynchronously:`, each task is started by
+ *              the completion of the previous one, or admitted by the
+ *              concurrency limiter for parallel groups, so no thread waits
+ *              for the tasks. As asynchronous groups may run concurrently,
+ *              their name is only added to the prompt of their own messages
+ *              and tasks, and not to the shell's prompt parts.
+ *              Groups batching tasks, assigning CPUs, or being watched are
+ *              run on a background thread.
  * @see         SKRunableObject
  */
 @interface SKTaskGroup: SKObject < SKRunableObject >
@@ -62,6 +71,74 @@ NS_ASSUME_NONNULL_BEGIN
  */
 @property( atomic, readonly, nullable ) id< SKRunableObject > currentTask;
 
+/*!
+ * @property    batchesTasks
+ * @abstract    Enables/Disables batching of adjacent tasks
+ * @discussion  Disabled by default. When enabled, adjacent `SKTask` objects
+ *              are run in a single shell invocation, instead of spawning a
+ *              login shell for each task.
+ *              Exit statuses, output, recovery tasks and delegate callbacks
+ *              are preserved for each task. Tasks with unsubstituted
+ *              variables, or subclasses of `SKTask`, are never batched.
+ * @see         SKTask
+ */
+@property( atomic, readwrite, assign ) BOOL batchesTasks;
+
+/*!
+ * @property    concurrencyLimiter
+ * @abstract    Runs the tasks of the group in parallel, when set
+ * @discussion  Nil by default, meaning tasks are run one after the other.
+ *              When set, tasks are started in order, as soon as the limiter
+ *              has enough slots for their weight, so the number of running
+ *              tasks follows the load of the host. Tasks must then not
+ *              depend on each other.
+ *              Messages and output of each task are buffered, and printed
+ *              when the task ends. If a task fails, no other task is
+ *              started, and the group fails once the running tasks have
+ *              ended.
+ *              Only tasks hold slots. Nested task groups and other
+ *              runnable objects don't, so nested parallel groups may share
+ *              the same limiter without deadlocking. Tasks of nested
+ *              sequential groups are not counted.
+ *              Tasks are never batched in parallel mode.
+ * @see         SKConcurrencyLimiter
+ * @see         SKTask
+ */
+@property( atomic, readwrite, strong, nullable ) SKConcurrencyLimiter * concurrencyLimiter;
+
+/*!
+ * @property    assignsCPUs
+ * @abstract    Pins parallel tasks to disjoint sets of CPUs
+ * @discussion  Disabled by default, and only used in parallel mode.
+ *              Each `SKTask` that is started gets as many CPUs as its
+ *              weight, among those not used by the other running tasks of
+ *              the group. CPUs explicitly set in the process attributes of
+ *              a task of the group are never assigned to other tasks, so
+ *              tasks can be kept apart from heavy ones. Tasks with an
+ *              explicit CPU affinity keep it, and tasks are left unpinned
+ *              if not enough CPUs are free.
+ *              CPU affinity is only supported on Linux.
+ * @see         concurrencyLimiter
+ * @see         SKProcessAttributes
+ */
+@property( atomic, readwrite, assign ) BOOL assignsCPUs;
+
+/*!
+ * @property    cancelled
+ * @abstract    Set if the current or last run of the task group was cancelled
+ * @see         cancel
+ */
+@property( atomic, readonly, getter = isCancelled ) BOOL cancelled;
+
+/*!
+ * @property    watchLatency
+ * @abstract    The time to wait for file changes to settle, in watch mode
+ * @discussion  Defaults to 0.2 seconds. Changes occuring within this delay
+ *              are coalesced, and trigger a single run.
+ * @see         watch:
+ */
+@property( atomic, readwrite, assign ) NSTimeInterval watchLatency;
+
 /*!
  * @method      taskGroupWithName:tasks:
  * @abstract    Creates a task group object
@@ -82,6 +159,46 @@ NS_ASSUME_NONNULL_BEGIN
  */
 - ( instancetype )initWithName: ( NSString * )name tasks: ( NSArray< id< SKRunableObject > > * )tasks NS_DESIGNATED_INITIALIZER;
 
+/*!
+ * @method      cancel
+ * @abstract    Cancels the task group, if it is running
+ * @discussion  The current task is cancelled, and the remaining tasks are
+ *              not run. The task group then fails.
+ *              This method may be called from any thread.
+ */
+- ( void )cancel;
+
+/*!
+ * @method      watch:
+ * @abstract    Runs the task group, and reruns tasks as their inputs change
+ * @discussion  The files matching the inputs of the tasks are watched (with
+ *              inotify on Linux). When some of them change, the group is
+ *              run again from the first task consuming them, as the next
+ *              tasks may depend on its outputs. Previous tasks, which are
+ *              still up to date, are not run.
+ *              If changes affect a task that has already started while the
+ *              group is running, the run is cancelled, and restarted from
+ *              the affected task.
+ *              Inputs of task groups are the inputs of their tasks.
+ *              Note that a task shouldn't write files matching its own
+ *              inputs, as it would be run again endlessly.
+ *              This method blocks until `stopWatching` is called.
+ * @param       variables   Optional variables, used for each run
+ * @result      NO if no task declares inputs, or if the files can't be
+ *              watched, otherwise YES once watching has stopped
+ * @see         SKTask
+ * @see         stopWatching
+ */
+- ( BOOL )watch: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+
+/*!
+ * @method      stopWatching
+ * @abstract    Stops watching files, and cancels the current run, if any
+ * @discussion  This method may be called from any thread.
+ * @see         watch:
+ */
+- ( void )stopWatching;
+
 @end
 
 NS_ASSUME_NONNULL_END
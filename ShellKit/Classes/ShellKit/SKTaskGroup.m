@@ -28,16 +28,59 @@
  */
 
 #import <ShellKit/ShellKit.h>
+#import "SKTask+Private.h"
+#import "SKFuture+Private.h"
+#import "SKTaskStatus+Private.h"
+#import "SKEventStream+Private.h"
+#import "SKTaskBarrier+Private.h"
+#import "SKTaskBatch.h"
+#import "SKFileWatcher.h"
 
 NS_ASSUME_NONNULL_BEGIN
 
+/*!
+ * Called when an asynchronous run of a group has ended, with the number of
+ * tasks that were run, and the first task that failed, if any.
+ */
+typedef void ( ^ SKTaskGroupCompletion )( NSUInteger count, id< SKRunableObject > _Nullable failed );
+
 @interface SKTaskGroup()
 
 @property( atomic, readwrite, assign           ) BOOL                               running;
+@property( atomic, readwrite, assign           ) BOOL                               cancelled;
 @property( atomic, readwrite, strong, nullable ) NSError                          * error;
 @property( atomic, readwrite, strong           ) NSString                         * name;
 @property( atomic, readwrite, strong           ) NSArray< id< SKRunableObject > > * tasks;
 @property( atomic, readwrite, strong, nullable ) id< SKRunableObject >              currentTask;
+@property( atomic, readwrite, strong, nullable ) SKTaskBatch                      * currentBatch;
+@property( atomic, readwrite, assign           ) NSUInteger                         currentIndex;
+@property( atomic, readwrite, assign           ) BOOL                               watching;
+@property( atomic, readwrite, strong, nullable ) NSMutableIndexSet                * watchSchedule;
+@property( atomic, readwrite, strong           ) NSMutableSet< NSString * >       * changedPaths;
+@property( atomic, readwrite, strong, nullable ) dispatch_semaphore_t               changes;
+@property( atomic, readwrite, strong, nullable ) NSArray< NSString * >            * promptLabels;
+@property( atomic, readwrite, strong           ) SKTaskStatusRecord               * statusRecord;
+@property( atomic, readwrite, assign           ) uint64_t                           eventIdentifier;
+@property( atomic, readwrite, strong           ) NSMutableArray                   * parallelTasks;
+
++ ( NSArray< NSString * > * )inputsOfTask: ( id< SKRunableObject > )task;
+
+- ( BOOL )runTasksAtIndexes: ( NSMutableIndexSet * )schedule variables: ( nullable NSDictionary< NSString *, NSString * > * )variables;
+- ( nullable id< SKRunableObject > )runTasksInParallelAtIndexes: ( NSMutableIndexSet * )schedule variables: ( nullable NSDictionary< NSString *, NSString * > * )variables services: ( NSMutableArray< SKTask * > * )services detached: ( NSMutableArray< SKOptionalTask * > * )detached count: ( NSUInteger * )count;
+- ( BOOL )runBatch: ( SKTaskBatch * )batch fromIndex: ( NSUInteger )index;
+- ( void )runTaskAtIndex: ( NSUInteger )index variables: ( nullable NSDictionary< NSString *, NSString * > * )variables buffer: ( nullable NSMutableString * )buffer services: ( NSMutableArray< SKTask * > * )services detached: ( NSMutableArray< SKOptionalTask * > * )detached completion: ( SKTaskGroupCompletion )completion;
+- ( void )runTasksInParallelWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables services: ( NSMutableArray< SKTask * > * )services detached: ( NSMutableArray< SKOptionalTask * > * )detached completion: ( SKTaskGroupCompletion )completion;
+- ( BOOL )failWithError: ( nullable NSError * )error services: ( NSArray< SKTask * > * )services detached: ( NSArray< SKOptionalTask * > * )detached;
+- ( void )endWithError: ( nullable NSError * )error services: ( NSArray< SKTask * > * )services detached: ( NSArray< SKOptionalTask * > * )detached;
+- ( void )endWithCount: ( NSUInteger )count startDate: ( NSDate * )date services: ( NSArray< SKTask * > * )services detached: ( NSArray< SKOptionalTask * > * )detached;
+- ( NSMutableIndexSet * )assignableCPUs;
+- ( NSString * )promptLabelForTaskAtIndex: ( NSUInteger )index;
+- ( void )recordEndWithState: ( SKTaskState )state;
+- ( void )stopServices: ( NSArray< SKTask * > * )services;
+- ( void )joinTasks: ( NSArray< SKOptionalTask * > * )tasks;
+- ( id< SKRunableObject > )runableObjectForTask: ( id< SKRunableObject > )task detached: ( NSArray< SKOptionalTask * > * )detached;
+- ( NSIndexSet * )indexesOfTasksAffectedByPaths: ( NSSet< NSString * > * )paths;
+- ( void )filesDidChange: ( NSSet< NSString * > * )paths;
 
 @end
 
@@ -59,13 +102,166 @@ NS_ASSUME_NONNULL_END
 {
     if( ( self = [ super init ] ) )
     {
-        self.name  = name;
-        self.tasks = tasks;
+        self.name          = name;
+        self.tasks         = tasks;
+        self.watchLatency  = 0.2;
+        self.changedPaths  = [ NSMutableSet new ];
+        self.statusRecord  = [ SKTaskStatusRecord new ];
+        self.parallelTasks = [ NSMutableArray new ];
     }
     
     return self;
 }
 
+- ( void )cancel
+{
+    NSMutableArray< id< SKRunableObject > > * tasks;
+    id< SKRunableObject >                     task;
+    
+    self.cancelled = YES;
+    
+    @synchronized( self.parallelTasks )
+    {
+        tasks = [ self.parallelTasks mutableCopy ];
+    }
+    
+    if( self.currentTask != nil )
+    {
+        [ tasks addObject: ( id< SKRunableObject > )( self.currentTask ) ];
+    }
+    
+    [ self.currentBatch cancel ];
+    
+    for( task in tasks )
+    {
+        if( [ ( NSObject * )task respondsToSelector: @selector( cancel ) ] )
+        {
+            [ ( id )task cancel ];
+        }
+    }
+}
+
+- ( BOOL )watch: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    NSMutableArray< NSString * > * patterns;
+    id< SKRunableObject >          task;
+    SKFileWatcher                * watcher;
+    NSMutableIndexSet            * schedule;
+    NSSet< NSString * >          * paths;
+    BOOL                           success;
+    
+    patterns = [ NSMutableArray new ];
+    
+    for( task in self.tasks )
+    {
+        [ patterns addObjectsFromArray: [ SKTaskGroup inputsOfTask: task ] ];
+    }
+    
+    if( patterns.count == 0 )
+    {
+        self.error = [ self errorWithDescription: @"No task declares inputs" ];
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        return NO;
+    }
+    
+    self.changes  = dispatch_semaphore_create( 0 );
+    self.watching = YES;
+    
+    watcher = [ [ SKFileWatcher alloc ] initWithPatterns: patterns handler: ^( NSSet< NSString * > * changed )
+        {
+            [ self filesDidChange: changed ];
+        }
+    ];
+    
+    watcher.latency = self.watchLatency;
+    
+    if( [ watcher start ] == NO )
+    {
+        self.error    = watcher.error;
+        self.watching = NO;
+        
+        [ [ SKShell currentShell ] printError: self.error ];
+        
+        return NO;
+    }
+    
+    schedule = [ NSMutableIndexSet indexSetWithIndexesInRange: NSMakeRange( 0, self.tasks.count ) ];
+    
+    while( self.watching )
+    {
+        if( schedule.count > 0 )
+        {
+            @synchronized( self.changedPaths )
+            {
+                self.watchSchedule = schedule;
+            }
+            
+            success = [ self runTasksAtIndexes: schedule variables: variables ];
+            
+            @synchronized( self.changedPaths )
+            {
+                self.watchSchedule = nil;
+            }
+            
+            /* Tasks that failed, or were not run, are still outdated */
+            if( success == NO )
+            {
+                @synchronized( schedule )
+                {
+                    [ schedule removeIndexesInRange: NSMakeRange( 0, self.currentIndex ) ];
+                }
+            }
+            else
+            {
+                schedule = [ NSMutableIndexSet new ];
+            }
+            
+            if( self.watching )
+            {
+                [ [ SKShell currentShell ] printMessage: @"Watching for changes" status: SKStatusSearch color: SKColorNone ];
+            }
+        }
+        
+        dispatch_semaphore_wait( ( dispatch_semaphore_t )( self.changes ), DISPATCH_TIME_FOREVER );
+        
+        @synchronized( self.changedPaths )
+        {
+            paths = [ self.changedPaths copy ];
+            
+            [ self.changedPaths removeAllObjects ];
+        }
+        
+        if( paths.count > 0 && self.watching )
+        {
+            [ [ SKShell currentShell ] printMessage: @"%lu files changed" status: SKStatusFile color: SKColorNone, ( unsigned long )( paths.count ) ];
+            [ schedule addIndexes: [ self indexesOfTasksAffectedByPaths: paths ] ];
+        }
+    }
+    
+    [ watcher stop ];
+    
+    self.changes = nil;
+    
+    return YES;
+}
+
+- ( void )stopWatching
+{
+    dispatch_semaphore_t changes;
+    
+    changes       = self.changes;
+    self.watching = NO;
+    
+    [ self cancel ];
+    
+    if( changes != nil )
+    {
+        dispatch_semaphore_signal( changes );
+    }
+}
+
 #pragma mark - SKRunableObject
 
 - ( BOOL )run
@@ -75,14 +271,205 @@ NS_ASSUME_NONNULL_END
 
 - ( BOOL )run: ( nullable NSDictionary< NSString *, NSString * > * )variables
 {
-    id< SKRunableObject > task;
-    NSDate              * date;
-    NSString            * time;
-    NSUInteger            i;
+    return [ self runTasksAtIndexes: [ NSMutableIndexSet indexSetWithIndexesInRange: NSMakeRange( 0, self.tasks.count ) ] variables: variables ];
+}
+
+- ( SKFuture * )runAsynchronously: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    SKFuture                           * future;
+    NSMutableString                    * buffer;
+    NSArray< NSString * >              * hierarchy;
+    NSMutableArray< SKTask * >         * services;
+    NSMutableArray< SKOptionalTask * > * detached;
+    NSDate                             * date;
+    SKTaskGroupCompletion                completion;
+    
+    /* Batches, CPU assignments and watch mode are handled by the synchronous run, on a thread */
+    if( self.batchesTasks || self.assignsCPUs || self.watching )
+    {
+        return [ SKFuture backgroundFutureByRunning: self variables: variables ];
+    }
+    
+    buffer = [ [ SKShell currentShell ] messageBufferForCurrentThread ];
+    
+    /* Asynchronous groups may run concurrently, so their name is only added to the prompt of their own thread, and of their continuations */
+    if( self.name.length )
+    {
+        hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThreadByAddingPart: self.name ];
+    }
+    else
+    {
+        hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    }
     
     @synchronized( self )
     {
-        self.running = YES;
+        if( self.running )
+        {
+            return [ SKFuture futureWithError: [ self errorWithDescription: @"Task group is already running" ] ];
+        }
+        
+        self.running         = YES;
+        self.cancelled       = NO;
+        self.eventIdentifier = [ SKEventStream nextIdentifier ];
+        
+        [ self.statusRecord beginWithName: self.name ];
+        [ [ SKShell currentShell ].eventStream writeGroupStart: self.eventIdentifier name: self.name ];
+        
+        if( self.tasks.count == 0 )
+        {
+            self.error = [ self errorWithDescription: @"No task defined" ];
+            
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    [ [ SKShell currentShell ] printError: self.error ];
+                }
+            ];
+            
+            [ self recordEndWithState: SKTaskStateFailed ];
+            
+            self.running = NO;
+            
+            return [ SKFuture futureWithError: ( NSError * )( self.error ) ];
+        }
+    }
+    
+    date     = [ NSDate date ];
+    services = [ NSMutableArray new ];
+    detached = [ NSMutableArray new ];
+    future   = [ [ SKFuture alloc ] initWithCancellationHandler: ^( void )
+        {
+            [ self cancel ];
+        }
+    ];
+    
+    completion = ^( NSUInteger count, id< SKRunableObject > _Nullable failed )
+    {
+        [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+            {
+                if( failed != nil || self.cancelled )
+                {
+                    [ self endWithError: failed.error services: services detached: detached ];
+                    [ future finishWithSuccess: NO error: self.error ];
+                }
+                else
+                {
+                    [ self endWithCount: count startDate: date services: services detached: detached ];
+                    [ future finishWithSuccess: YES error: nil ];
+                }
+            }
+        ];
+    };
+    
+    [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+        {
+            if( self.tasks.count > 1 )
+            {
+                [ [ SKShell currentShell ] printMessage: @"Running %lu tasks" status: SKStatusExecute color: SKColorNone, ( unsigned long )( self.tasks.count ) ];
+            }
+            
+            if( self.concurrencyLimiter != nil )
+            {
+                [ self runTasksInParallelWithVariables: variables services: services detached: detached completion: completion ];
+            }
+            else
+            {
+                [ self runTaskAtIndex: 0 variables: variables buffer: buffer services: services detached: detached completion: completion ];
+            }
+        }
+    ];
+    
+    return future;
+}
+
+- ( SKTaskStatus * )snapshot
+{
+    NSMutableArray< SKTaskStatus * > * children;
+    SKTaskStatus                     * status;
+    SKTaskStatus                     * child;
+    id< SKRunableObject >              task;
+    NSDate                           * start;
+    uint64_t                           bytes;
+    
+    status   = [ self.statusRecord snapshotWithDefaultName: self.name children: @[] ];
+    start    = status.startDate;
+    children = [ NSMutableArray new ];
+    bytes    = 0;
+    
+    for( task in self.tasks )
+    {
+        if( [ task respondsToSelector: @selector( snapshot ) ] )
+        {
+            child = [ task snapshot ];
+        }
+        else
+        {
+            child = [ [ SKTaskStatus alloc ] initWithName: NSStringFromClass( [ task class ] ) state: ( task.running ) ? SKTaskStateRunning : SKTaskStatePending startDate: nil endDate: nil processIdentifier: 0 outputBytes: 0 children: @[] ];
+        }
+        
+        /* Results from a previous run of the group aren't reported */
+        if( start != nil && child.startDate != nil && [ ( NSDate * )( child.startDate ) compare: ( NSDate * )start ] == NSOrderedAscending )
+        {
+            child = [ child pendingStatus ];
+        }
+        
+        bytes += child.outputBytes;
+        
+        [ children addObject: child ];
+    }
+    
+    return [ [ SKTaskStatus alloc ] initWithName: status.name state: status.state startDate: status.startDate endDate: status.endDate processIdentifier: 0 outputBytes: bytes children: children ];
+}
+
+#pragma mark - Private
+
++ ( NSArray< NSString * > * )inputsOfTask: ( id< SKRunableObject > )task
+{
+    NSMutableArray< NSString * > * inputs;
+    NSString                     * input;
+    id< SKRunableObject >          sub;
+    
+    inputs = [ NSMutableArray new ];
+    
+    if( [ task isKindOfClass: [ SKTask class ] ] )
+    {
+        for( input in ( ( SKTask * )task ).inputs )
+        {
+            [ inputs addObject: [ SKFileWatcher absolutePattern: input ] ];
+        }
+    }
+    else if( [ task isKindOfClass: [ SKTaskGroup class ] ] )
+    {
+        for( sub in ( ( SKTaskGroup * )task ).tasks )
+        {
+            [ inputs addObjectsFromArray: [ SKTaskGroup inputsOfTask: sub ] ];
+        }
+    }
+    
+    return inputs;
+}
+
+- ( BOOL )runTasksAtIndexes: ( NSMutableIndexSet * )schedule variables: ( nullable NSDictionary< NSString *, NSString * > * )variables
+{
+    id< SKRunableObject >                task;
+    SKTaskBatch                        * batch;
+    NSMutableArray< SKTask * >         * services;
+    NSMutableArray< SKOptionalTask * > * detached;
+    NSDate                             * date;
+    NSUInteger                           i;
+    NSUInteger                           n;
+    NSUInteger                           count;
+    BOOL                                 success;
+    
+    @synchronized( self )
+    {
+        self.running   = YES;
+        self.cancelled = NO;
+        
+        self.eventIdentifier = [ SKEventStream nextIdentifier ];
+        
+        [ self.statusRecord beginWithName: self.name ];
+        [ [ SKShell currentShell ].eventStream writeGroupStart: self.eventIdentifier name: self.name ];
         
         if( self.name.length )
         {
@@ -94,6 +481,7 @@ NS_ASSUME_NONNULL_END
             self.error = [ self errorWithDescription: @"No task defined" ];
             
             [ [ SKShell currentShell ] printError: self.error ];
+            [ self recordEndWithState: SKTaskStateFailed ];
             
             self.running = NO;
             
@@ -105,68 +493,730 @@ NS_ASSUME_NONNULL_END
             return NO;
         }
         
-        if( self.tasks.count > 1 )
+        @synchronized( schedule )
         {
-            [ [ SKShell currentShell ] printMessage: @"Running %lu tasks" status: SKStatusExecute color: SKColorNone, self.tasks.count ];
+            i                 = schedule.firstIndex;
+            n                 = schedule.count;
+            self.currentIndex = i;
         }
         
-        i    = 0;
-        date = [ NSDate date ];
+        if( n > 1 )
+        {
+            [ [ SKShell currentShell ] printMessage: @"Running %lu tasks" status: SKStatusExecute color: SKColorNone, ( unsigned long )n ];
+        }
+        
+        count    = 0;
+        date     = [ NSDate date ];
+        services = [ NSMutableArray new ];
+        detached = [ NSMutableArray new ];
         
-        for( task in self.tasks )
+        if( self.concurrencyLimiter != nil )
         {
-            self.currentTask = task;
+            task = [ self runTasksInParallelAtIndexes: schedule variables: variables services: services detached: detached count: &count ];
             
-            [ [ SKShell currentShell ] addPromptPart: [ NSString stringWithFormat: @"#%li", ( unsigned long )++i ] ];
+            if( task != nil || self.cancelled )
+            {
+                return [ self failWithError: task.error services: services detached: detached ];
+            }
             
-            if( [ task run: variables ] == NO )
+            i = NSNotFound;
+        }
+        
+        while( i != NSNotFound && i < self.tasks.count )
+        {
+            @autoreleasepool
             {
-                [ [ SKShell currentShell ] removeLastPromptPart ];
+                /* Scheduled tasks are run in order - Adjacent ones may be batched */
+                @synchronized( schedule )
+                {
+                    n = i;
+                    
+                    while( n < self.tasks.count && [ schedule containsIndex: n ] )
+                    {
+                        n++;
+                    }
+                }
                 
-                self.currentTask = nil;
-                self.error       = task.error;
+                task    = self.tasks[ i ];
+                batch   = ( self.batchesTasks && self.cancelled == NO ) ? [ SKTaskBatch batchWithTasks: [ self.tasks subarrayWithRange: NSMakeRange( i, n - i ) ] variables: variables ] : nil;
+                success = NO;
                 
-                [ [ SKShell currentShell ] printErrorMessage: @"Failed to execute task group" ];
+                /* Tasks may be cancelled by changes in watch mode */
+                if( batch != nil )
+                {
+                    batch.runsInOwnProcessGroup = self.watching;
+                    self.currentBatch           = batch;
+                    success                     = [ self runBatch: batch fromIndex: i ];
+                    self.currentBatch           = nil;
+                    n                           = i + batch.tasks.count;
+                }
+                else if( self.cancelled == NO )
+                {
+                    self.currentTask = task;
+                    n                = i + 1;
+                    
+                    if( self.watching && [ task isKindOfClass: [ SKTask class ] ] )
+                    {
+                        ( ( SKTask * )task ).runsInOwnProcessGroup = YES;
+                    }
+                    
+                    [ [ SKShell currentShell ] addPromptPart: [ self promptLabelForTaskAtIndex: i ] ];
+                    
+                    success = [ [ self runableObjectForTask: task detached: detached ] run: variables ];
+                    
+                    if( success && [ task isKindOfClass: [ SKTask class ] ] && ( ( SKTask * )task ).serviceTask != nil )
+                    {
+                        [ services addObject: ( SKTask * )task ];
+                    }
+                    
+                    /* Background tasks are joined when the group ends, before stopping services */
+                    if( [ task isKindOfClass: [ SKOptionalTask class ] ] && ( ( SKOptionalTask * )task ).detached )
+                    {
+                        [ detached addObject: ( SKOptionalTask * )task ];
+                    }
+                    
+                    [ [ SKShell currentShell ] removeLastPromptPart ];
+                }
                 
-                self.running = NO;
+                if( success == NO || self.cancelled )
+                {
+                    return [ self failWithError: ( batch != nil ) ? batch.error : task.error services: services detached: detached ];
+                }
+                
+                count += n - i;
                 
-                if( self.name.length )
+                /* Changes may add tasks to the schedule, as long as they haven't started */
+                @synchronized( schedule )
                 {
-                    [ [ SKShell currentShell ] removeLastPromptPart ];
+                    i                 = [ schedule indexGreaterThanOrEqualToIndex: n ];
+                    self.currentIndex = i;
                 }
+            }
+        }
+        
+        [ self endWithCount: count startDate: date services: services detached: detached ];
+        
+        if( self.name.length )
+        {
+            [ [ SKShell currentShell ] removeLastPromptPart ];
+        }
+        
+        return YES;
+    }
+}
+
+- ( nullable id< SKRunableObject > )runTasksInParallelAtIndexes: ( NSMutableIndexSet * )schedule variables: ( nullable NSDictionary< NSString *, NSString * > * )variables services: ( NSMutableArray< SKTask * > * )services detached: ( NSMutableArray< SKOptionalTask * > * )detached count: ( NSUInteger * )count
+{
+    SKConcurrencyLimiter                    * limiter;
+    NSMutableArray< id< SKRunableObject > > * failed;
+    NSMutableIndexSet                       * succeeded;
+    NSMutableIndexSet                       * cpus;
+    NSMutableIndexSet                       * assigned;
+    SKProcessAttributes                     * attributes;
+    SKProcessAttributes                     * pinned;
+    NSArray< NSString * >                   * hierarchy;
+    dispatch_group_t                          group;
+    id< SKRunableObject >                     task;
+    NSUInteger                                i;
+    NSUInteger                                cpu;
+    NSUInteger                                weight;
+    BOOL                                      stop;
+    
+    limiter   = ( SKConcurrencyLimiter * )( self.concurrencyLimiter );
+    failed    = [ NSMutableArray new ];
+    succeeded = [ NSMutableIndexSet new ];
+    cpus      = ( self.assignsCPUs ) ? [ self assignableCPUs ] : nil;
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    group     = dispatch_group_create();
+    
+    @synchronized( schedule )
+    {
+        i = schedule.firstIndex;
+    }
+    
+    while( i != NSNotFound && i < self.tasks.count )
+    {
+        @autoreleasepool
+        {
+            task = self.tasks[ i ];
+            
+            /* Only tasks hold slots - A nested group may run parallel groups sharing the limiter, so holding one for it could deadlock */
+            weight = ( [ task isKindOfClass: [ SKTask class ] ] ) ? MAX( ( ( SKTask * )task ).weight, ( NSUInteger )1 ) : 0;
+            
+            if( weight > 0 )
+            {
+                [ limiter acquireSlots: weight ];
+            }
+            
+            @synchronized( self.parallelTasks )
+            {
+                stop = failed.count > 0 || self.cancelled;
                 
-                return NO;
+                if( stop == NO )
+                {
+                    [ self.parallelTasks addObject: task ];
+                }
             }
             
-            [ [ SKShell currentShell ] removeLastPromptPart ];
+            if( stop )
+            {
+                if( weight > 0 )
+                {
+                    [ limiter releaseSlots: weight ];
+                }
+                
+                break;
+            }
+            
+            if( self.watching && [ task isKindOfClass: [ SKTask class ] ] )
+            {
+                ( ( SKTask * )task ).runsInOwnProcessGroup = YES;
+            }
+            
+            assigned = nil;
+            pinned   = nil;
+            
+            if( cpus != nil && [ task isKindOfClass: [ SKTask class ] ] && ( ( SKTask * )task ).processAttributes.cpuAffinity == nil )
+            {
+                @synchronized( cpus )
+                {
+                    if( cpus.count >= weight )
+                    {
+                        assigned = [ NSMutableIndexSet new ];
+                        
+                        for( cpu = cpus.firstIndex; assigned.count < weight; cpu = [ cpus indexGreaterThanIndex: cpu ] )
+                        {
+                            [ assigned addIndex: cpu ];
+                        }
+                        
+                        [ cpus removeIndexes: assigned ];
+                    }
+                }
+            }
+            
+            /* The task's own attributes are left untouched, and assigned CPUs are given back when the task ends */
+            if( assigned != nil )
+            {
+                attributes         = ( ( SKTask * )task ).processAttributes;
+                pinned             = ( attributes != nil ) ? [ attributes copy ] : [ SKProcessAttributes new ];
+                pinned.cpuAffinity = assigned;
+            }
+            
+            *( count ) += 1;
+            
+            /* Messages of parallel tasks are buffered, so they don't interleave, and nested groups change the prompt of their own thread only */
+            dispatch_group_async
+            (
+                group,
+                dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+                ^( void )
+                {
+                    NSMutableString * buffer;
+                    BOOL              success;
+                    
+                    buffer = [ NSMutableString new ];
+                    
+                    [ [ SKShell currentShell ] setMessageBufferForCurrentThread: buffer ];
+                    [ [ SKShell currentShell ] setPromptHierarchyForCurrentThread: hierarchy ];
+                    
+                    if( pinned != nil )
+                    {
+                        success = [ ( SKTask * )task run: variables attributes: pinned ];
+                    }
+                    else
+                    {
+                        success = [ [ self runableObjectForTask: task detached: detached ] run: variables ];
+                    }
+                    
+                    [ [ SKShell currentShell ] setPromptHierarchyForCurrentThread: nil ];
+                    [ [ SKShell currentShell ] setMessageBufferForCurrentThread: nil ];
+                    [ [ SKShell currentShell ] printBufferedMessages: buffer ];
+                    
+                    if( assigned != nil )
+                    {
+                        @synchronized( cpus )
+                        {
+                            [ cpus addIndexes: ( NSIndexSet * )assigned ];
+                        }
+                    }
+                    
+                    if( weight > 0 )
+                    {
+                        [ limiter releaseSlots: weight ];
+                    }
+                    
+                    @synchronized( self.parallelTasks )
+                    {
+                        [ self.parallelTasks removeObjectIdenticalTo: task ];
+                        
+                        if( success == NO )
+                        {
+                            [ failed addObject: task ];
+                        }
+                        else
+                        {
+                            [ succeeded addIndex: i ];
+                        }
+                        
+                        if( success && [ task isKindOfClass: [ SKTask class ] ] && ( ( SKTask * )task ).serviceTask != nil )
+                        {
+                            [ services addObject: ( SKTask * )task ];
+                        }
+                        
+                        if( [ task isKindOfClass: [ SKOptionalTask class ] ] && ( ( SKOptionalTask * )task ).detached )
+                        {
+                            [ detached addObject: ( SKOptionalTask * )task ];
+                        }
+                    }
+                }
+            );
+            
+            /* Changes may add tasks to the schedule, as long as they haven't started */
+            @synchronized( schedule )
+            {
+                self.currentIndex = i;
+                i                 = [ schedule indexGreaterThanIndex: i ];
+            }
+        }
+    }
+    
+    dispatch_group_wait( group, DISPATCH_TIME_FOREVER );
+    
+    if( failed.count == 0 && self.cancelled == NO )
+    {
+        return nil;
+    }
+    
+    /* In watch mode, tasks from the first one that didn't succeed are still outdated */
+    @synchronized( schedule )
+    {
+        i = schedule.firstIndex;
+        
+        while( i != NSNotFound && [ succeeded containsIndex: i ] )
+        {
+            i = [ schedule indexGreaterThanIndex: i ];
         }
         
-        time             = date.elapsedTimeStringSinceNow;
-        self.currentTask = nil;
+        self.currentIndex = i;
+    }
+    
+    return failed.firstObject;
+}
+
+- ( void )runTaskAtIndex: ( NSUInteger )index variables: ( nullable NSDictionary< NSString *, NSString * > * )variables buffer: ( nullable NSMutableString * )buffer services: ( NSMutableArray< SKTask * > * )services detached: ( NSMutableArray< SKOptionalTask * > * )detached completion: ( SKTaskGroupCompletion )completion
+{
+    id< SKRunableObject >   task;
+    NSArray< NSString * > * hierarchy;
+    __block SKFuture      * started;
+    
+    if( index >= self.tasks.count || self.cancelled )
+    {
+        completion( index, nil );
         
-        if( self.tasks.count > 1 )
+        return;
+    }
+    
+    task              = self.tasks[ index ];
+    hierarchy         = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    self.currentTask  = task;
+    self.currentIndex = index;
+    
+    /* The task's label is only added to the prompt of its own run */
+    [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
         {
-            if( time )
-            {
-                time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
+            [ [ SKShell currentShell ] addPromptPart: [ self promptLabelForTaskAtIndex: index ] ];
+            
+            started = [ SKFuture futureByRunning: [ self runableObjectForTask: task detached: detached ] variables: variables ];
+        }
+    ];
+    
+    /* The next task is started by the completion of the current one, so no thread waits in between */
+    [ started whenFinished: ^( SKFuture * future )
+        {
+            [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                {
+                    if( future.state == SKFutureStateSucceeded && [ task isKindOfClass: [ SKTask class ] ] && ( ( SKTask * )task ).serviceTask != nil )
+                    {
+                        [ services addObject: ( SKTask * )task ];
+                    }
+                    
+                    if( [ task isKindOfClass: [ SKOptionalTask class ] ] && ( ( SKOptionalTask * )task ).detached )
+                    {
+                        [ detached addObject: ( SKOptionalTask * )task ];
+                    }
+                    
+                    if( future.state != SKFutureStateSucceeded )
+                    {
+                        completion( index, task );
+                    }
+                    else
+                    {
+                        [ self runTaskAtIndex: index + 1 variables: variables buffer: buffer services: services detached: detached completion: completion ];
+                    }
+                }
+            ];
+        }
+    ];
+}
 
-                [ [ SKShell currentShell ] printSuccessMessage: @"%lu tasks completed successfully %@", self.tasks.count, time ];
+- ( void )runTasksInParallelWithVariables: ( nullable NSDictionary< NSString *, NSString * > * )variables services: ( NSMutableArray< SKTask * > * )services detached: ( NSMutableArray< SKOptionalTask * > * )detached completion: ( SKTaskGroupCompletion )completion
+{
+    SKConcurrencyLimiter                    * limiter;
+    NSMutableArray< id< SKRunableObject > > * failed;
+    NSArray< NSString * >                   * hierarchy;
+    dispatch_group_t                          group;
+    id< SKRunableObject >                     task;
+    NSUInteger                                weight;
+    __block NSUInteger                        count;
+    
+    limiter   = ( SKConcurrencyLimiter * )( self.concurrencyLimiter );
+    failed    = [ NSMutableArray new ];
+    hierarchy = [ [ SKShell currentShell ] promptHierarchyForCurrentThread ];
+    group     = dispatch_group_create();
+    count     = 0;
+    
+    for( task in self.tasks )
+    {
+        /* Only tasks hold slots, as with synchronous runs */
+        weight = ( [ task isKindOfClass: [ SKTask class ] ] ) ? MAX( ( ( SKTask * )task ).weight, ( NSUInteger )1 ) : 0;
+        
+        dispatch_group_enter( group );
+        
+        /* Tasks are admitted in order, by the admission thread of the limiter */
+        [ limiter acquireSlots: weight handler: ^( void )
+            {
+                NSMutableString  * buffer;
+                __block SKFuture * future;
+                BOOL               stop;
+                
+                @synchronized( self.parallelTasks )
+                {
+                    stop = failed.count > 0 || self.cancelled;
+                    
+                    if( stop == NO )
+                    {
+                        [ self.parallelTasks addObject: task ];
+                        
+                        count++;
+                    }
+                }
+                
+                if( stop )
+                {
+                    if( weight > 0 )
+                    {
+                        [ limiter releaseSlots: weight ];
+                    }
+                    
+                    dispatch_group_leave( group );
+                    
+                    return;
+                }
+                
+                /* Messages of parallel tasks are buffered, so they don't interleave, and nested groups change the prompt of their own thread only */
+                buffer = [ NSMutableString new ];
+                
+                [ [ SKShell currentShell ] performWithMessageBuffer: buffer promptHierarchy: hierarchy block: ^( void )
+                    {
+                        future = [ SKFuture futureByRunning: [ self runableObjectForTask: task detached: detached ] variables: variables ];
+                    }
+                ];
+                
+                [ future whenFinished: ^( SKFuture * finished )
+                    {
+                        [ [ SKShell currentShell ] printBufferedMessages: buffer ];
+                        
+                        if( weight > 0 )
+                        {
+                            [ limiter releaseSlots: weight ];
+                        }
+                        
+                        @synchronized( self.parallelTasks )
+                        {
+                            [ self.parallelTasks removeObjectIdenticalTo: task ];
+                            
+                            if( finished.state != SKFutureStateSucceeded )
+                            {
+                                [ failed addObject: task ];
+                            }
+                            
+                            if( finished.state == SKFutureStateSucceeded && [ task isKindOfClass: [ SKTask class ] ] && ( ( SKTask * )task ).serviceTask != nil )
+                            {
+                                [ services addObject: ( SKTask * )task ];
+                            }
+                            
+                            if( [ task isKindOfClass: [ SKOptionalTask class ] ] && ( ( SKOptionalTask * )task ).detached )
+                            {
+                                [ detached addObject: ( SKOptionalTask * )task ];
+                            }
+                        }
+                        
+                        dispatch_group_leave( group );
+                    }
+                ];
             }
-            else
+        ];
+    }
+    
+    dispatch_group_notify
+    (
+        group,
+        dispatch_get_global_queue( DISPATCH_QUEUE_PRIORITY_DEFAULT, 0 ),
+        ^( void )
+        {
+            completion( count, failed.firstObject );
+        }
+    );
+}
+
+- ( BOOL )failWithError: ( nullable NSError * )error services: ( NSArray< SKTask * > * )services detached: ( NSArray< SKOptionalTask * > * )detached
+{
+    [ self endWithError: error services: services detached: detached ];
+    
+    if( self.name.length )
+    {
+        [ [ SKShell currentShell ] removeLastPromptPart ];
+    }
+    
+    return NO;
+}
+
+- ( void )endWithError: ( nullable NSError * )error services: ( NSArray< SKTask * > * )services detached: ( NSArray< SKOptionalTask * > * )detached
+{
+    [ self joinTasks: detached ];
+    [ self stopServices: services ];
+    
+    self.currentTask = nil;
+    
+    if( self.cancelled )
+    {
+        self.error = [ self errorWithDescription: @"Task group was cancelled" ];
+        
+        [ [ SKShell currentShell ] printWarningMessage: @"Task group was cancelled" ];
+    }
+    else
+    {
+        self.error = error;
+        
+        [ [ SKShell currentShell ] printErrorMessage: @"Failed to execute task group" ];
+    }
+    
+    [ self recordEndWithState: ( self.cancelled ) ? SKTaskStateCancelled : SKTaskStateFailed ];
+    
+    self.running = NO;
+}
+
+- ( void )endWithCount: ( NSUInteger )count startDate: ( NSDate * )date services: ( NSArray< SKTask * > * )services detached: ( NSArray< SKOptionalTask * > * )detached
+{
+    NSString * time;
+    
+    [ self joinTasks: detached ];
+    [ self stopServices: services ];
+    
+    time             = date.elapsedTimeStringSinceNow;
+    self.currentTask = nil;
+    
+    if( count > 1 )
+    {
+        if( time )
+        {
+            time = [ [ NSString stringWithFormat: @"(%@)", time ] stringWithShellColor: SKColorNone ];
+            
+            [ [ SKShell currentShell ] printSuccessMessage: @"%lu tasks completed successfully %@", ( unsigned long )count, time ];
+        }
+        else
+        {
+            [ [ SKShell currentShell ] printSuccessMessage: @"%lu tasks completed successfully", ( unsigned long )count ];
+        }
+    }
+    
+    [ self recordEndWithState: SKTaskStateSucceeded ];
+    
+    self.running = NO;
+}
+
+- ( NSMutableIndexSet * )assignableCPUs
+{
+    NSMutableIndexSet     * cpus;
+    id< SKRunableObject >   task;
+    NSIndexSet            * affinity;
+    
+    cpus = [ [ SKProcessAttributes availableCPUs ] mutableCopy ];
+    
+    /* CPUs reserved explicitly by a task are kept for it */
+    for( task in self.tasks )
+    {
+        if( [ task isKindOfClass: [ SKTask class ] ] )
+        {
+            affinity = ( ( SKTask * )task ).processAttributes.cpuAffinity;
+            
+            if( affinity != nil )
             {
-                [ [ SKShell currentShell ] printSuccessMessage: @"%lu tasks completed successfully", self.tasks.count ];
+                [ cpus removeIndexes: ( NSIndexSet * )affinity ];
             }
         }
+    }
+    
+    return cpus;
+}
+
+- ( BOOL )runBatch: ( SKTaskBatch * )batch fromIndex: ( NSUInteger )index
+{
+    batch.willStartTask = ^( SKTask * task, NSUInteger i )
+    {
+        self.currentTask  = task;
+        self.currentIndex = index + i;
         
-        self.running = NO;
+        [ [ SKShell currentShell ] addPromptPart: [ self promptLabelForTaskAtIndex: index + i ] ];
+    };
+    
+    batch.didEndTask = ^( SKTask * task, NSUInteger i )
+    {
+        ( void )task;
+        ( void )i;
         
-        if( self.name.length )
+        [ [ SKShell currentShell ] removeLastPromptPart ];
+    };
+    
+    return [ batch run ];
+}
+
+- ( void )recordEndWithState: ( SKTaskState )state
+{
+    [ self.statusRecord endWithState: state ];
+    [ [ SKShell currentShell ].eventStream writeGroupEnd: self.eventIdentifier name: self.name state: state duration: self.statusRecord.elapsedTime ];
+}
+
+- ( NSString * )promptLabelForTaskAtIndex: ( NSUInteger )index
+{
+    NSArray< NSString * >        * labels;
+    NSMutableArray< NSString * > * build;
+    NSUInteger                     i;
+    
+    labels = self.promptLabels;
+    
+    /* Labels are built once, and reused for every run of the group */
+    if( labels == nil || labels.count != self.tasks.count )
+    {
+        build = [ NSMutableArray arrayWithCapacity: self.tasks.count ];
+        
+        for( i = 0; i < self.tasks.count; i++ )
         {
-            [ [ SKShell currentShell ] removeLastPromptPart ];
+            [ build addObject: [ NSString stringWithFormat: @"#%lu", ( unsigned long )( i + 1 ) ] ];
         }
         
-        return YES;
+        labels            = [ build copy ];
+        self.promptLabels = labels;
+    }
+    
+    return ( index < labels.count ) ? labels[ index ] : [ NSString stringWithFormat: @"#%lu", ( unsigned long )( index + 1 ) ];
+}
+
+- ( void )stopServices: ( NSArray< SKTask * > * )services
+{
+    SKTask * service;
+    
+    for( service in services.reverseObjectEnumerator )
+    {
+        [ service stopService ];
+    }
+}
+
+- ( void )joinTasks: ( NSArray< SKOptionalTask * > * )tasks
+{
+    SKOptionalTask * task;
+    
+    for( task in tasks )
+    {
+        [ task join ];
     }
 }
 
+- ( id< SKRunableObject > )runableObjectForTask: ( id< SKRunableObject > )task detached: ( NSArray< SKOptionalTask * > * )detached
+{
+    NSArray< SKOptionalTask * > * tasks;
+    
+    if( [ task isKindOfClass: [ SKTaskBarrier class ] ] == NO )
+    {
+        return task;
+    }
+    
+    /* Barriers only join the tasks detached by this run of the group, as other groups may be running */
+    @synchronized( self.parallelTasks )
+    {
+        tasks = [ detached copy ];
+    }
+    
+    return [ SKTaskBarrier barrierJoiningTasks: tasks ];
+}
+
+- ( NSIndexSet * )indexesOfTasksAffectedByPaths: ( NSSet< NSString * > * )paths
+{
+    NSString   * path;
+    NSString   * pattern;
+    NSUInteger   i;
+    
+    for( i = 0; i < self.tasks.count; i++ )
+    {
+        for( pattern in [ SKTaskGroup inputsOfTask: self.tasks[ i ] ] )
+        {
+            for( path in paths )
+            {
+                /* Next tasks may consume the outputs of this one, so they are all outdated */
+                if( [ SKFileWatcher path: path matchesPattern: pattern ] )
+                {
+                    return [ NSIndexSet indexSetWithIndexesInRange: NSMakeRange( i, self.tasks.count - i ) ];
+                }
+            }
+        }
+    }
+    
+    return [ NSIndexSet indexSet ];
+}
+
+- ( void )filesDidChange: ( NSSet< NSString * > * )paths
+{
+    NSIndexSet        * indexes;
+    NSMutableIndexSet * schedule;
+    BOOL                cancel;
+    
+    indexes = [ self indexesOfTasksAffectedByPaths: paths ];
+    cancel  = NO;
+    
+    if( indexes.count == 0 )
+    {
+        return;
+    }
+    
+    @synchronized( self.changedPaths )
+    {
+        schedule = self.watchSchedule;
+        
+        if( schedule != nil )
+        {
+            @synchronized( schedule )
+            {
+                /* Affected tasks haven't started yet - They are added to the current run */
+                if( indexes.firstIndex > self.currentIndex )
+                {
+                    [ schedule addIndexes: indexes ];
+                    
+                    return;
+                }
+            }
+        }
+        
+        cancel = ( schedule != nil );
+        
+        [ self.changedPaths unionSet: paths ];
+    }
+    
+    if( cancel )
+    {
+        [ self cancel ];
+    }
+    
+    dispatch_semaphore_signal( ( dispatch_semaphore_t )( self.changes ) );
+}
+
 @end
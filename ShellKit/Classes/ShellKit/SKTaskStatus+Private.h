@@ -0,0 +1,65 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTaskStatus+Private.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private SKTaskStatus interface, and live status records
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKTaskStatus.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKTaskStatus()
+
+- ( instancetype )initWithName: ( NSString * )name state: ( SKTaskState )state startDate: ( nullable NSDate * )start endDate: ( nullable NSDate * )end processIdentifier: ( pid_t )pid outputBytes: ( uint64_t )bytes children: ( NSArray< SKTaskStatus * > * )children NS_DESIGNATED_INITIALIZER;
+
+- ( SKTaskStatus * )pendingStatus;
+
+@end
+
+/*!
+ * @class       SKTaskStatusRecord
+ * @abstract    The live execution status of a runnable object
+ * @discussion  Written by the executing thread, and read concurrently
+ *              when taking snapshots.
+ *              Fields are guarded by a sequence counter: readers retry
+ *              if a write happened while reading, but never wait for the
+ *              writer. The output counter is updated separately, as it
+ *              changes often and only ever grows during a run.
+ */
+@interface SKTaskStatusRecord: NSObject
+
+- ( void )beginWithName: ( NSString * )name;
+- ( void )setProcessIdentifier: ( pid_t )pid;
+- ( void )addOutputBytes: ( uint64_t )bytes;
+- ( void )endWithState: ( SKTaskState )state;
+- ( NSTimeInterval )elapsedTime;
+- ( SKTaskStatus * )snapshotWithDefaultName: ( NSString * )name children: ( NSArray< SKTaskStatus * > * )children;
+
+@end
+
+NS_ASSUME_NONNULL_END
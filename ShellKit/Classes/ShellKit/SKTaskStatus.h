@@ -0,0 +1,129 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKTaskStatus.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <Foundation/Foundation.h>
+#import <ShellKit/SKObject.h>
+#import <sys/types.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @typedef     SKTaskState
+ * @abstract    The execution state of a runnable object
+ */
+typedef NS_ENUM( NSInteger, SKTaskState )
+{
+    SKTaskStatePending,     /*! Not run yet, in the current run of its parent */
+    SKTaskStateRunning,     /*! Currently running */
+    SKTaskStateSucceeded,   /*! Ran successfully */
+    SKTaskStateFailed,      /*! Failed */
+    SKTaskStateCancelled    /*! Was cancelled */
+};
+
+/*!
+ * @class       SKTaskStatus
+ * @abstract    An immutable snapshot of the execution status of a runnable object
+ * @discussion  Snapshots are taken with the `snapshot` method of tasks and
+ *              task groups. They are read without acquiring any of the
+ *              locks held while running, so they can be taken at any
+ *              time, from any thread, without blocking or slowing down
+ *              execution.
+ *              Task groups include a snapshot of each of their tasks,
+ *              and tasks a snapshot of each recovery task that has run.
+ * @see         SKRunableObject
+ */
+@interface SKTaskStatus: SKObject
+
+/*!
+ * @property    name
+ * @abstract    The task's script (with variables substituted once it has
+ *              started), or the task group's name
+ */
+@property( atomic, readonly ) NSString * name;
+
+/*!
+ * @property    state
+ * @abstract    The execution state
+ * @see         SKTaskState
+ */
+@property( atomic, readonly ) SKTaskState state;
+
+/*!
+ * @property    startDate
+ * @abstract    When the last run started, or nil if pending
+ */
+@property( atomic, readonly, nullable ) NSDate * startDate;
+
+/*!
+ * @property    endDate
+ * @abstract    When the last run ended, or nil if pending or running
+ */
+@property( atomic, readonly, nullable ) NSDate * endDate;
+
+/*!
+ * @property    duration
+ * @abstract    The duration of the last run, up to the snapshot if still
+ *              running
+ */
+@property( atomic, readonly ) NSTimeInterval duration;
+
+/*!
+ * @property    processIdentifier
+ * @abstract    The PID of the process running the task, or 0
+ * @discussion  Batched tasks share the PID of their batch's shell.
+ */
+@property( atomic, readonly ) pid_t processIdentifier;
+
+/*!
+ * @property    outputBytes
+ * @abstract    The number of bytes of output produced so far
+ * @discussion  Only output captured by ShellKit is counted (batched tasks,
+ *              services, tasks with an output delegate). Output written
+ *              directly to the terminal isn't seen.
+ *              For task groups, this is the total of their tasks.
+ */
+@property( atomic, readonly ) uint64_t outputBytes;
+
+/*!
+ * @property    children
+ * @abstract    The snapshots of the object's tasks or recovery tasks
+ */
+@property( atomic, readonly ) NSArray< SKTaskStatus * > * children;
+
+/*!
+ * @property    runningStatuses
+ * @abstract    The running nodes of the tree without running children
+ * @discussion  These are the nodes actually doing work at the time of the
+ *              snapshot.
+ */
+@property( atomic, readonly ) NSArray< SKTaskStatus * > * runningStatuses;
+
+@end
+
+NS_ASSUME_NONNULL_END
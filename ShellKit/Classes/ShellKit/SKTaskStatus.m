@@ -0,0 +1,357 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKTaskStatus.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import <ShellKit/ShellKit.h>
+#import "SKTaskStatus+Private.h"
+#import <sched.h>
+#import <stdatomic.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface SKTaskStatus()
+
+@property( atomic, readwrite, strong           ) NSString                  * name;
+@property( atomic, readwrite, assign           ) SKTaskState                 state;
+@property( atomic, readwrite, strong, nullable ) NSDate                    * startDate;
+@property( atomic, readwrite, strong, nullable ) NSDate                    * endDate;
+@property( atomic, readwrite, assign           ) pid_t                       processIdentifier;
+@property( atomic, readwrite, assign           ) uint64_t                    outputBytes;
+@property( atomic, readwrite, strong           ) NSArray< SKTaskStatus * > * children;
+
+- ( void )appendDescription: ( NSMutableString * )description depth: ( NSUInteger )depth;
+- ( void )collectRunningStatuses: ( NSMutableArray< SKTaskStatus * > * )statuses;
+
+@end
+
+@interface SKTaskStatusRecord()
+
+@property( atomic, readwrite, strong, nullable ) NSString * name;
+
+- ( void )beginWrite;
+- ( void )endWrite;
+
+@end
+
+NS_ASSUME_NONNULL_END
+
+@implementation SKTaskStatus
+
+- ( instancetype )init
+{
+    return [ self initWithName: @"" state: SKTaskStatePending startDate: nil endDate: nil processIdentifier: 0 outputBytes: 0 children: @[] ];
+}
+
+- ( instancetype )initWithName: ( NSString * )name state: ( SKTaskState )state startDate: ( nullable NSDate * )start endDate: ( nullable NSDate * )end processIdentifier: ( pid_t )pid outputBytes: ( uint64_t )bytes children: ( NSArray< SKTaskStatus * > * )children
+{
+    if( ( self = [ super init ] ) )
+    {
+        self.name              = name;
+        self.state             = state;
+        self.startDate         = start;
+        self.endDate           = end;
+        self.processIdentifier = pid;
+        self.outputBytes       = bytes;
+        self.children          = children;
+    }
+    
+    return self;
+}
+
+- ( NSTimeInterval )duration
+{
+    NSDate * start;
+    NSDate * end;
+    
+    start = self.startDate;
+    end   = self.endDate;
+    
+    if( start == nil )
+    {
+        return 0;
+    }
+    
+    return ( end ) ? [ ( NSDate * )end timeIntervalSinceDate: ( NSDate * )start ] : -[ ( NSDate * )start timeIntervalSinceNow ];
+}
+
+- ( NSArray< SKTaskStatus * > * )runningStatuses
+{
+    NSMutableArray< SKTaskStatus * > * statuses;
+    
+    statuses = [ NSMutableArray new ];
+    
+    [ self collectRunningStatuses: statuses ];
+    
+    return statuses;
+}
+
+- ( NSString * )description
+{
+    NSMutableString * description;
+    
+    description = [ NSMutableString new ];
+    
+    [ self appendDescription: description depth: 0 ];
+    
+    return description;
+}
+
+#pragma mark - Private
+
+- ( SKTaskStatus * )pendingStatus
+{
+    return [ [ SKTaskStatus alloc ] initWithName: self.name state: SKTaskStatePending startDate: nil endDate: nil processIdentifier: 0 outputBytes: 0 children: @[] ];
+}
+
+- ( void )appendDescription: ( NSMutableString * )description depth: ( NSUInteger )depth
+{
+    NSArray< NSString * > * states;
+    SKTaskStatus          * child;
+    
+    states = @[ @"pending", @"running", @"succeeded", @"failed", @"cancelled" ];
+    
+    [ description appendFormat: @"%@%@: %@", [ @"" stringByPaddingToLength: depth * 4 withString: @" " startingAtIndex: 0 ], states[ ( NSUInteger )( self.state ) ], self.name ];
+    
+    if( self.startDate )
+    {
+        [ description appendFormat: @" (%.3fs", self.duration ];
+        
+        if( self.processIdentifier > 0 )
+        {
+            [ description appendFormat: @", PID %li", ( long )( self.processIdentifier ) ];
+        }
+        
+        if( self.outputBytes > 0 )
+        {
+            [ description appendFormat: @", %llu bytes", ( unsigned long long )( self.outputBytes ) ];
+        }
+        
+        [ description appendString: @")" ];
+    }
+    
+    [ description appendString: @"\n" ];
+    
+    for( child in self.children )
+    {
+        [ child appendDescription: description depth: depth + 1 ];
+    }
+}
+
+- ( void )collectRunningStatuses: ( NSMutableArray< SKTaskStatus * > * )statuses
+{
+    SKTaskStatus * child;
+    NSUInteger     count;
+    
+    if( self.state != SKTaskStateRunning )
+    {
+        return;
+    }
+    
+    count = statuses.count;
+    
+    for( child in self.children )
+    {
+        [ child collectRunningStatuses: statuses ];
+    }
+    
+    if( statuses.count == count )
+    {
+        [ statuses addObject: self ];
+    }
+}
+
+@end
+
+@implementation SKTaskStatusRecord
+{
+    atomic_uint_fast64_t _sequence;
+    atomic_int           _state;
+    _Atomic( double )    _start;
+    _Atomic( double )    _end;
+    _Atomic( pid_t )     _pid;
+    atomic_uint_fast64_t _bytes;
+}
+
+- ( instancetype )init
+{
+    if( ( self = [ super init ] ) )
+    {
+        atomic_init( &_sequence, 0 );
+        atomic_init( &_state,    SKTaskStatePending );
+        atomic_init( &_start,    0 );
+        atomic_init( &_end,      0 );
+        atomic_init( &_pid,      0 );
+        atomic_init( &_bytes,    0 );
+    }
+    
+    return self;
+}
+
+- ( void )beginWithName: ( NSString * )name
+{
+    [ self beginWrite ];
+    
+    self.name = name;
+    
+    atomic_store_explicit( &_state, SKTaskStateRunning,                         memory_order_relaxed );
+    atomic_store_explicit( &_start, [ NSDate timeIntervalSinceReferenceDate ], memory_order_relaxed );
+    atomic_store_explicit( &_end,   0,                                          memory_order_relaxed );
+    atomic_store_explicit( &_pid,   0,                                          memory_order_relaxed );
+    atomic_store_explicit( &_bytes, 0,                                          memory_order_relaxed );
+    
+    [ self endWrite ];
+}
+
+- ( void )setProcessIdentifier: ( pid_t )pid
+{
+    [ self beginWrite ];
+    
+    atomic_store_explicit( &_pid, pid, memory_order_relaxed );
+    
+    [ self endWrite ];
+}
+
+- ( void )addOutputBytes: ( uint64_t )bytes
+{
+    atomic_fetch_add_explicit( &_bytes, bytes, memory_order_relaxed );
+}
+
+- ( void )endWithState: ( SKTaskState )state
+{
+    NSTimeInterval now;
+    
+    now = [ NSDate timeIntervalSinceReferenceDate ];
+    
+    [ self beginWrite ];
+    
+    /* Runs failing before having started still get a start date */
+    if( atomic_load_explicit( &_start, memory_order_relaxed ) == 0 )
+    {
+        atomic_store_explicit( &_start, now, memory_order_relaxed );
+    }
+    
+    atomic_store_explicit( &_state, ( int )state, memory_order_relaxed );
+    atomic_store_explicit( &_end,   now,          memory_order_relaxed );
+    
+    [ self endWrite ];
+}
+
+- ( NSTimeInterval )elapsedTime
+{
+    double start;
+    double end;
+    
+    start = atomic_load_explicit( &_start, memory_order_relaxed );
+    end   = atomic_load_explicit( &_end,   memory_order_relaxed );
+    
+    if( start == 0 )
+    {
+        return 0;
+    }
+    
+    return ( ( end > 0 ) ? end : [ NSDate timeIntervalSinceReferenceDate ] ) - start;
+}
+
+- ( SKTaskStatus * )snapshotWithDefaultName: ( NSString * )name children: ( NSArray< SKTaskStatus * > * )children
+{
+    uint_fast64_t  sequence;
+    NSString     * current;
+    NSDate       * startDate;
+    NSDate       * endDate;
+    SKTaskState    state;
+    double         start;
+    double         end;
+    pid_t          pid;
+    uint64_t       bytes;
+    
+    for( ; ; )
+    {
+        sequence = atomic_load_explicit( &_sequence, memory_order_acquire );
+        
+        /* A write is in progress - It's short, so just try again */
+        if( sequence & 1 )
+        {
+            sched_yield();
+            
+            continue;
+        }
+        
+        current = self.name;
+        state   = ( SKTaskState )atomic_load_explicit( &_state, memory_order_relaxed );
+        start   = atomic_load_explicit( &_start, memory_order_relaxed );
+        end     = atomic_load_explicit( &_end,   memory_order_relaxed );
+        pid     = atomic_load_explicit( &_pid,   memory_order_relaxed );
+        
+        atomic_thread_fence( memory_order_acquire );
+        
+        if( atomic_load_explicit( &_sequence, memory_order_relaxed ) == sequence )
+        {
+            break;
+        }
+    }
+    
+    if( current.length == 0 )
+    {
+        current = name;
+    }
+    
+    startDate = ( start > 0 ) ? [ NSDate dateWithTimeIntervalSinceReferenceDate: start ] : nil;
+    endDate   = ( end   > 0 ) ? [ NSDate dateWithTimeIntervalSinceReferenceDate: end   ] : nil;
+    bytes     = atomic_load_explicit( &_bytes, memory_order_relaxed );
+    
+    return [ [ SKTaskStatus alloc ] initWithName: ( NSString * )current state: state startDate: startDate endDate: endDate processIdentifier: pid outputBytes: bytes children: children ];
+}
+
+#pragma mark - Private
+
+- ( void )beginWrite
+{
+    uint_fast64_t sequence;
+    
+    /* Writers are rare, and only need to be serialized between themselves */
+    for( ; ; )
+    {
+        sequence = atomic_load_explicit( &_sequence, memory_order_relaxed );
+        
+        if( ( sequence & 1 ) == 0 && atomic_compare_exchange_weak_explicit( &_sequence, &sequence, sequence + 1, memory_order_acquire, memory_order_relaxed ) )
+        {
+            break;
+        }
+        
+        sched_yield();
+    }
+    
+    atomic_thread_fence( memory_order_release );
+}
+
+- ( void )endWrite
+{
+    atomic_fetch_add_explicit( &_sequence, 1, memory_order_release );
+}
+
+@end
@@ -0,0 +1,72 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @header      SKUTF8.h
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ * @abstract    Private UTF-8 functions, shared by ShellKit classes handling
+ *              the output of processes
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+/*!
+ * @function    SKUTF8SequenceLength
+ * @abstract    Gets the length of the UTF-8 sequence starting the bytes
+ * @discussion  Overlong sequences, surrogates and code points above U+10FFFF
+ *              are invalid.
+ * @param       bytes   The bytes
+ * @param       length  The number of bytes, which must not be zero
+ * @result      The length of the sequence, or zero if it is invalid or
+ *              truncated
+ */
+NSUInteger SKUTF8SequenceLength( const uint8_t * bytes, NSUInteger length );
+
+/*!
+ * @function    SKUTF8CompleteLength
+ * @abstract    Gets the length of the bytes, without a sequence truncated at
+ *              their end
+ * @discussion  Output is read by chunks, which may end within a multibyte
+ *              character. The truncated sequence can then be completed by
+ *              the next chunk.
+ * @param       bytes   The bytes
+ * @param       length  The number of bytes
+ * @result      The number of bytes before the truncated sequence, if any
+ */
+NSUInteger SKUTF8CompleteLength( const uint8_t * bytes, NSUInteger length );
+
+/*!
+ * @function    SKUTF8StringWithBytes
+ * @abstract    Decodes UTF-8 bytes
+ * @discussion  Invalid sequences are replaced with U+FFFD, so output that
+ *              isn't valid UTF-8 is never dropped.
+ * @param       bytes   The bytes
+ * @param       length  The number of bytes
+ * @result      The decoded string
+ */
+NSString * SKUTF8StringWithBytes( const uint8_t * bytes, NSUInteger length );
+
+NS_ASSUME_NONNULL_END
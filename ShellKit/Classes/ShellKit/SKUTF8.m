@@ -0,0 +1,162 @@
+/*******************************************************************************
+ * The MIT License (MIT)
+ * 
+ * Copyright (c) 2017 Jean-David Gadina - www.xs-labs.com
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ ******************************************************************************/
+
+/*!
+ * @file        SKUTF8.m
+ * @copyright   (c) 2017, Jean-David Gadina - www.xs-labs.com
+ */
+
+#import "SKUTF8.h"
+
+NSUInteger SKUTF8SequenceLength( const uint8_t * bytes, NSUInteger length )
+{
+    NSUInteger n;
+    NSUInteger i;
+    uint8_t    min;
+    uint8_t    max;
+    
+    min = 0x80;
+    max = 0xBF;
+    
+    if( bytes[ 0 ] < 0x80 )
+    {
+        return 1;
+    }
+    else if( bytes[ 0 ] >= 0xC2 && bytes[ 0 ] <= 0xDF )
+    {
+        n = 2;
+    }
+    else if( bytes[ 0 ] >= 0xE0 && bytes[ 0 ] <= 0xEF )
+    {
+        n   = 3;
+        min = ( bytes[ 0 ] == 0xE0 ) ? 0xA0 : 0x80;
+        max = ( bytes[ 0 ] == 0xED ) ? 0x9F : 0xBF;
+    }
+    else if( bytes[ 0 ] >= 0xF0 && bytes[ 0 ] <= 0xF4 )
+    {
+        n   = 4;
+        min = ( bytes[ 0 ] == 0xF0 ) ? 0x90 : 0x80;
+        max = ( bytes[ 0 ] == 0xF4 ) ? 0x8F : 0xBF;
+    }
+    else
+    {
+        return 0;
+    }
+    
+    if( length < n || bytes[ 1 ] < min || bytes[ 1 ] > max )
+    {
+        return 0;
+    }
+    
+    for( i = 2; i < n; i++ )
+    {
+        if( ( bytes[ i ] & 0xC0 ) != 0x80 )
+        {
+            return 0;
+        }
+    }
+    
+    return n;
+}
+
+NSUInteger SKUTF8CompleteLength( const uint8_t * bytes, NSUInteger length )
+{
+    NSUInteger i;
+    NSUInteger n;
+    
+    for( i = length; i > 0 && length - i < 4; i-- )
+    {
+        if( ( bytes[ i - 1 ] & 0xC0 ) == 0x80 )
+        {
+            continue;
+        }
+        
+        if( bytes[ i - 1 ] >= 0xF0 && bytes[ i - 1 ] <= 0xF4 )
+        {
+            n = 4;
+        }
+        else if( bytes[ i - 1 ] >= 0xE0 && bytes[ i - 1 ] <= 0xEF )
+        {
+            n = 3;
+        }
+        else if( bytes[ i - 1 ] >= 0xC2 && bytes[ i - 1 ] <= 0xDF )
+        {
+            n = 2;
+        }
+        else
+        {
+            n = 1;
+        }
+        
+        return ( length - ( i - 1 ) < n ) ? i - 1 : length;
+    }
+    
+    return length;
+}
+
+NSString * SKUTF8StringWithBytes( const uint8_t * bytes, NSUInteger length )
+{
+    NSString        * string;
+    NSMutableString * lossy;
+    NSUInteger        start;
+    NSUInteger        i;
+    NSUInteger        n;
+    
+    string = [ [ NSString alloc ] initWithBytes: bytes length: length encoding: NSUTF8StringEncoding ];
+    
+    if( string != nil )
+    {
+        return string;
+    }
+    
+    lossy = [ NSMutableString stringWithCapacity: length ];
+    start = 0;
+    
+    for( i = 0; i < length; i += n )
+    {
+        n = SKUTF8SequenceLength( bytes + i, length - i );
+        
+        if( n > 0 )
+        {
+            continue;
+        }
+        
+        if( i > start )
+        {
+            [ lossy appendString: [ [ NSString alloc ] initWithBytes: bytes + start length: i - start encoding: NSUTF8StringEncoding ] ];
+        }
+        
+        [ lossy appendString: @"\uFFFD" ];
+        
+        n     = 1;
+        start = i + 1;
+    }
+    
+    if( length > start )
+    {
+        [ lossy appendString: [ [ NSString alloc ] initWithBytes: bytes + start length: length - start encoding: NSUTF8StringEncoding ] ];
+    }
+    
+    return lossy;
+}
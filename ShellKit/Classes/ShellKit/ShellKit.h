@@ -32,8 +32,17 @@
 #import <ShellKit/NSString+ShellKit.h>
 #import <ShellKit/NSDate+ShellKit.h>
 #import <ShellKit/SKObject.h>
+#import <ShellKit/SKEnvironment.h>
+#import <ShellKit/SKProcessAttributes.h>
+#import <ShellKit/SKTaskStatus.h>
+#import <ShellKit/SKEventStream.h>
+#import <ShellKit/SKConcurrencyLimiter.h>
+#import <ShellKit/SKRecording.h>
+#import <ShellKit/SKFuture.h>
 #import <ShellKit/SKRunableObject.h>
 #import <ShellKit/SKShell.h>
 #import <ShellKit/SKTask.h>
 #import <ShellKit/SKOptionalTask.h>
 #import <ShellKit/SKTaskGroup.h>
+#import <ShellKit/SKTaskBarrier.h>
+#import <ShellKit/SKTaskGraph.h>